@@ -0,0 +1,17 @@
+package com.scanforge3d.data.model
+
+/** Zustand der nativen Frame-Warteschlange zwischen AR-Thread und Worker. */
+data class FrameQueueStats(
+    val queued: Int = 0,        // Frames, die auf den Worker warten
+    val capacity: Int = 0,
+    val submitted: Long = 0,
+    val dropped: Long = 0,      // Verworfen, weil die Warteschlange voll war
+    val integrated: Long = 0,
+    val voxelCount: Int = 0,    // Voxel nach dem letzten integrierten Frame
+    val refined: Long = 0,      // Frames mit per ICP korrigierter Pose
+    val rejected: Long = 0,     // Ungültig (keine Tiefe, falsche Größe), nicht in dropped
+    val refineRejected: Long = 0 // ICP-Ergebnisse verworfen (Fitness, RMSE, Posensprung)
+) {
+    val dropRate: Float
+        get() = if (submitted > 0) dropped.toFloat() / submitted else 0f
+}
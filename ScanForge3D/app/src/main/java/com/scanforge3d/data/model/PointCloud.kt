@@ -6,7 +6,9 @@ data class PointCloud(
     val points: Array<FloatArray>,  // Jeder Eintrag: [x, y, z]
     val timestamp: Long,
     val cameraPose: Pose,
-    val pointCount: Int
+    val pointCount: Int,
+    val confidences: FloatArray? = null,  // Pro Punkt in [0, 1], parallel zu points
+    val normals: FloatArray? = null  // [nx, ny, nz] pro Punkt, Weltkoordinaten, zur Kamera gerichtet
 ) {
     fun toFlatArray(): FloatArray {
         val flat = FloatArray(points.size * 3)
@@ -64,8 +64,111 @@ class ScanRepository @Inject constructor(
         }
     }
 
+    fun savePointConfidence(scanId: String, confidence: FloatArray): File {
+        val file = File(scanDir, "${scanId}.confidence")
+        FileOutputStream(file).use { fos ->
+            ObjectOutputStream(fos).use { oos ->
+                oos.writeObject(confidence)
+            }
+        }
+        return file
+    }
+
+    fun loadPointConfidence(scanId: String): FloatArray? {
+        val file = File(scanDir, "${scanId}.confidence")
+        if (!file.exists()) return null
+        return try {
+            file.inputStream().use { fis ->
+                ObjectInputStream(fis).use { ois ->
+                    ois.readObject() as FloatArray
+                }
+            }
+        } catch (e: Exception) {
+            null
+        }
+    }
+
+    fun savePointNormals(scanId: String, normals: FloatArray): File {
+        val file = File(scanDir, "${scanId}.normals")
+        FileOutputStream(file).use { fos ->
+            ObjectOutputStream(fos).use { oos ->
+                oos.writeObject(normals)
+            }
+        }
+        return file
+    }
+
+    fun loadPointNormals(scanId: String): FloatArray? {
+        val file = File(scanDir, "${scanId}.normals")
+        if (!file.exists()) return null
+        return try {
+            file.inputStream().use { fis ->
+                ObjectInputStream(fis).use { ois ->
+                    ois.readObject() as FloatArray
+                }
+            }
+        } catch (e: Exception) {
+            null
+        }
+    }
+
+    /** Surface extracted from the TSDF volume during the scan (serialized mesh). */
+    fun saveFusedMesh(scanId: String, meshData: FloatArray): File {
+        val file = File(scanDir, "${scanId}.fused")
+        FileOutputStream(file).use { fos ->
+            ObjectOutputStream(fos).use { oos ->
+                oos.writeObject(meshData)
+            }
+        }
+        return file
+    }
+
+    fun loadFusedMesh(scanId: String): FloatArray? {
+        val file = File(scanDir, "${scanId}.fused")
+        if (!file.exists()) return null
+        return try {
+            file.inputStream().use { fis ->
+                ObjectInputStream(fis).use { ois ->
+                    ois.readObject() as FloatArray
+                }
+            }
+        } catch (e: Exception) {
+            null
+        }
+    }
+
+    /** Frame id per point plus the camera position [x,y,z] of each frame. */
+    fun saveViewpoints(scanId: String, frameIds: IntArray, cameraOrigins: FloatArray): File {
+        val file = File(scanDir, "${scanId}.viewpoints")
+        FileOutputStream(file).use { fos ->
+            ObjectOutputStream(fos).use { oos ->
+                oos.writeObject(frameIds)
+                oos.writeObject(cameraOrigins)
+            }
+        }
+        return file
+    }
+
+    fun loadViewpoints(scanId: String): Pair<IntArray, FloatArray>? {
+        val file = File(scanDir, "${scanId}.viewpoints")
+        if (!file.exists()) return null
+        return try {
+            file.inputStream().use { fis ->
+                ObjectInputStream(fis).use { ois ->
+                    Pair(ois.readObject() as IntArray, ois.readObject() as FloatArray)
+                }
+            }
+        } catch (e: Exception) {
+            null
+        }
+    }
+
     fun deleteScanData(scanId: String) {
         File(scanDir, "${scanId}.mesh").delete()
         File(scanDir, "${scanId}.points").delete()
+        File(scanDir, "${scanId}.confidence").delete()
+        File(scanDir, "${scanId}.viewpoints").delete()
+        File(scanDir, "${scanId}.normals").delete()
+        File(scanDir, "${scanId}.fused").delete()
     }
 }
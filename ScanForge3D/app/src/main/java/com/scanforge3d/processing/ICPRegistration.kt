@@ -5,12 +5,32 @@ import javax.inject.Inject
 class ICPRegistration @Inject constructor(
     private val native: NativeMeshProcessor
 ) {
+    /**
+     * @param targetNormals Normal per target point [nx,ny,nz, ...]; when
+     *   given, point-to-plane ICP is used (converges in fewer iterations).
+     * @param approxEpsilon Start epsilon for approximate correspondences
+     *   (tightened to exact as the RMSE converges); 0 = always exact.
+     * @param maxLeafVisits KD-tree leaf budget per approximate query; 0 = no cap.
+     * @param pyramidLevels Resolution levels incl. the full clouds; the
+     *   coarser ones are voxel-downsampled and registered first, so most
+     *   iterations run on few points (large parts). 1 = full resolution only.
+     * @param pyramidVoxelSize Voxel size of the finest downsampled level
+     *   in meters, doubled per coarser level.
+     */
     fun align(
         sourceFlatPoints: FloatArray,
         targetFlatPoints: FloatArray,
+        targetNormals: FloatArray? = null,
         maxIterations: Int = 50,
-        tolerance: Float = 1e-6f
+        tolerance: Float = 1e-6f,
+        approxEpsilon: Float = 1.0f,
+        maxLeafVisits: Int = 0,
+        pyramidLevels: Int = 4,
+        pyramidVoxelSize: Float = 0.004f
     ): FloatArray {
-        return native.icpRegistration(sourceFlatPoints, targetFlatPoints, maxIterations, tolerance)
+        return native.icpRegistration(
+            sourceFlatPoints, targetFlatPoints, targetNormals, maxIterations, tolerance,
+            approxEpsilon, maxLeafVisits, pyramidLevels, pyramidVoxelSize
+        )
     }
 }
@@ -12,11 +12,34 @@ class MeshProcessingPipeline @Inject constructor(
         MARCHING_CUBES   // Direct voxel size control
     }
 
+    enum class OutlierFilter {
+        STATISTICAL,     // Mean k-NN distance vs. global statistics
+        RADIUS           // Minimum neighbor count within a fixed radius
+    }
+
     data class PipelineConfig(
         val voxelSize: Float = 0.002f,
+        // Flat cells up to 2^levels voxels wide collapse to one point
+        // (0 = fixed voxel size). Off by default: SOR/ROR thresholds
+        // assume roughly uniform density.
+        val adaptiveVoxelLevels: Int = 0,
+        val adaptiveMaxDeviation: Float = 0.0005f,
+        val outlierFilter: OutlierFilter = OutlierFilter.STATISTICAL,
         val sorKNeighbors: Int = 20,
         val sorStdRatio: Float = 2.0f,
+        val rorRadius: Float = 0.006f,
+        val rorMinNeighbors: Int = 4,
         val normalKNeighbors: Int = 15,
+        // Orient normals toward the capturing camera when frame ids and
+        // camera origins are available; otherwise k-NN propagation
+        val viewpointOrientation: Boolean = true,
+        // Keep the depth-image normals from the scan where there are any;
+        // PCA only fills the points without one
+        val useScanNormals: Boolean = true,
+        // Use the surface fused into the TSDF volume during the scan when
+        // there is one; downsampling, outlier removal, normals and
+        // reconstruction from points are then skipped
+        val useFusedSurface: Boolean = true,
         val reconstructionMethod: ReconstructionMethod = ReconstructionMethod.POISSON,
         val poissonDepth: Int = 9,
         val marchingCubesVoxelSize: Float = 0.003f,
@@ -40,28 +63,21 @@ class MeshProcessingPipeline @Inject constructor(
 
     suspend fun process(
         pointsFlat: FloatArray,
+        confidence: FloatArray? = null,
+        normals: FloatArray? = null,
+        frameIds: IntArray? = null,
+        cameraOrigins: FloatArray? = null,
+        fusedMesh: FloatArray? = null,
         config: PipelineConfig = PipelineConfig(),
         callback: ProgressCallback? = null
     ): PipelineResult = withContext(Dispatchers.Default) {
         val startTime = System.currentTimeMillis()
 
-        callback?.onProgress("Downsampling...", 0.05f)
-        val downsampled = native.voxelGridFilter(pointsFlat, config.voxelSize)
-
-        callback?.onProgress("Rauschen entfernen...", 0.15f)
-        val cleaned = native.statisticalOutlierRemoval(
-            downsampled, config.sorKNeighbors, config.sorStdRatio
-        )
-
-        callback?.onProgress("Normalen berechnen...", 0.25f)
-        val pointsWithNormals = native.estimateNormals(cleaned, config.normalKNeighbors)
-
-        callback?.onProgress("Oberfläche rekonstruieren...", 0.45f)
-        val rawMesh = when (config.reconstructionMethod) {
-            ReconstructionMethod.POISSON ->
-                native.poissonReconstruction(pointsWithNormals, config.poissonDepth)
-            ReconstructionMethod.MARCHING_CUBES ->
-                native.marchingCubesReconstruction(pointsWithNormals, config.marchingCubesVoxelSize)
+        val rawMesh = if (config.useFusedSurface && fusedMesh != null && fusedMesh[0] > 0f) {
+            fusedMesh
+        } else {
+            reconstructFromPoints(pointsFlat, confidence, normals, frameIds, cameraOrigins,
+                config, callback)
         }
 
         callback?.onProgress("Mesh reparieren...", 0.60f)
@@ -97,6 +113,74 @@ class MeshProcessingPipeline @Inject constructor(
         )
     }
 
+    private fun reconstructFromPoints(
+        pointsFlat: FloatArray,
+        confidence: FloatArray?,
+        normals: FloatArray?,
+        frameIds: IntArray?,
+        cameraOrigins: FloatArray?,
+        config: PipelineConfig,
+        callback: ProgressCallback?
+    ): FloatArray {
+        val useViewpoints = config.viewpointOrientation &&
+            frameIds != null && cameraOrigins != null && frameIds.size * 3 == pointsFlat.size
+        val useNormals = config.useScanNormals && normals != null && normals.size == pointsFlat.size
+
+        callback?.onProgress("Downsampling...", 0.05f)
+        // Frame id / normal per downsampled point; only the entries for
+        // the first (size / 3) points are filled
+        val downsampledFrameIds = if (useViewpoints) IntArray(frameIds!!.size) else null
+        val downsampledNormals = if (useNormals) FloatArray(normals!!.size) else null
+        val weighted = confidence != null || config.adaptiveVoxelLevels > 0 ||
+            useViewpoints || useNormals
+        val downsampled = if (weighted) {
+            native.voxelGridFilterWeighted(
+                pointsFlat, confidence, if (useViewpoints) frameIds else null,
+                if (useNormals) normals else null, config.voxelSize,
+                config.adaptiveVoxelLevels, config.adaptiveMaxDeviation,
+                downsampledFrameIds, downsampledNormals
+            )
+        } else {
+            native.voxelGridFilter(pointsFlat, config.voxelSize)
+        }
+
+        // One KD-tree + k-NN graph shared by outlier removal, normals and reconstruction
+        val indexK = when (config.outlierFilter) {
+            OutlierFilter.STATISTICAL -> maxOf(config.sorKNeighbors + 1, config.normalKNeighbors)
+            OutlierFilter.RADIUS -> config.normalKNeighbors
+        }
+        val index = native.createNeighborhoodIndex(
+            downsampled, indexK, downsampledFrameIds, downsampledNormals
+        )
+        return try {
+            callback?.onProgress("Rauschen entfernen...", 0.15f)
+            when (config.outlierFilter) {
+                OutlierFilter.STATISTICAL -> native.statisticalOutlierRemovalIndexed(
+                    index, config.sorKNeighbors, config.sorStdRatio
+                )
+                OutlierFilter.RADIUS -> native.radiusOutlierRemovalIndexed(
+                    index, config.rorRadius, config.rorMinNeighbors
+                )
+            }
+
+            callback?.onProgress("Normalen berechnen...", 0.25f)
+            native.estimateNormalsIndexed(
+                index, config.normalKNeighbors, if (useViewpoints) cameraOrigins else null,
+                useNormals
+            )
+
+            callback?.onProgress("Oberfläche rekonstruieren...", 0.45f)
+            when (config.reconstructionMethod) {
+                ReconstructionMethod.POISSON ->
+                    native.poissonReconstructionIndexed(index, config.poissonDepth)
+                ReconstructionMethod.MARCHING_CUBES ->
+                    native.marchingCubesReconstructionIndexed(index, config.marchingCubesVoxelSize)
+            }
+        } finally {
+            native.releaseNeighborhoodIndex(index)
+        }
+    }
+
     private fun applyScale(meshData: FloatArray, scale: Float): FloatArray {
         val result = meshData.copyOf()
         val vcount = result[0].toInt()
@@ -1,5 +1,6 @@
 package com.scanforge3d.processing
 
+import java.nio.ByteBuffer
 import javax.inject.Inject
 import javax.inject.Singleton
 
@@ -14,14 +15,92 @@ class NativeMeshProcessor @Inject constructor() {
 
     // Point cloud processing
     external fun voxelGridFilter(pointsFlat: FloatArray, voxelSize: Float): FloatArray
+    // frameIdsOut / normalsOut (if not null, sized for the input) receive
+    // the latest frame id / mean normal of each output voxel when
+    // frameIds / normals are given
+    external fun voxelGridFilterWeighted(
+        pointsFlat: FloatArray, confidence: FloatArray?, frameIds: IntArray?,
+        normals: FloatArray?, voxelSize: Float, adaptiveLevels: Int,
+        maxPlaneDeviation: Float, frameIdsOut: IntArray?, normalsOut: FloatArray?
+    ): FloatArray
     external fun statisticalOutlierRemoval(
         pointsFlat: FloatArray, kNeighbors: Int, stdRatio: Float
     ): FloatArray
+    external fun radiusOutlierRemoval(
+        pointsFlat: FloatArray, radius: Float, minNeighbors: Int
+    ): FloatArray
     external fun icpRegistration(
-        sourceFlat: FloatArray, targetFlat: FloatArray,
-        maxIterations: Int, tolerance: Float
+        sourceFlat: FloatArray, targetFlat: FloatArray, targetNormals: FloatArray?,
+        maxIterations: Int, tolerance: Float,
+        approxEpsilon: Float, maxLeafVisits: Int,
+        pyramidLevels: Int, pyramidVoxelSize: Float
     ): FloatArray
 
+    // Shared neighborhood index (one KD-tree + k-NN graph for the pipeline)
+    external fun createNeighborhoodIndex(
+        pointsFlat: FloatArray, kNeighbors: Int, frameIds: IntArray?, normals: FloatArray?
+    ): Long
+    external fun releaseNeighborhoodIndex(handle: Long)
+    external fun statisticalOutlierRemovalIndexed(
+        handle: Long, kNeighbors: Int, stdRatio: Float
+    ): Int
+    external fun radiusOutlierRemovalIndexed(
+        handle: Long, radius: Float, minNeighbors: Int
+    ): Int
+    // cameraOrigins [x,y,z] per frame id: orient normals toward the capturing
+    // camera (needs frame ids on the index); null = k-NN propagation.
+    // keepExisting: normals the index was created with stay, PCA fills the rest
+    external fun estimateNormalsIndexed(
+        handle: Long, kNeighbors: Int, cameraOrigins: FloatArray?, keepExisting: Boolean
+    ): Int
+    external fun poissonReconstructionIndexed(handle: Long, depth: Int): FloatArray
+    external fun marchingCubesReconstructionIndexed(handle: Long, voxelSize: Float): FloatArray
+
+    // Streaming voxel map (persistent accumulator for scan frames)
+    external fun createVoxelMap(voxelSize: Float, maxVoxels: Int): Long
+    external fun releaseVoxelMap(handle: Long)
+    external fun voxelMapAddPoints(
+        handle: Long, pointsFlat: FloatArray, confidence: FloatArray?, frameId: Int,
+        normals: FloatArray?
+    ): Int
+    external fun voxelMapSize(handle: Long): Int
+    external fun voxelMapGetPoints(handle: Long): FloatArray
+    external fun voxelMapGetConfidence(handle: Long): FloatArray
+    external fun voxelMapGetNormals(handle: Long): FloatArray
+    external fun voxelMapGetFrameIds(handle: Long): IntArray
+    external fun voxelMapClear(handle: Long)
+
+    // Sparse TSDF volume fused from depth frames (voxel blocks allocated
+    // where surfaces are seen, within a memory budget; evicted blocks go
+    // to the spill file, or are dropped if it is null); the surface is
+    // extracted with marching cubes directly on the blocks
+    external fun createTSDFVolume(
+        voxelSize: Float, truncation: Float, memoryBudgetMb: Int, spillPath: String?,
+        minDepth: Float, maxDepth: Float, minConfidence: Int
+    ): Long
+    external fun releaseTSDFVolume(handle: Long)
+    external fun tsdfVolumeExtractMesh(handle: Long): FloatArray
+
+    // Depth frames straight from the ARCore buffers, integrated into a
+    // voxel map (and optionally a TSDF volume, 0 = none) on a native
+    // worker thread behind a lock-free ring buffer; refinePose tracks
+    // each frame against the TSDF volume (projective ICP) first
+    external fun createDepthFrameWorker(
+        mapHandle: Long, tsdfHandle: Long, capacity: Int, maxPixels: Int,
+        windowRadius: Int, maxDepthChange: Float, minDepth: Float, maxDepth: Float,
+        minConfidence: Int, refinePose: Boolean
+    ): Long
+    external fun releaseDepthFrameWorker(handle: Long)
+    external fun depthFrameWorkerSubmit(
+        handle: Long, depthBuffer: ByteBuffer, depthRowStride: Int,
+        confidenceBuffer: ByteBuffer?, confidenceRowStride: Int,
+        width: Int, height: Int, fx: Float, fy: Float, cx: Float, cy: Float,
+        pose: FloatArray, stride: Int, frameId: Int
+    ): Boolean
+    // [queued, capacity, submitted, dropped, integrated, voxels, refined, rejected,
+    //  refineRejected]
+    external fun depthFrameWorkerStats(handle: Long): LongArray
+
     // Normal estimation
     external fun estimateNormals(pointsFlat: FloatArray, kNeighbors: Int): FloatArray
 
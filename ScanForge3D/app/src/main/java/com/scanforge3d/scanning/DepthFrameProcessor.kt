@@ -1,22 +1,56 @@
 package com.scanforge3d.scanning
 
 import com.google.ar.core.Frame
+import com.google.ar.core.Pose
 import com.google.ar.core.TrackingState
 import com.google.ar.core.exceptions.NotYetAvailableException
-import com.scanforge3d.data.model.PointCloud
-import java.nio.ByteOrder
+import com.scanforge3d.data.model.FrameQueueStats
+import com.scanforge3d.processing.NativeMeshProcessor
 import javax.inject.Inject
 
-class DepthFrameProcessor @Inject constructor() {
+/**
+ * Integrates ARCore depth frames into a native voxel map.
+ *
+ * The depth and confidence planes are handed to native code as the
+ * direct buffers ARCore exposes, together with the intrinsics and the
+ * camera pose. Native code copies them into a preallocated slot of a
+ * lock-free ring buffer and returns; a native worker thread does the
+ * unprojection (SIMD), filtering, per-frame normals from the organized
+ * depth image and the voxel map update. The AR thread never waits for
+ * integration: when the worker falls behind, frames are dropped and
+ * counted; frames with unusable buffers are counted apart as rejected
+ * (see [getQueueStats]; the scan overlay shows both).
+ *
+ * With a TSDF volume, the worker also tracks each frame against it
+ * (projective ICP) and corrects the ARCore pose drift before fusing.
+ */
+class DepthFrameProcessor @Inject constructor(
+    private val nativeMeshProcessor: NativeMeshProcessor
+) {
 
     companion object {
         const val MIN_CONFIDENCE: Int = 200
         const val MIN_DEPTH_M: Float = 0.1f
         const val MAX_DEPTH_M: Float = 3.0f
         const val MAX_POINTS_PER_FRAME: Int = 50_000
+        const val NORMAL_WINDOW_RADIUS: Int = 2
+        const val NORMAL_MAX_DEPTH_CHANGE: Float = 0.05f
+        const val FRAME_QUEUE_CAPACITY: Int = 4
+        const val FRAME_SLOT_PIXELS: Int = 640 * 480
+        const val REFINE_POSE: Boolean = true
     }
 
-    fun processFrame(frame: Frame): PointCloud? {
+    private var worker: Long = 0L
+    private val viewMatrix = FloatArray(16)
+
+    /**
+     * Queues the frame's depth for integration into [voxelMap] under
+     * [frameId], and for fusion into [tsdfVolume] unless it is 0.
+     * Returns the camera pose, or null if there was no depth or
+     * tracking, or the frame was dropped. Neither native object may be
+     * read or released before [release].
+     */
+    fun submitFrame(frame: Frame, voxelMap: Long, tsdfVolume: Long, frameId: Int): Pose? {
         try {
             val depthImage = frame.acquireRawDepthImage16Bits()
             val confidenceImage = frame.acquireRawDepthConfidenceImage()
@@ -35,45 +69,27 @@ class DepthFrameProcessor @Inject constructor() {
 
                 val width = depthImage.width
                 val height = depthImage.height
-
-                val depthBuffer = depthImage.planes[0].buffer
-                    .order(ByteOrder.LITTLE_ENDIAN).asShortBuffer()
-                val confidenceBuffer = confidenceImage.planes[0].buffer
+                val depthPlane = depthImage.planes[0]
+                val confidencePlane = confidenceImage.planes[0]
 
                 val cameraPose = camera.displayOrientedPose
-                val viewMatrix = FloatArray(16)
                 cameraPose.toMatrix(viewMatrix, 0)
 
-                val points = mutableListOf<FloatArray>()
                 val stride = maxOf(1, (width * height) / MAX_POINTS_PER_FRAME)
-
-                for (y in 0 until height step stride) {
-                    for (x in 0 until width step stride) {
-                        val idx = y * width + x
-
-                        val confidence = confidenceBuffer.get(idx).toInt() and 0xFF
-                        if (confidence < MIN_CONFIDENCE) continue
-
-                        val depthMm = depthBuffer.get(idx).toInt() and 0xFFFF
-                        val depthM = depthMm / 1000.0f
-
-                        if (depthM < MIN_DEPTH_M || depthM > MAX_DEPTH_M) continue
-
-                        val localX = (x - cx) / fx * depthM
-                        val localY = (y - cy) / fy * depthM
-                        val localZ = -depthM
-
-                        val worldPoint = transformPoint(viewMatrix, localX, localY, localZ)
-                        points.add(worldPoint)
-                    }
+                if (worker == 0L) {
+                    worker = nativeMeshProcessor.createDepthFrameWorker(
+                        voxelMap, tsdfVolume, FRAME_QUEUE_CAPACITY, maxOf(FRAME_SLOT_PIXELS, width * height),
+                        NORMAL_WINDOW_RADIUS, NORMAL_MAX_DEPTH_CHANGE,
+                        MIN_DEPTH_M, MAX_DEPTH_M, MIN_CONFIDENCE,
+                        REFINE_POSE && tsdfVolume != 0L
+                    )
                 }
-
-                return PointCloud(
-                    points = points.toTypedArray(),
-                    timestamp = frame.timestamp,
-                    cameraPose = cameraPose,
-                    pointCount = points.size
+                val queued = nativeMeshProcessor.depthFrameWorkerSubmit(
+                    worker, depthPlane.buffer, depthPlane.rowStride,
+                    confidencePlane.buffer, confidencePlane.rowStride,
+                    width, height, fx, fy, cx, cy, viewMatrix, stride, frameId
                 )
+                return if (queued) cameraPose else null
 
             } finally {
                 depthImage.close()
@@ -84,13 +100,25 @@ class DepthFrameProcessor @Inject constructor() {
         }
     }
 
-    private fun transformPoint(
-        matrix: FloatArray, x: Float, y: Float, z: Float
-    ): FloatArray {
-        return floatArrayOf(
-            matrix[0] * x + matrix[4] * y + matrix[8] * z + matrix[12],
-            matrix[1] * x + matrix[5] * y + matrix[9] * z + matrix[13],
-            matrix[2] * x + matrix[6] * y + matrix[10] * z + matrix[14]
+    fun getQueueStats(): FrameQueueStats {
+        if (worker == 0L) return FrameQueueStats()
+        val s = nativeMeshProcessor.depthFrameWorkerStats(worker)
+        return FrameQueueStats(
+            queued = s[0].toInt(), capacity = s[1].toInt(), submitted = s[2],
+            dropped = s[3], integrated = s[4], voxelCount = s[5].toInt(),
+            refined = s[6], rejected = s[7], refineRejected = s[8]
         )
     }
+
+    /**
+     * Integrates the frames still queued and stops the native worker;
+     * afterwards the voxel map may be read. A new worker is created with
+     * the next frame.
+     */
+    fun release() {
+        if (worker != 0L) {
+            nativeMeshProcessor.releaseDepthFrameWorker(worker)
+            worker = 0L
+        }
+    }
 }
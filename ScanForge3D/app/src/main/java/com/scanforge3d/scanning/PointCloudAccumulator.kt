@@ -1,66 +1,146 @@
 package com.scanforge3d.scanning
 
-import com.scanforge3d.data.model.PointCloud
+import android.content.Context
+import com.google.ar.core.Frame
+import com.scanforge3d.data.model.FrameQueueStats
 import com.scanforge3d.processing.NativeMeshProcessor
+import dagger.hilt.android.qualifiers.ApplicationContext
+import java.io.File
 import javax.inject.Inject
 
+/**
+ * Merges depth frames into a native voxel map as they arrive.
+ *
+ * Each frame is folded into running per-voxel means, so adding a frame
+ * costs O(frame size) no matter how long the scan has been running, and
+ * the accumulated cloud is read back without reprocessing. Points are
+ * weighted by their depth confidence, so low-confidence samples move
+ * the voxel means less.
+ *
+ * Every frame is numbered and its camera position recorded; each voxel
+ * keeps the number of the latest frame that saw it, so normals can later
+ * be oriented toward the capturing camera. Per-frame depth-image
+ * normals are averaged per voxel as well.
+ *
+ * Frames go from the ARCore buffers into the map without a detour
+ * through per-point arrays, on a native worker thread (see
+ * [DepthFrameProcessor]); the accumulated data is read after
+ * [finishFrames].
+ *
+ * The same frames are fused into a sparse TSDF volume, from which the
+ * surface is extracted directly ([extractFusedMesh]). Its voxel blocks
+ * are allocated wherever surfaces are seen, so it needs no placement
+ * and covers the whole scan; beyond the memory budget the blocks seen
+ * least recently are moved to a spill file in the cache directory.
+ */
 class PointCloudAccumulator @Inject constructor(
-    private val nativeMeshProcessor: NativeMeshProcessor
+    @ApplicationContext private val context: Context,
+    private val nativeMeshProcessor: NativeMeshProcessor,
+    private val depthFrameProcessor: DepthFrameProcessor
 ) {
     companion object {
         const val VOXEL_SIZE_M: Float = 0.002f
         const val MAX_ACCUMULATED_POINTS: Int = 2_000_000
+        const val TSDF_VOXEL_SIZE_M: Float = 0.002f
+        const val TSDF_MEMORY_BUDGET_MB: Int = 192
+        const val TSDF_SPILL_FILE = "tsdf_spill.bin"
     }
 
-    private val accumulatedPoints = mutableListOf<FloatArray>()
+    private var voxelMap: Long = 0L
+    private var tsdfVolume: Long = 0L
+    private var voxelCount = 0
     private var frameCount = 0
+    private var cameraOrigins = FloatArray(3 * 256)
 
-    fun addFrame(pointCloud: PointCloud) {
-        accumulatedPoints.addAll(pointCloud.points)
+    /** Returns false if the frame had no usable depth or was dropped. */
+    fun addFrame(frame: Frame): Boolean {
+        if (voxelMap == 0L) {
+            voxelMap = nativeMeshProcessor.createVoxelMap(VOXEL_SIZE_M, MAX_ACCUMULATED_POINTS)
+        }
+        if (tsdfVolume == 0L) {
+            tsdfVolume = nativeMeshProcessor.createTSDFVolume(
+                TSDF_VOXEL_SIZE_M, 0f, TSDF_MEMORY_BUDGET_MB,
+                File(context.cacheDir, TSDF_SPILL_FILE).absolutePath,
+                DepthFrameProcessor.MIN_DEPTH_M, DepthFrameProcessor.MAX_DEPTH_M,
+                DepthFrameProcessor.MIN_CONFIDENCE
+            )
+        }
+        val pose = depthFrameProcessor.submitFrame(frame, voxelMap, tsdfVolume, frameCount)
+            ?: return false
+        if (cameraOrigins.size < 3 * (frameCount + 1)) {
+            cameraOrigins = cameraOrigins.copyOf(cameraOrigins.size * 2)
+        }
+        cameraOrigins[frameCount * 3] = pose.tx()
+        cameraOrigins[frameCount * 3 + 1] = pose.ty()
+        cameraOrigins[frameCount * 3 + 2] = pose.tz()
         frameCount++
+        return true
+    }
 
-        if (frameCount % 10 == 0) {
-            downsample()
-        }
+    /** Accumulated points as [x0,y0,z0, x1,y1,z1, ...], straight from the native map. */
+    fun getAccumulatedCloud(): FloatArray {
+        if (voxelMap == 0L) return FloatArray(0)
+        return nativeMeshProcessor.voxelMapGetPoints(voxelMap)
     }
 
-    private fun downsample() {
-        if (accumulatedPoints.size < 1000) return
+    /** Mean confidence per point of [getAccumulatedCloud], in the same order. */
+    fun getAccumulatedConfidence(): FloatArray {
+        if (voxelMap == 0L) return FloatArray(0)
+        return nativeMeshProcessor.voxelMapGetConfidence(voxelMap)
+    }
 
-        val flatPoints = flattenPoints(accumulatedPoints)
-        val downsampled = nativeMeshProcessor.voxelGridFilter(flatPoints, VOXEL_SIZE_M)
-        accumulatedPoints.clear()
-        accumulatedPoints.addAll(unflattenPoints(downsampled))
+    /**
+     * Mean depth-image normal per point of [getAccumulatedCloud] as
+     * [nx,ny,nz, ...]; (0,0,0) where none was found, empty if frames had none.
+     */
+    fun getAccumulatedNormals(): FloatArray {
+        if (voxelMap == 0L) return FloatArray(0)
+        return nativeMeshProcessor.voxelMapGetNormals(voxelMap)
     }
 
-    fun getAccumulatedCloud(): Array<FloatArray> {
-        downsample()
-        return accumulatedPoints.toTypedArray()
+    /** Latest frame per point of [getAccumulatedCloud], indexing [getCameraOrigins]. */
+    fun getAccumulatedFrameIds(): IntArray {
+        if (voxelMap == 0L) return IntArray(0)
+        return nativeMeshProcessor.voxelMapGetFrameIds(voxelMap)
     }
 
-    fun getPointCount(): Int = accumulatedPoints.size
+    /** Camera position per frame, [x0,y0,z0, x1,y1,z1, ...] in world coordinates. */
+    fun getCameraOrigins(): FloatArray = cameraOrigins.copyOf(frameCount * 3)
+
+    /** While frames are being added: voxel count after the last integrated frame. */
+    fun getPointCount(): Int {
+        val stats = depthFrameProcessor.getQueueStats()
+        return if (stats.capacity > 0) stats.voxelCount else voxelCount
+    }
     fun getFrameCount(): Int = frameCount
 
-    fun reset() {
-        accumulatedPoints.clear()
-        frameCount = 0
+    /** Marching-cubes surface of the TSDF volume (serialized mesh); call after [finishFrames]. */
+    fun extractFusedMesh(): FloatArray? {
+        if (tsdfVolume == 0L) return null
+        return nativeMeshProcessor.tsdfVolumeExtractMesh(tsdfVolume)
     }
 
-    private fun flattenPoints(points: List<FloatArray>): FloatArray {
-        val flat = FloatArray(points.size * 3)
-        points.forEachIndexed { i, p ->
-            flat[i * 3] = p[0]
-            flat[i * 3 + 1] = p[1]
-            flat[i * 3 + 2] = p[2]
-        }
-        return flat
+    fun getQueueStats(): FrameQueueStats = depthFrameProcessor.getQueueStats()
+
+    /** Integrates the queued frames and stops the worker; the map stays readable. */
+    fun finishFrames() {
+        depthFrameProcessor.release()
+        if (voxelMap != 0L) voxelCount = nativeMeshProcessor.voxelMapSize(voxelMap)
     }
 
-    private fun unflattenPoints(flat: FloatArray): List<FloatArray> {
-        val points = mutableListOf<FloatArray>()
-        for (i in flat.indices step 3) {
-            points.add(floatArrayOf(flat[i], flat[i + 1], flat[i + 2]))
+    /** Frees the native map; a new one is created with the next frame. */
+    fun reset() {
+        depthFrameProcessor.release()
+        if (voxelMap != 0L) {
+            nativeMeshProcessor.releaseVoxelMap(voxelMap)
+            voxelMap = 0L
+        }
+        if (tsdfVolume != 0L) {
+            nativeMeshProcessor.releaseTSDFVolume(tsdfVolume)
+            tsdfVolume = 0L
+            File(context.cacheDir, TSDF_SPILL_FILE).delete()
         }
-        return points
+        voxelCount = 0
+        frameCount = 0
     }
 }
@@ -1,7 +1,6 @@
 package com.scanforge3d.scanning
 
 import com.google.ar.core.Frame
-import com.scanforge3d.data.model.PointCloud
 import com.scanforge3d.data.model.ScanMetadata
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.StateFlow
@@ -9,7 +8,6 @@ import java.util.UUID
 import javax.inject.Inject
 
 class ScanSessionController @Inject constructor(
-    private val depthFrameProcessor: DepthFrameProcessor,
     private val pointCloudAccumulator: PointCloudAccumulator
 ) {
     data class ScanState(
@@ -19,7 +17,11 @@ class ScanSessionController @Inject constructor(
         val frameCount: Int = 0,
         val surfaceCoverage: Float = 0f,
         val qualityScore: Float = 0f,
-        val qualityLabel: String = "---"
+        val qualityLabel: String = "---",
+        val queuedFrames: Int = 0,
+        val droppedFrames: Long = 0,
+        val frameDropRate: Float = 0f,
+        val rejectedFrames: Long = 0
     )
 
     private val _state = MutableStateFlow(ScanState())
@@ -44,27 +46,48 @@ class ScanSessionController @Inject constructor(
     fun processFrame(frame: Frame) {
         if (!_state.value.isScanning) return
 
-        val pointCloud = depthFrameProcessor.processFrame(frame) ?: return
-        pointCloudAccumulator.addFrame(pointCloud)
+        // Only queues the frame; integration runs on the native worker
+        pointCloudAccumulator.addFrame(frame)
 
         val pointCount = pointCloudAccumulator.getPointCount()
         val frameCount = pointCloudAccumulator.getFrameCount()
         val quality = estimateQuality(pointCount, frameCount)
+        val queueStats = pointCloudAccumulator.getQueueStats()
 
         _state.value = _state.value.copy(
             pointCount = pointCount,
             frameCount = frameCount,
             surfaceCoverage = estimateCoverage(pointCount),
             qualityScore = quality,
-            qualityLabel = qualityToLabel(quality)
+            qualityLabel = qualityToLabel(quality),
+            queuedFrames = queueStats.queued,
+            droppedFrames = queueStats.dropped,
+            frameDropRate = queueStats.dropRate,
+            rejectedFrames = queueStats.rejected
         )
     }
 
-    fun stopScan(): Array<FloatArray> {
+    /** Stops taking frames; cheap, so it can run on the main thread. */
+    fun stopScan() {
         _state.value = _state.value.copy(isScanning = false)
+    }
+
+    /**
+     * Integrates the frames still queued and returns the accumulated
+     * points as [x,y,z, ...]. Blocks until the worker is done; call
+     * after [stopScan], off the main thread.
+     */
+    fun finishScan(): FloatArray {
+        pointCloudAccumulator.finishFrames()
         return pointCloudAccumulator.getAccumulatedCloud()
     }
 
+    fun getAccumulatedConfidence(): FloatArray = pointCloudAccumulator.getAccumulatedConfidence()
+    fun getAccumulatedNormals(): FloatArray = pointCloudAccumulator.getAccumulatedNormals()
+    fun getAccumulatedFrameIds(): IntArray = pointCloudAccumulator.getAccumulatedFrameIds()
+    fun getCameraOrigins(): FloatArray = pointCloudAccumulator.getCameraOrigins()
+    fun extractFusedMesh(): FloatArray? = pointCloudAccumulator.extractFusedMesh()
+
     fun getScanId(): String = _state.value.scanId
 
     fun getMetadata(): ScanMetadata {
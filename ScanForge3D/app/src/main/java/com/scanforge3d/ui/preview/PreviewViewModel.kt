@@ -46,9 +46,16 @@ class PreviewViewModel @Inject constructor(
                 return@launch
             }
 
+            val viewpoints = scanRepository.loadViewpoints(scanId)
+
             try {
                 val result = pipeline.process(
                     pointsFlat = pointsFlat,
+                    confidence = scanRepository.loadPointConfidence(scanId),
+                    normals = scanRepository.loadPointNormals(scanId),
+                    frameIds = viewpoints?.first,
+                    cameraOrigins = viewpoints?.second,
+                    fusedMesh = scanRepository.loadFusedMesh(scanId),
                     callback = object : MeshProcessingPipeline.ProgressCallback {
                         override fun onProgress(step: String, progress: Float) {
                             _state.value = _state.value.copy(
@@ -15,7 +15,11 @@ import androidx.compose.ui.unit.dp
 fun ScanOverlay(
     pointCount: Int,
     coverage: Float,
-    quality: Float
+    quality: Float,
+    queuedFrames: Int = 0,
+    droppedFrames: Long = 0,
+    frameDropRate: Float = 0f,
+    rejectedFrames: Long = 0
 ) {
     Column(
         modifier = Modifier
@@ -45,6 +49,25 @@ fun ScanOverlay(
                 }
             )
         }
+
+        // Only once the depth worker falls behind or frames are unusable
+        if (droppedFrames > 0 || rejectedFrames > 0) {
+            Spacer(modifier = Modifier.height(8.dp))
+            Row(
+                modifier = Modifier
+                    .fillMaxWidth()
+                    .background(
+                        Color.Black.copy(alpha = 0.5f),
+                        RoundedCornerShape(8.dp)
+                    )
+                    .padding(12.dp),
+                horizontalArrangement = Arrangement.SpaceEvenly
+            ) {
+                OverlayMetric("Warteschlange", "$queuedFrames")
+                OverlayMetric("Verworfen", "${(frameDropRate * 100).toInt()}%")
+                OverlayMetric("Ungültig", "$rejectedFrames")
+            }
+        }
     }
 }
 
@@ -126,7 +126,11 @@ fun ScanScreen(
                 ScanOverlay(
                     pointCount = scanState.pointCount,
                     coverage = scanState.surfaceCoverage,
-                    quality = scanState.qualityScore
+                    quality = scanState.qualityScore,
+                    queuedFrames = scanState.queuedFrames,
+                    droppedFrames = scanState.droppedFrames,
+                    frameDropRate = scanState.frameDropRate,
+                    rejectedFrames = scanState.rejectedFrames
                 )
             }
 
@@ -7,6 +7,8 @@ import com.scanforge3d.data.repository.ProjectRepository
 import com.scanforge3d.data.repository.ScanRepository
 import com.scanforge3d.scanning.ScanSessionController
 import dagger.hilt.android.lifecycle.HiltViewModel
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.Job
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.StateFlow
 import kotlinx.coroutines.launch
@@ -27,7 +29,11 @@ class ScanViewModel @Inject constructor(
         val frameCount: Int = 0,
         val surfaceCoverage: Float = 0f,
         val qualityScore: Float = 0f,
-        val qualityLabel: String = "---"
+        val qualityLabel: String = "---",
+        val queuedFrames: Int = 0,
+        val droppedFrames: Long = 0,
+        val frameDropRate: Float = 0f,
+        val rejectedFrames: Long = 0
     )
 
     private val _scanState = MutableStateFlow(ScanUiState())
@@ -43,7 +49,11 @@ class ScanViewModel @Inject constructor(
                     frameCount = state.frameCount,
                     surfaceCoverage = state.surfaceCoverage,
                     qualityScore = state.qualityScore,
-                    qualityLabel = state.qualityLabel
+                    qualityLabel = state.qualityLabel,
+                    queuedFrames = state.queuedFrames,
+                    droppedFrames = state.droppedFrames,
+                    frameDropRate = state.frameDropRate,
+                    rejectedFrames = state.rejectedFrames
                 )
             }
         }
@@ -53,29 +63,50 @@ class ScanViewModel @Inject constructor(
         scanSessionController.processFrame(frame)
     }
 
+    // Draining the worker and saving the last scan
+    private var finishJob: Job? = null
+
     fun startScan() {
-        scanSessionController.startScan()
+        // A new scan resets the map, so it waits until the last one is saved
+        val previous = finishJob
+        if (previous == null || previous.isCompleted) {
+            scanSessionController.startScan()
+            return
+        }
+        viewModelScope.launch {
+            previous.join()
+            scanSessionController.startScan()
+        }
     }
 
     fun stopScan() {
-        val points = scanSessionController.stopScan()
+        scanSessionController.stopScan()
         val scanId = scanSessionController.getScanId()
 
-        viewModelScope.launch {
-            // Flatten and save point cloud
-            val flat = FloatArray(points.size * 3)
-            points.forEachIndexed { i, p ->
-                flat[i * 3] = p[0]
-                flat[i * 3 + 1] = p[1]
-                flat[i * 3 + 2] = p[2]
+        // The queued frames, the readback and the marching cubes over the
+        // whole volume take seconds on a large scan
+        finishJob = viewModelScope.launch(Dispatchers.Default) {
+            val points = scanSessionController.finishScan()
+            val confidence = scanSessionController.getAccumulatedConfidence()
+            val normals = scanSessionController.getAccumulatedNormals()
+            val frameIds = scanSessionController.getAccumulatedFrameIds()
+            val cameraOrigins = scanSessionController.getCameraOrigins()
+            val fusedMesh = scanSessionController.extractFusedMesh()
+
+            // Save point cloud (already flat)
+            scanRepository.savePointCloud(scanId, points)
+            scanRepository.savePointConfidence(scanId, confidence)
+            scanRepository.saveViewpoints(scanId, frameIds, cameraOrigins)
+            if (normals.isNotEmpty()) scanRepository.savePointNormals(scanId, normals)
+            if (fusedMesh != null && fusedMesh[0] > 0f) {
+                scanRepository.saveFusedMesh(scanId, fusedMesh)
             }
-            scanRepository.savePointCloud(scanId, flat)
 
             // Create project entry
             val project = ScanProject(
                 id = scanId,
                 name = "Scan ${System.currentTimeMillis()}",
-                pointCount = points.size
+                pointCount = points.size / 3
             )
             projectRepository.saveProject(project)
         }
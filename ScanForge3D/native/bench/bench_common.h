@@ -0,0 +1,147 @@
+#pragma once
+#include "point_cloud/point_cloud.h"
+#include "util/math_utils.h"
+#include "util/normal_equations6.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+namespace scanforge {
+namespace bench {
+
+class Stopwatch {
+public:
+    Stopwatch() : start_(std::chrono::steady_clock::now()) {}
+    void reset() { start_ = std::chrono::steady_clock::now(); }
+    double elapsedMs() const {
+        auto d = std::chrono::steady_clock::now() - start_;
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Runs fn `reps` times and returns the best wall-clock time in ms
+template <typename Fn>
+double bestOf(int reps, Fn&& fn) {
+    double best = 1e30;
+    for (int r = 0; r < reps; r++) {
+        Stopwatch sw;
+        fn();
+        best = std::min(best, sw.elapsedMs());
+    }
+    return best;
+}
+
+// Scan-like cloud: noisy samples on a sphere (r = 15 cm) resting on a
+// table plane, roughly what ARCore depth gives for a small object.
+inline PointCloud makeScanCloud(size_t n, unsigned seed = 42, float noise = 0.001f) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    std::normal_distribution<float> g(0.0f, noise);
+
+    PointCloud cloud;
+    cloud.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        if (i % 3 == 0) {
+            // Table plane, 60 x 60 cm
+            cloud.addPoint({u(rng) * 0.6f - 0.3f, g(rng), u(rng) * 0.6f - 0.3f});
+        } else {
+            float z = u(rng) * 2.0f - 1.0f;
+            float phi = u(rng) * 6.2831853f;
+            float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+            float radius = 0.15f + g(rng);
+            cloud.addPoint({radius * r * std::cos(phi),
+                            0.15f + radius * z,
+                            radius * r * std::sin(phi)});
+        }
+    }
+    return cloud;
+}
+
+// Registration scene: a table with a sphere (r = 12 cm) and a box on it,
+// so all six degrees of freedom are constrained. scale enlarges the
+// geometry (not the noise) for large parts.
+inline PointCloud makeSceneCloud(size_t n, unsigned seed = 42, float scale = 1.0f,
+                                 float noise = 0.001f) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    std::normal_distribution<float> g(0.0f, noise);
+    PointCloud cloud;
+    cloud.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        int part = i % 4;
+        Vec3f p;
+        if (part == 0) {
+            // Table, 60 x 60 cm
+            p = Vec3f(u(rng) * 0.6f - 0.3f, 0.0f, u(rng) * 0.6f - 0.3f) * scale;
+            p.y += g(rng);
+        } else if (part == 3) {
+            // Box [0.17, 0.29] x [0, 0.12] x [-0.29, -0.17], one face at a time
+            float a = u(rng), b = u(rng);
+            Vec3f n;
+            switch (static_cast<int>(u(rng) * 5)) {
+                case 0: p = {0.17f, a * 0.12f, -0.29f + b * 0.12f}; n = {-1, 0, 0}; break;
+                case 1: p = {0.29f, a * 0.12f, -0.29f + b * 0.12f}; n = {1, 0, 0}; break;
+                case 2: p = {0.17f + a * 0.12f, b * 0.12f, -0.17f}; n = {0, 0, 1}; break;
+                case 3: p = {0.17f + a * 0.12f, b * 0.12f, -0.29f}; n = {0, 0, -1}; break;
+                default: p = {0.17f + a * 0.12f, 0.12f, -0.29f + b * 0.12f}; n = {0, 1, 0}; break;
+            }
+            p = p * scale + n * g(rng);
+        } else {
+            float z = u(rng) * 2.0f - 1.0f;
+            float phi = u(rng) * 6.2831853f;
+            float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+            Vec3f dir(r * std::cos(phi), z, r * std::sin(phi));
+            p = Vec3f(0, 0.12f * scale, 0) + dir * (0.12f * scale + g(rng));
+        }
+        cloud.addPoint(p);
+    }
+    return cloud;
+}
+
+// Column-major rigid motion from a twist (rotation vector, translation)
+inline Mat4f twistMotion(const double x[6]) {
+    float R[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+    Vec3f t(0, 0, 0);
+    applyTwist(x, R, t);
+    return {R[0], R[3], R[6], 0, R[1], R[4], R[7], 0, R[2], R[5], R[8], 0, t.x, t.y, t.z, 1};
+}
+
+inline Vec3f transformPoint(const float* m, const Vec3f& p) {
+    return Vec3f(m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12],
+                 m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13],
+                 m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14]);
+}
+
+inline PointCloud transformCloud(const PointCloud& cloud, const float* m) {
+    PointCloud out;
+    out.reserve(cloud.size());
+    for (size_t i = 0; i < cloud.size(); i++) out.addPoint(transformPoint(m, cloud.getPoint(i)));
+    return out;
+}
+
+// Mean distance (mm) between the source points mapped by an estimated
+// motion and their true positions
+inline float poseErrorMm(const PointCloud& source, const PointCloud& truth, const float* m) {
+    double sum = 0;
+    for (size_t i = 0; i < source.size(); i++) {
+        sum += transformPoint(m, source.getPoint(i)).distanceTo(truth.getPoint(i));
+    }
+    return static_cast<float>(sum / source.size() * 1000.0);
+}
+
+// Uniform random points in a cube of the given edge length
+inline PointCloud makeUniformCloud(size_t n, float extent = 1.0f, unsigned seed = 7) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(0.0f, extent);
+    PointCloud cloud;
+    cloud.reserve(n);
+    for (size_t i = 0; i < n; i++) cloud.addPoint({u(rng), u(rng), u(rng)});
+    return cloud;
+}
+
+} // namespace bench
+} // namespace scanforge
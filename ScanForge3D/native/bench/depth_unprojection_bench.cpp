@@ -0,0 +1,102 @@
+// One 640x360 depth frame (ARCore raw depth size) to world points: the
+// previous per-pixel loop with one heap array per point, the SIMD
+// DepthUnprojection into reused buffers, and the full native
+// integration (points + organized normals + voxel map) for scale.
+#include "bench_common.h"
+#include "point_cloud/depth_frame_integrator.h"
+#include "point_cloud/depth_unprojection.h"
+#include "point_cloud/voxel_map.h"
+#include <memory>
+#include <vector>
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+// Mirrors the former Kotlin loop: scalar, one allocation per point
+static size_t perPointLoop(const DepthImage& image, const float* m, int stride,
+                           std::vector<std::unique_ptr<float[]>>& points,
+                           std::vector<float>& confidences) {
+    points.clear();
+    confidences.clear();
+    const DepthIntrinsics& in = image.intrinsics;
+    for (int y = 0; y < image.height; y += stride) {
+        for (int x = 0; x < image.width; x += stride) {
+            int confidence = image.confidence[y * image.confidence_row_stride + x];
+            if (confidence < 200) continue;
+            float d = image.depth_mm[y * image.depth_row_stride + x] / 1000.0f;
+            if (d < 0.1f || d > 3.0f) continue;
+            float lx = (x - in.cx) / in.fx * d, ly = (y - in.cy) / in.fy * d, lz = -d;
+            std::unique_ptr<float[]> p(new float[3]);
+            p[0] = m[0] * lx + m[4] * ly + m[8] * lz + m[12];
+            p[1] = m[1] * lx + m[5] * ly + m[9] * lz + m[13];
+            p[2] = m[2] * lx + m[6] * ly + m[10] * lz + m[14];
+            confidences.push_back(confidence / 255.0f);
+            points.push_back(std::move(p));
+        }
+    }
+    return points.size();
+}
+
+int main() {
+    const int width = 640, height = 360;
+    std::vector<uint16_t> depth(width * height);
+    std::vector<uint8_t> confidence(width * height);
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> conf(120, 255);
+    for (int v = 0; v < height; v++) {
+        for (int u = 0; u < width; u++) {
+            // Tilted wall 0.5 .. 2.5 m with a few holes
+            float d = 0.5f + 2.0f * u / width + 0.3f * v / height;
+            depth[v * width + u] = (u * 7 + v * 13) % 97 == 0 ? 0 : static_cast<uint16_t>(d * 1000);
+            confidence[v * width + u] = static_cast<uint8_t>(conf(rng));
+        }
+    }
+    DepthImage image;
+    image.depth_mm = depth.data();
+    image.depth_row_stride = width;
+    image.confidence = confidence.data();
+    image.confidence_row_stride = width;
+    image.width = width;
+    image.height = height;
+    image.intrinsics = DepthIntrinsics{450.0f, 450.0f, 320.0f, 180.0f};
+    const float pose[16] = {0.8f, 0.0f, -0.6f, 0, 0, 1, 0, 0, 0.6f, 0.0f, 0.8f, 0, 0.1f, 1.2f, -0.3f, 1};
+
+    std::printf("%dx%d frame\n\n", width, height);
+    std::printf("%-34s %8s %10s\n", "", "stride", "time");
+    for (int stride : {1, 4}) {
+        std::vector<std::unique_ptr<float[]>> points;
+        std::vector<float> confidences;
+        size_t n_ref = 0;
+        double ref_ms = bestOf(20, [&] { n_ref = perPointLoop(image, pose, stride, points, confidences); });
+
+        DepthUnprojection unprojection;
+        unprojection.setDepthRange(0.1f, 3.0f);
+        unprojection.setMinConfidence(200);
+        size_t n = 0;
+        double simd_ms = bestOf(20, [&] { n = unprojection.unproject(image, pose, stride); });
+
+        // Same points, same order
+        double max_diff = 0;
+        for (size_t i = 0; i < std::min(n, n_ref); i++) {
+            for (int a = 0; a < 3; a++) {
+                max_diff = std::max(max_diff, static_cast<double>(
+                    std::fabs(points[i][a] - unprojection.points()[i * 3 + a])));
+            }
+        }
+
+        std::printf("%-34s %8d %7.3f ms  (%zu points)\n", "per-point loop, heap per point",
+                    stride, ref_ms, n_ref);
+        std::printf("%-34s %8d %7.3f ms  (%zu points, max diff %.1e m)\n",
+                    "DepthUnprojection", stride, simd_ms, n, max_diff);
+    }
+
+    DepthFrameIntegrator integrator;
+    integrator.setDepthRange(0.1f, 3.0f);
+    integrator.setMinConfidence(200);
+    VoxelMap map(0.002f);
+    int frame = 0;
+    double integrate_ms = bestOf(20, [&] { integrator.integrate(image, pose, 4, frame++, map); });
+    std::printf("\n%-34s %8d %7.3f ms  (incl. normals + voxel map)\n",
+                "DepthFrameIntegrator::integrate", 4, integrate_ms);
+    return 0;
+}
@@ -0,0 +1,237 @@
+// Closed-form smallest eigenvector (smallestEigenvector) vs the Jacobi
+// iteration NormalEstimation used before: accuracy on covariances of
+// typical and degenerate neighborhoods, and throughput.
+#include "bench_common.h"
+#include "util/symmetric_eigen3.h"
+#include <algorithm>
+#include <vector>
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+// Reference: the previous NormalEstimation::eigenDecomposition3x3
+static void jacobiEigen3x3(const float A[9], float eigenvalues[3], float eigenvectors[9]) {
+    // Jacobi eigenvalue algorithm for 3x3 symmetric matrix
+    // A is stored row-major: A[row*3 + col]
+    // eigenvectors stored column-major: V[row*3 + col] = col-th eigenvector's row component
+
+    // Work on a copy
+    float S[9];
+    for (int i = 0; i < 9; i++) S[i] = A[i];
+
+    // Initialize V to identity
+    for (int i = 0; i < 9; i++) eigenvectors[i] = 0;
+    eigenvectors[0] = eigenvectors[4] = eigenvectors[8] = 1.0f;
+
+    const int max_iter = 50;
+
+    for (int iter = 0; iter < max_iter; iter++) {
+        // Find largest off-diagonal element
+        int p = 0, q = 1;
+        float max_val = std::abs(S[1]);
+        if (std::abs(S[2]) > max_val) { p = 0; q = 2; max_val = std::abs(S[2]); }
+        if (std::abs(S[5]) > max_val) { p = 1; q = 2; max_val = std::abs(S[5]); }
+
+        if (max_val < 1e-10f) break; // Converged
+
+        // Compute rotation angle
+        float app = S[p * 3 + p];
+        float aqq = S[q * 3 + q];
+        float apq = S[p * 3 + q];
+
+        float theta;
+        if (std::abs(app - aqq) < 1e-12f) {
+            theta = 3.14159265f / 4.0f;
+        } else {
+            theta = 0.5f * std::atan2(2.0f * apq, app - aqq);
+        }
+
+        float c = std::cos(theta);
+        float s = std::sin(theta);
+
+        // Apply Jacobi rotation: S' = G^T * S * G
+        // Only update affected rows/columns
+        float new_S[9];
+        for (int i = 0; i < 9; i++) new_S[i] = S[i];
+
+        new_S[p * 3 + p] = c * c * app + 2 * c * s * apq + s * s * aqq;
+        new_S[q * 3 + q] = s * s * app - 2 * c * s * apq + c * c * aqq;
+        new_S[p * 3 + q] = 0;
+        new_S[q * 3 + p] = 0;
+
+        // Update the third row/column (r != p, r != q)
+        int r = 3 - p - q; // the remaining index
+        float srp = S[r * 3 + p];
+        float srq = S[r * 3 + q];
+        new_S[r * 3 + p] = c * srp + s * srq;
+        new_S[p * 3 + r] = new_S[r * 3 + p];
+        new_S[r * 3 + q] = -s * srp + c * srq;
+        new_S[q * 3 + r] = new_S[r * 3 + q];
+
+        for (int i = 0; i < 9; i++) S[i] = new_S[i];
+
+        // Update eigenvectors: V' = V * G
+        for (int i = 0; i < 3; i++) {
+            float vip = eigenvectors[i * 3 + p];
+            float viq = eigenvectors[i * 3 + q];
+            eigenvectors[i * 3 + p] = c * vip + s * viq;
+            eigenvectors[i * 3 + q] = -s * vip + c * viq;
+        }
+    }
+
+    // Extract eigenvalues from diagonal
+    float evals[3] = { S[0], S[4], S[8] };
+    // Sort by ascending eigenvalue
+    int order[3] = {0, 1, 2};
+    if (evals[order[0]] > evals[order[1]]) std::swap(order[0], order[1]);
+    if (evals[order[1]] > evals[order[2]]) std::swap(order[1], order[2]);
+    if (evals[order[0]] > evals[order[1]]) std::swap(order[0], order[1]);
+
+    eigenvalues[0] = evals[order[0]];
+    eigenvalues[1] = evals[order[1]];
+    eigenvalues[2] = evals[order[2]];
+
+    // Reorder eigenvectors (stored as columns)
+    float sorted_V[9];
+    for (int i = 0; i < 3; i++) {
+        // Column j of sorted_V = column order[j] of eigenvectors
+        for (int row = 0; row < 3; row++) {
+            sorted_V[row * 3 + i] = eigenvectors[row * 3 + order[i]];
+        }
+    }
+    for (int i = 0; i < 9; i++) eigenvectors[i] = sorted_V[i];
+}
+
+
+static SymMat3 covariance(const std::vector<Vec3f>& pts) {
+    Vec3f c;
+    for (const Vec3f& p : pts) c = c + p;
+    c = c / static_cast<float>(pts.size());
+    SymMat3 m{0, 0, 0, 0, 0, 0};
+    for (const Vec3f& p : pts) {
+        Vec3f d = p - c;
+        m.xx += d.x * d.x; m.xy += d.x * d.y; m.xz += d.x * d.z;
+        m.yy += d.y * d.y; m.yz += d.y * d.z; m.zz += d.z * d.z;
+    }
+    return m;
+}
+
+// Random rotation applied to local (u, v, w) samples
+struct Frame {
+    Vec3f u, v, w;
+    explicit Frame(std::mt19937& rng) {
+        std::normal_distribution<float> g(0.0f, 1.0f);
+        w = Vec3f(g(rng), g(rng), g(rng)).normalized();
+        Vec3f t = std::fabs(w.x) < 0.9f ? Vec3f(1, 0, 0) : Vec3f(0, 1, 0);
+        u = w.cross(t).normalized();
+        v = w.cross(u);
+    }
+    Vec3f at(float a, float b, float c) const { return u * a + v * b + w * c; }
+};
+
+// k = 15 neighborhoods at 2 mm spacing: sx, sy = in-plane spread,
+// sz = thickness (noise) along w, offset = distance from the origin
+static std::vector<SymMat3> makeCases(size_t count, float sx, float sy, float sz,
+                                      std::vector<Vec3f>* axes, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> g(0.0f, 1.0f);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<SymMat3> out;
+    for (size_t c = 0; c < count; c++) {
+        Frame f(rng);
+        Vec3f offset(u(rng), u(rng), u(rng));
+        std::vector<Vec3f> pts;
+        for (int j = 0; j < 15; j++) {
+            pts.push_back(offset + f.at(sx * g(rng), sy * g(rng), sz * g(rng)));
+        }
+        out.push_back(covariance(pts));
+        axes->push_back(f.w);
+    }
+    return out;
+}
+
+int main() {
+    struct Case { const char* name; float sx, sy, sz; };
+    const Case cases[] = {
+        {"plane, 0.05 mm noise", 0.004f, 0.004f, 0.00005f},
+        {"plane, 0.5 mm noise", 0.004f, 0.004f, 0.0005f},
+        {"strip (4:1)", 0.004f, 0.001f, 0.0001f},
+        {"line", 0.004f, 0.0f, 0.0f},
+        {"exact plane", 0.004f, 0.004f, 0.0f},
+        {"isotropic blob", 0.002f, 0.002f, 0.002f},
+    };
+
+    std::printf("Accuracy vs Jacobi (angle between smallest eigenvectors, sign-free)\n");
+    std::printf("%-22s %12s %12s %12s %14s\n", "neighborhood", "median [deg]",
+                "p99 [deg]", "max [deg]", "lambda rel err");
+    std::vector<SymMat3> all;
+    unsigned seed = 1;
+    for (const Case& c : cases) {
+        std::vector<Vec3f> axes;
+        std::vector<SymMat3> mats = makeCases(20000, c.sx, c.sy, c.sz, &axes, seed++);
+        std::vector<double> angles;
+        double max_lambda_err = 0;
+        for (const SymMat3& m : mats) {
+            float a[9] = {m.xx, m.xy, m.xz, m.xy, m.yy, m.yz, m.xz, m.yz, m.zz};
+            float evals[3], evecs[9];
+            jacobiEigen3x3(a, evals, evecs);
+            Vec3f ref(evecs[0], evecs[3], evecs[6]);
+            Vec3f v;
+            float lambda;
+            smallestEigenvector(m, v, &lambda);
+            Vec3f r = ref.normalized();
+            angles.push_back(std::atan2(r.cross(v).length(), std::fabs(r.dot(v))) * 57.29578);
+            double scale = std::max(std::fabs(evals[2]), 1e-30f);
+            max_lambda_err = std::max(max_lambda_err, std::fabs(lambda - evals[0]) / scale);
+        }
+        std::sort(angles.begin(), angles.end());
+        bool defined = c.sy > 0 && c.sz < c.sx;  // unique smallest eigenvector
+        std::printf("%-22s %12.4f %12.4f %12.4f %14.2e%s\n", c.name,
+                    angles[angles.size() / 2], angles[angles.size() * 99 / 100],
+                    angles.back(), max_lambda_err, defined ? "" : "  (not unique)");
+        all.insert(all.end(), mats.begin(), mats.end());
+    }
+
+    // Throughput on realistic (noisy plane) covariances
+    std::vector<Vec3f> axes;
+    std::vector<SymMat3> mats = makeCases(2000000, 0.004f, 0.004f, 0.0003f, &axes, 99);
+    size_t n = mats.size();
+    std::vector<float> xx(n), xy(n), xz(n), yy(n), yz(n), zz(n);
+    for (size_t i = 0; i < n; i++) {
+        xx[i] = mats[i].xx; xy[i] = mats[i].xy; xz[i] = mats[i].xz;
+        yy[i] = mats[i].yy; yz[i] = mats[i].yz; zz[i] = mats[i].zz;
+    }
+    std::vector<float> nx(n), ny(n), nz(n);
+    float sink = 0;
+
+    double jacobi_ms = bestOf(2, [&] {
+        for (size_t i = 0; i < n; i++) {
+            const SymMat3& m = mats[i];
+            float a[9] = {m.xx, m.xy, m.xz, m.xy, m.yy, m.yz, m.xz, m.yz, m.zz};
+            float evals[3], evecs[9];
+            jacobiEigen3x3(a, evals, evecs);
+            nx[i] = evecs[0];
+        }
+    });
+    double closed_ms = bestOf(3, [&] {
+        for (size_t i = 0; i < n; i++) {
+            Vec3f v;
+            smallestEigenvector(mats[i], v);
+            nx[i] = v.x;
+        }
+    });
+    double batch_ms = bestOf(3, [&] {
+        smallestEigenvectors({xx.data(), xy.data(), xz.data(), yy.data(), yz.data(), zz.data()},
+                             n, nx.data(), ny.data(), nz.data());
+    });
+    for (size_t i = 0; i < n; i += 4096) sink += nx[i];
+
+    std::printf("\nThroughput, %zu noisy-plane covariances (%.0f)\n", n, sink * 0);
+    auto row = [n](const char* name, double ms) {
+        std::printf("%-28s %10.1f ms %10.1f M/s\n", name, ms, n / ms / 1000.0);
+    };
+    row("Jacobi (previous)", jacobi_ms);
+    row("closed form, AoS loop", closed_ms);
+    row("closed form, SoA batch", batch_ms);
+    return 0;
+}
@@ -0,0 +1,111 @@
+// Producer-side cost of a 640x360 depth frame: integrating it inline on
+// the camera thread vs submitting it to DepthFrameWorker, plus the
+// worker's queue behavior when frames arrive faster than it drains them.
+#include "bench_common.h"
+#include "point_cloud/depth_frame_integrator.h"
+#include "point_cloud/depth_frame_worker.h"
+#include "point_cloud/voxel_map.h"
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+int main() {
+    const int width = 640, height = 360, stride = 2, frames = 120;
+    std::vector<uint16_t> depth(width * height);
+    std::vector<uint8_t> confidence(width * height);
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> conf(150, 255);
+    for (int v = 0; v < height; v++) {
+        for (int u = 0; u < width; u++) {
+            float d = 0.5f + 1.5f * u / width + 0.3f * v / height;
+            depth[v * width + u] = static_cast<uint16_t>(d * 1000);
+            confidence[v * width + u] = static_cast<uint8_t>(conf(rng));
+        }
+    }
+    DepthImage image;
+    image.depth_mm = depth.data();
+    image.depth_row_stride = width;
+    image.confidence = confidence.data();
+    image.confidence_row_stride = width;
+    image.width = width;
+    image.height = height;
+    image.intrinsics = DepthIntrinsics{450.0f, 450.0f, 320.0f, 180.0f};
+
+    // Camera swaying sideways over 1 cm and back
+    auto poseOf = [](int frame, float* m) {
+        const float identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+        std::copy(identity, identity + 16, m);
+        m[12] = 0.0005f * std::abs(frame % 40 - 20);
+    };
+    float pose[16];
+
+    std::printf("%dx%d frame, stride %d, %d frames\n\n", width, height, stride, frames);
+
+    // Inline: the camera thread does the whole integration
+    VoxelMap inline_map(0.002f);
+    DepthFrameIntegrator integrator;
+    double max_inline = 0;
+    Stopwatch total_inline;
+    for (int f = 0; f < frames; f++) {
+        poseOf(f, pose);
+        Stopwatch sw;
+        integrator.integrate(image, pose, stride, f, inline_map);
+        max_inline = std::max(max_inline, sw.elapsedMs());
+    }
+    double inline_ms = total_inline.elapsedMs();
+    std::printf("%-40s %8.3f ms/frame (max %.3f)\n", "inline integrate on camera thread",
+                inline_ms / frames, max_inline);
+
+    // Worker, producer paced slower than the worker: nothing is dropped,
+    // and the map must match the inline one
+    {
+        VoxelMap map(0.002f);
+        DepthFrameWorker worker(map, 4, width * height);
+        worker.start();
+        double submit_total = 0, submit_max = 0;
+        const auto period = std::chrono::microseconds(static_cast<int>(inline_ms / frames * 1500));
+        for (int f = 0; f < frames; f++) {
+            poseOf(f, pose);
+            Stopwatch sw;
+            worker.submit(image, pose, stride, f);
+            double ms = sw.elapsedMs();
+            submit_total += ms;
+            submit_max = std::max(submit_max, ms);
+            std::this_thread::sleep_for(period);
+        }
+        worker.stop();
+        DepthFrameWorkerStats s = worker.stats();
+        std::printf("%-40s %8.3f ms/frame (max %.3f)\n", "submit, producer at 1.5x integrate time",
+                    submit_total / frames, submit_max);
+        std::printf("%-40s %llu integrated, %llu dropped, %zu voxels (inline %zu)\n", "",
+                    (unsigned long long)s.integrated, (unsigned long long)s.dropped,
+                    map.size(), inline_map.size());
+    }
+
+    // Worker, producer as fast as it can: the ring fills and frames drop
+    for (size_t capacity : {2, 8}) {
+        VoxelMap map(0.002f);
+        DepthFrameWorker worker(map, capacity, width * height);
+        worker.start();
+        double submit_total = 0;
+        size_t max_queued = 0;
+        for (int f = 0; f < frames; f++) {
+            poseOf(f, pose);
+            Stopwatch sw;
+            worker.submit(image, pose, stride, f);
+            submit_total += sw.elapsedMs();
+            max_queued = std::max(max_queued, worker.stats().queued);
+        }
+        worker.stop();
+        DepthFrameWorkerStats s = worker.stats();
+        char name[64];
+        std::snprintf(name, sizeof(name), "submit, unpaced producer, %zu slots", capacity);
+        std::printf("%-40s %8.3f ms/frame, max queued %zu, drop rate %.1f%%\n", name,
+                    submit_total / frames, max_queued, 100.0 * s.dropRate());
+    }
+    return 0;
+}
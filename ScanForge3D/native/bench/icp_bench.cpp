@@ -0,0 +1,109 @@
+// Exact vs approximate nearest-neighbor search, alone and as ICP
+// correspondence search with the epsilon schedule.
+#include "bench_common.h"
+#include "point_cloud/icp_registration.h"
+#include "point_cloud/voxel_grid_filter.h"
+#include "util/kdtree.h"
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+// Rotation about x by angle, then translation t
+static PointCloud transformed(const PointCloud& in, float angle, const Vec3f& t) {
+    float c = std::cos(angle), s = std::sin(angle);
+    PointCloud out;
+    out.reserve(in.size());
+    for (const Vec3f& p : in.getPoints()) {
+        out.addPoint({p.x + t.x, c * p.y - s * p.z + t.y, s * p.y + c * p.z + t.z});
+    }
+    return out;
+}
+
+// Mean distance between source points mapped by the estimate and their
+// true positions in the target frame
+static float poseError(const PointCloud& source, const PointCloud& truth,
+                       const ICPResult& r) {
+    const auto& m = r.transformation;
+    double sum = 0;
+    for (size_t i = 0; i < source.size(); i++) {
+        const Vec3f& p = source.getPoint(i);
+        Vec3f q(m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12],
+                m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13],
+                m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14]);
+        sum += q.distanceTo(truth.getPoint(i));
+    }
+    return static_cast<float>(sum / source.size());
+}
+
+int main() {
+    // Raw NN queries on a 1M point cloud
+    PointCloud cloud = makeScanCloud(1000000);
+    KDTree tree;
+    tree.build(cloud);
+    PointCloud queries = makeScanCloud(200000, 1234, 0.004f);
+
+    std::vector<int> exact(queries.size());
+    double exact_ms = bestOf(3, [&] {
+        for (size_t i = 0; i < queries.size(); i++) exact[i] = tree.findNearest(queries.getPoint(i));
+    });
+
+    std::printf("%-8s %8s %12s %14s %14s\n", "epsilon", "leaves", "200k NN [ms]",
+                "mean ratio", "max ratio");
+    std::printf("%-8s %8s %12.1f %14.4f %14.4f\n", "exact", "-", exact_ms, 1.0, 1.0);
+    struct Setting { float eps; int leaves; };
+    for (Setting st : {Setting{0.5f, 0}, Setting{1.0f, 0}, Setting{2.0f, 0},
+                       Setting{1.0f, 8}, Setting{1.0f, 4}, Setting{1.0f, 2}}) {
+        std::vector<int> approx(queries.size());
+        double ms = bestOf(3, [&] {
+            for (size_t i = 0; i < queries.size(); i++) {
+                approx[i] = tree.findNearestApprox(queries.getPoint(i), st.eps, st.leaves);
+            }
+        });
+        double sum = 0, worst = 1.0;
+        for (size_t i = 0; i < queries.size(); i++) {
+            const Vec3f& q = queries.getPoint(i);
+            float de = q.distanceTo(cloud.getPoint(exact[i]));
+            float da = q.distanceTo(cloud.getPoint(approx[i]));
+            double ratio = de > 0 ? da / de : 1.0;
+            sum += ratio;
+            worst = std::max(worst, ratio);
+            if (st.leaves == 0 && ratio > 1.0 + st.eps + 1e-4) {
+                std::printf("BOUND VIOLATED at %zu: %.4f\n", i, ratio);
+                return 1;
+            }
+        }
+        std::printf("%-8.2f %8d %12.1f %14.4f %14.4f\n", st.eps, st.leaves, ms,
+                    sum / queries.size(), worst);
+    }
+
+    // ICP: target is a voxelized scan, source a second noisy scan of the
+    // same scene moved by 4 degrees and 1.5 cm
+    PointCloud target = VoxelGridFilter(0.002f).apply(makeScanCloud(1500000, 42));
+    PointCloud source_truth = VoxelGridFilter(0.004f).apply(makeScanCloud(600000, 7));
+    float angle = 4.0f * 3.14159265f / 180.0f;
+    Vec3f offset(0.015f, -0.005f, 0.01f);
+    PointCloud source = transformed(source_truth, -angle, {0, 0, 0});
+    source = transformed(source, 0, offset * -1.0f);
+
+    std::printf("\nICP: %zu source -> %zu target points\n", source.size(), target.size());
+    struct Schedule { const char* name; float eps; int leaves; };
+    const Schedule schedules[] = {{"exact", 0.0f, 0},
+                                  {"eps 1.0", 1.0f, 0},
+                                  {"eps 2.0", 2.0f, 0},
+                                  {"eps 1.0 / 4 lv", 1.0f, 4},
+                                  {"eps 2.0 / 2 lv", 2.0f, 2}};
+    // tolerance 0 runs every iteration, 1e-6 is the app default
+    for (float tol : {0.0f, 1e-6f}) {
+        std::printf("%-16s %6s %10s %6s %12s %14s\n", "schedule", "tol", "time [ms]",
+                    "iters", "final RMSE", "pose err [mm]");
+        for (const Schedule& sc : schedules) {
+            ICPRegistration icp(30, tol);
+            icp.setApproximateSearch(sc.eps, sc.leaves);
+            ICPResult r;
+            double ms = bestOf(1, [&] { r = icp.align(source, target); });
+            std::printf("%-16s %6.0e %10.1f %6d %12.6f %14.3f\n", sc.name, tol, ms,
+                        r.iterations, r.rmse, poseError(source, source_truth, r) * 1000.0f);
+        }
+    }
+    return 0;
+}
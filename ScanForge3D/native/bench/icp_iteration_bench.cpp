@@ -0,0 +1,56 @@
+// Per-iteration cost of ICPRegistration at 200k source points: runs of
+// 1 and 11 iterations (tolerance 0), so the difference / 10 excludes the
+// KD-tree build and the final fitness pass. Against a 2 mm target the
+// nearest-neighbor search dominates; against a 16 mm one (a few thousand
+// points) it is cheap and the rest of the loop shows. For reference the
+// plain search for the same points, in their original (unsorted) order,
+// is timed alone.
+#include "bench_common.h"
+#include "point_cloud/icp_registration.h"
+#include "point_cloud/normal_estimation.h"
+#include "point_cloud/voxel_grid_filter.h"
+#include "util/kdtree.h"
+#include "util/parallel.h"
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+int main() {
+    PointCloud scene = makeSceneCloud(1200000, 42);
+    PointCloud truth = makeSceneCloud(200000, 7);
+    const double x[6] = {0.03, 0.03, 0.02, 0.008, -0.006, 0.008};
+    Mat4f m = twistMotion(x);
+    PointCloud source = transformCloud(truth, rigidInverse4x4(m.data()).data());
+    std::printf("%zu source points, %d hardware threads\n\n", source.size(), hardwareThreads());
+
+    std::printf("%-8s %8s %-16s %11s %10s %14s\n", "target", "points", "method", "search [ms]",
+                "ms/iter", "pose err [mm]");
+    for (float voxel : {0.002f, 0.016f}) {
+        PointCloud target = VoxelGridFilter(voxel).apply(scene);
+        target.setNormals(NormalEstimation(15).estimate(target));
+
+        KDTree tree;
+        tree.build(target);
+        std::vector<int> nearest(source.size());
+        double search_ms = bestOf(5, [&] {
+            parallelFor(0, source.size(), [&](size_t begin, size_t end, int) {
+                for (size_t i = begin; i < end; i++) nearest[i] = tree.findNearest(source.getPoint(i));
+            }, 1024);
+        });
+
+        for (bool plane : {false, true}) {
+            double ms[2];
+            ICPResult r;
+            for (int k = 0; k < 2; k++) {
+                ICPRegistration icp(k == 0 ? 1 : 11, 0.0f);
+                icp.setPointToPlane(plane);
+                ms[k] = bestOf(5, [&] { r = icp.align(source, target); });
+            }
+            std::printf("%5.0f mm %8zu %-16s %11.1f %10.2f %14.3f\n", voxel * 1000.0f,
+                        target.size(), plane ? "point-to-plane" : "point-to-point", search_ms,
+                        (ms[1] - ms[0]) / 10.0,
+                        poseErrorMm(source, truth, r.transformation.data()));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Streaming inserts into IncrementalKDTree, the way PointCloudAccumulator
+// grows its map: 50k-point frames that sweep around the object.
+#include "bench_common.h"
+#include "util/incremental_kdtree.h"
+#include "util/kdtree.h"
+#include <cmath>
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+int main() {
+    const size_t frame_size = 50000;
+    const size_t total = 2000000;
+
+    // Order points by azimuth so each frame covers one view direction,
+    // like a user walking around the object
+    PointCloud raw = makeScanCloud(total);
+    std::vector<Vec3f> points = raw.getPoints();
+    std::sort(points.begin(), points.end(), [](const Vec3f& a, const Vec3f& b) {
+        return std::atan2(a.z, a.x) < std::atan2(b.z, b.x);
+    });
+
+    IncrementalKDTree tree;
+    tree.reserve(total);
+
+    std::printf("%-10s %16s %18s %12s\n", "map size", "insert [us/pt]",
+                "full rebuild [ms]", "rebuilds");
+    double total_ms = 0;
+    std::vector<Vec3f> frame;
+    for (size_t start = 0; start < total; start += frame_size) {
+        frame.assign(points.begin() + start,
+                     points.begin() + std::min(total, start + frame_size));
+        Stopwatch sw;
+        tree.insert(frame);
+        double ms = sw.elapsedMs();
+        total_ms += ms;
+
+        size_t map_size = start + frame.size();
+        if (map_size % 500000 == 0) {
+            // What a from-scratch static tree would cost per frame instead
+            PointCloud map;
+            map.reserve(map_size);
+            for (size_t i = 0; i < map_size; i++) map.addPoint(points[i]);
+            KDTree full;
+            double full_ms = bestOf(1, [&] { full.build(map); });
+            std::printf("%-10zu %16.2f %18.1f %12zu\n", map_size,
+                        ms * 1000.0 / frame.size(), full_ms, tree.rebuildCount());
+        }
+    }
+    std::printf("amortized insert: %.2f us/pt over %zu pts (%.1fx points rebuilt)\n",
+                total_ms * 1000.0 / total, total,
+                static_cast<double>(tree.rebuiltPoints()) / total);
+
+    // Lazy deletes: drop a slab, then compare k-NN against a static tree
+    // over the surviving points
+    Stopwatch sw;
+    int removed = tree.removeBox({-0.3f, -0.01f, -0.05f}, {0.3f, 0.4f, 0.05f});
+    double remove_ms = sw.elapsedMs();
+    for (int id = 0; id < static_cast<int>(total); id += 97) tree.remove(id);
+
+    PointCloud live;
+    std::vector<int> live_ids;
+    for (size_t id = 0; id < tree.capacity(); id++) {
+        if (!tree.isRemoved(static_cast<int>(id))) {
+            live.addPoint(tree.point(static_cast<int>(id)));
+            live_ids.push_back(static_cast<int>(id));
+        }
+    }
+    KDTree reference;
+    reference.build(live);
+
+    const int k = 8;
+    PointCloud queries = makeScanCloud(100000, 99);
+    int idx[k];
+    float dist[k];
+    volatile int sink = 0;
+    double inc_ms = bestOf(3, [&] {
+        for (size_t i = 0; i < queries.size(); i++) {
+            sink += tree.findKNearest(queries.getPoint(i), k, idx, dist);
+        }
+    });
+    double ref_ms = bestOf(3, [&] {
+        for (size_t i = 0; i < queries.size(); i++) {
+            sink += reference.findKNearest(queries.getPoint(i), k, idx, dist);
+        }
+    });
+
+    for (size_t i = 0; i < queries.size(); i += 101) {
+        const Vec3f& q = queries.getPoint(i);
+        int a_idx[k], b_idx[k];
+        float a_dist[k], b_dist[k];
+        int a = tree.findKNearest(q, k, a_idx, a_dist);
+        int b = reference.findKNearest(q, k, b_idx, b_dist);
+        if (a != b || a_dist[k - 1] != b_dist[k - 1] || tree.isRemoved(a_idx[0])) {
+            std::printf("MISMATCH at query %zu\n", i);
+            return 1;
+        }
+    }
+
+    std::printf("removeBox: %d pts in %.1f ms, live %zu (tree says %zu)\n",
+                removed, remove_ms, live.size(), tree.size());
+    std::printf("100k %d-NN: incremental %.1f ms, static KDTree %.1f ms\n",
+                k, inc_ms, ref_ms);
+    return 0;
+}
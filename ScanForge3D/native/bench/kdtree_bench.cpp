@@ -0,0 +1,104 @@
+// KD-tree build and query benchmark on synthetic scan clouds.
+#include "bench_common.h"
+#include "util/kdtree.h"
+#include <limits>
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+static int bruteForceNearest(const PointCloud& cloud, const Vec3f& q) {
+    int best = -1;
+    float best_d = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < cloud.size(); i++) {
+        float d = q.distanceTo(cloud.getPoint(i));
+        if (d < best_d) { best_d = d; best = static_cast<int>(i); }
+    }
+    return best;
+}
+
+int main() {
+    const size_t sizes[] = {100000, 1000000, 5000000};
+
+    std::printf("%-10s %12s %16s\n", "points", "build [ms]", "100k NN [ms]");
+    for (size_t n : sizes) {
+        PointCloud cloud = makeScanCloud(n);
+
+        KDTree tree;
+        double build_ms = bestOf(3, [&] { tree.build(cloud); });
+
+        PointCloud queries = makeScanCloud(100000, 1234);
+        volatile int sink = 0;
+        double query_ms = bestOf(3, [&] {
+            for (size_t i = 0; i < queries.size(); i++) sink += tree.findNearest(queries.getPoint(i));
+        });
+
+        // Spot-check exactness against brute force
+        for (size_t i = 0; i < 20; i++) {
+            const Vec3f& q = queries.getPoint(i);
+            int a = tree.findNearest(q);
+            int b = bruteForceNearest(cloud, q);
+            if (q.distanceTo(cloud.getPoint(a)) != q.distanceTo(cloud.getPoint(b))) {
+                std::printf("MISMATCH at query %zu\n", i);
+                return 1;
+            }
+        }
+
+        std::printf("%-10zu %12.1f %16.1f\n", n, build_ms, query_ms);
+    }
+
+    // All-points k-NN: per-point findKNearest loop vs batched knnAll
+    std::printf("\n%-10s %4s %18s %14s\n", "points", "k", "findKNearest [ms]", "knnAll [ms]");
+    for (size_t n : {size_t(100000), size_t(1000000)}) {
+        PointCloud cloud = makeScanCloud(n);
+        KDTree tree;
+        tree.build(cloud);
+        const int k = 16;
+
+        volatile size_t sink = 0;
+        double loop_ms = bestOf(1, [&] {
+            for (size_t i = 0; i < cloud.size(); i++) {
+                sink += tree.findKNearest(cloud.getPoint(i), k).size();
+            }
+        });
+        KNNGraph graph;
+        double batch_ms = bestOf(1, [&] { graph = tree.knnAll(k); });
+
+        for (size_t i = 0; i < cloud.size(); i += cloud.size() / 10) {
+            std::vector<int> ref = tree.findKNearest(cloud.getPoint(i), k);
+            for (int j = 0; j < k; j++) {
+                if (graph.neighbors(i)[j] != ref[j] &&
+                    graph.distances(i)[j] != graph.distances(i)[std::max(0, j - 1)]) {
+                    std::printf("MISMATCH in knnAll row %zu\n", i);
+                    return 1;
+                }
+            }
+        }
+        std::printf("%-10zu %4d %18.1f %14.1f\n", n, k, loop_ms, batch_ms);
+    }
+
+    // Leaf bucket size: 1 = one point per leaf (the previous layout)
+    std::printf("\n1M points, 100k queries\n");
+    std::printf("%-6s %12s %12s %18s\n", "leaf", "build [ms]", "NN [ms]", "kNN k=16 [ms]");
+    {
+        PointCloud cloud = makeScanCloud(1000000);
+        PointCloud queries = makeScanCloud(100000, 1234);
+        for (int leaf : {1, 8, 16, 24, 32}) {
+            KDTree tree(leaf);
+            double build_ms = bestOf(3, [&] { tree.build(cloud); });
+
+            volatile int sink = 0;
+            double nn_ms = bestOf(3, [&] {
+                for (size_t i = 0; i < queries.size(); i++) sink += tree.findNearest(queries.getPoint(i));
+            });
+            int idx[16];
+            float dist[16];
+            double knn_ms = bestOf(3, [&] {
+                for (size_t i = 0; i < queries.size(); i++) {
+                    sink += tree.findKNearest(queries.getPoint(i), 16, idx, dist);
+                }
+            });
+            std::printf("%-6d %12.1f %12.1f %18.1f\n", leaf, build_ms, nn_ms, knn_ms);
+        }
+    }
+    return 0;
+}
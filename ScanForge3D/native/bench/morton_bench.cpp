@@ -0,0 +1,86 @@
+// Effect of Morton reordering on neighborhood-heavy passes: SOR, normal
+// estimation and Taubin smoothing, each on ~1M elements in scattered
+// (hash / shuffled) order vs Z-curve order.
+#include "bench_common.h"
+#include "mesh/mesh_smoothing.h"
+#include "point_cloud/normal_estimation.h"
+#include "point_cloud/statistical_outlier_removal.h"
+#include "point_cloud/voxel_grid_filter.h"
+#include "util/morton_order.h"
+#include <algorithm>
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+// Sphere as a lat/long grid mesh with vertices in random order, like a
+// mesh whose vertices were emitted from a hash map
+static TriangleMesh makeShuffledSphereMesh(int rows, int cols) {
+    std::vector<Vec3f> verts;
+    for (int r = 0; r < rows; r++) {
+        float theta = 3.14159265f * (r + 0.5f) / rows;
+        for (int c = 0; c < cols; c++) {
+            float phi = 6.2831853f * c / cols;
+            verts.push_back({0.15f * std::sin(theta) * std::cos(phi),
+                             0.15f * std::cos(theta),
+                             0.15f * std::sin(theta) * std::sin(phi)});
+        }
+    }
+    std::vector<int> shuffle(verts.size());
+    for (size_t i = 0; i < shuffle.size(); i++) shuffle[i] = static_cast<int>(i);
+    std::shuffle(shuffle.begin(), shuffle.end(), std::mt19937(3));
+    std::vector<int> slot(verts.size());
+    for (size_t i = 0; i < shuffle.size(); i++) slot[shuffle[i]] = static_cast<int>(i);
+
+    TriangleMesh mesh;
+    for (int old_index : shuffle) mesh.addVertex(verts[old_index]);
+    for (int r = 0; r + 1 < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            int a = slot[r * cols + c], b = slot[r * cols + (c + 1) % cols];
+            int d = slot[(r + 1) * cols + c], e = slot[(r + 1) * cols + (c + 1) % cols];
+            mesh.addTriangle(a, d, b);
+            mesh.addTriangle(b, d, e);
+        }
+    }
+    return mesh;
+}
+
+int main() {
+    PointCloud scattered = VoxelGridFilter(0.0012f).apply(makeScanCloud(1600000));
+    PointCloud sorted = scattered;
+    double sort_ms = bestOf(3, [&] {
+        sorted = scattered;
+        MortonOrder::sortPoints(sorted);
+    });
+    std::printf("%zu points, Morton sort %.1f ms (incl. copy)\n\n",
+                scattered.size(), sort_ms);
+
+    std::printf("%-22s %14s %14s %9s\n", "pass", "scattered [ms]", "morton [ms]", "speedup");
+    auto row = [](const char* name, double a, double b) {
+        std::printf("%-22s %14.1f %14.1f %8.2fx\n", name, a, b, a / b);
+    };
+
+    StatisticalOutlierRemoval sor(20, 2.0f);
+    double sor_a = bestOf(2, [&] { sor.apply(scattered); });
+    double sor_b = bestOf(2, [&] { sor.apply(sorted); });
+    row("SOR (k=20)", sor_a, sor_b);
+
+    NormalEstimation ne(15);
+    double ne_a = bestOf(2, [&] { ne.estimate(scattered); });
+    double ne_b = bestOf(2, [&] { ne.estimate(sorted); });
+    row("normals (k=15)", ne_a, ne_b);
+
+    TriangleMesh mesh = makeShuffledSphereMesh(1000, 1000);
+    TriangleMesh mesh_sorted = mesh;
+    double mesh_sort_ms = bestOf(1, [&] { MortonOrder::sortMesh(mesh_sorted); });
+    double sm_a = bestOf(1, [&] {
+        TriangleMesh m = mesh;
+        MeshSmoothing::taubinSmooth(m, 3);
+    });
+    double sm_b = bestOf(1, [&] {
+        TriangleMesh m = mesh_sorted;
+        MeshSmoothing::taubinSmooth(m, 3);
+    });
+    row("taubin x3 (1M verts)", sm_a, sm_b);
+    std::printf("mesh Morton sort %.1f ms\n", mesh_sort_ms);
+    return 0;
+}
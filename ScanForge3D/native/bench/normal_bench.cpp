@@ -0,0 +1,61 @@
+// NormalEstimation on ~1M points: the previous serial two-pass
+// covariance loop (with the closed-form solver) vs the parallel
+// single-pass estimateUnoriented, and the orientation pass for scale.
+#include "bench_common.h"
+#include "point_cloud/normal_estimation.h"
+#include "point_cloud/voxel_grid_filter.h"
+#include "util/parallel.h"
+#include "util/symmetric_eigen3.h"
+#include <algorithm>
+#include <vector>
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+// Per-point centroid pass, then deviation pass, one thread
+static void serialTwoPass(const PointCloud& cloud, const KNNGraph& graph, int k,
+                          std::vector<Vec3f>& normals) {
+    for (size_t i = 0; i < cloud.size(); i++) {
+        const int* neighbors = graph.neighbors(i);
+        Vec3f centroid(0, 0, 0);
+        for (int j = 0; j < k; j++) centroid = centroid + cloud.getPoint(neighbors[j]);
+        centroid = centroid / static_cast<float>(k);
+        SymMat3 m{0, 0, 0, 0, 0, 0};
+        for (int j = 0; j < k; j++) {
+            Vec3f d = cloud.getPoint(neighbors[j]) - centroid;
+            m.xx += d.x * d.x; m.xy += d.x * d.y; m.xz += d.x * d.z;
+            m.yy += d.y * d.y; m.yz += d.y * d.z; m.zz += d.z * d.z;
+        }
+        smallestEigenvector(m, normals[i]);
+    }
+}
+
+int main() {
+    const int k = 15;
+    PointCloud cloud = VoxelGridFilter(0.0012f).apply(makeScanCloud(1600000));
+    KDTree tree;
+    tree.build(cloud);
+    KNNGraph graph = tree.knnAll(k);
+    std::printf("%zu points, k=%d, %d hardware threads\n\n", cloud.size(), k,
+                hardwareThreads());
+
+    NormalEstimation ne(k);
+    std::vector<Vec3f> a(cloud.size()), b(cloud.size());
+    double serial_ms = bestOf(3, [&] { serialTwoPass(cloud, graph, k, a); });
+    double parallel_ms = bestOf(3, [&] { ne.estimateUnoriented(cloud, graph, b.data()); });
+    double full_ms = bestOf(1, [&] { ne.estimate(cloud); });
+
+    std::vector<double> angles(a.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        angles[i] = 57.29578 * std::atan2(a[i].cross(b[i]).length(),
+                                          std::fabs(a[i].dot(b[i])));
+    }
+    std::sort(angles.begin(), angles.end());
+
+    std::printf("%-36s %10.1f ms\n", "serial two-pass covariance", serial_ms);
+    std::printf("%-36s %10.1f ms\n", "parallel single-pass (unoriented)", parallel_ms);
+    std::printf("%-36s %10.1f ms\n", "estimate() incl. k-NN + orientation", full_ms);
+    std::printf("\nangle between the two: p99.9 %.4f deg, max %.4f deg\n",
+                angles[angles.size() * 999 / 1000], angles.back());
+    return 0;
+}
@@ -0,0 +1,235 @@
+// Frame-to-model tracking on synthetic depth (sphere on a table, camera
+// orbiting, 2 mm noise, 320x240).
+//  1. One frame, its pose perturbed by 2 cm / 3 degrees: projective ICP
+//     against the TSDF raycast and against the splatted voxel map, vs
+//     ICPRegistration (KD-tree, point-to-point) on the same points.
+//  2. The whole orbit through DepthFrameWorker with a drifting pose
+//     (0.6 mm and 0.1 degrees per frame), with and without pose
+//     refinement: accuracy of the fused sphere.
+#include "bench_common.h"
+#include "point_cloud/depth_frame_worker.h"
+#include "point_cloud/depth_unprojection.h"
+#include "point_cloud/icp_registration.h"
+#include "point_cloud/projective_icp.h"
+#include "util/math_utils.h"
+#include "util/normal_equations6.h"
+#include "util/parallel.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+namespace {
+
+const int WIDTH = 320, HEIGHT = 240;
+const DepthIntrinsics INTRINSICS{260.0f, 260.0f, 160.0f, 120.0f};
+const Vec3f SPHERE_CENTER(0.0f, 0.1f, 0.0f);
+const float SPHERE_RADIUS = 0.1f;
+
+void lookAt(const Vec3f& eye, const Vec3f& target, float* m) {
+    Vec3f z = (eye - target).normalized();
+    Vec3f x = Vec3f(0, 1, 0).cross(z).normalized();
+    Vec3f y = z.cross(x);
+    const float cols[16] = {x.x, x.y, x.z, 0, y.x, y.y, y.z, 0, z.x, z.y, z.z, 0,
+                            eye.x, eye.y, eye.z, 1};
+    std::copy(cols, cols + 16, m);
+}
+
+// Sphere on a 0.4 m table with a 0.1 m box at one corner, so no
+// direction of motion is unconstrained
+void render(const float* m, std::mt19937& rng, std::vector<uint16_t>& depth) {
+    std::normal_distribution<float> noise(0.0f, 0.002f);
+    Vec3f eye(m[12], m[13], m[14]);
+    depth.assign(WIDTH * HEIGHT, 0);
+    for (int v = 0; v < HEIGHT; v++) {
+        for (int u = 0; u < WIDTH; u++) {
+            Vec3f c((u - INTRINSICS.cx) / INTRINSICS.fx, (v - INTRINSICS.cy) / INTRINSICS.fy, -1.0f);
+            Vec3f dir(m[0] * c.x + m[4] * c.y + m[8] * c.z,
+                      m[1] * c.x + m[5] * c.y + m[9] * c.z,
+                      m[2] * c.x + m[6] * c.y + m[10] * c.z);
+            float best = 1e9f;
+            Vec3f oc = eye - SPHERE_CENTER;
+            float a = dir.dot(dir), b = oc.dot(dir);
+            float disc = b * b - a * (oc.dot(oc) - SPHERE_RADIUS * SPHERE_RADIUS);
+            if (disc > 0) best = (-b - std::sqrt(disc)) / a;
+            if (dir.y < 0) {
+                float tp = -eye.y / dir.y;
+                Vec3f hit = eye + dir * tp;
+                if (std::fabs(hit.x) < 0.2f && std::fabs(hit.z) < 0.2f) best = std::min(best, tp);
+            }
+            // Box [0.08, 0.18] x [0, 0.1] x [0.08, 0.18] (slab test)
+            float t0 = 0.0f, t1 = 1e9f;
+            const float lo[3] = {0.08f, 0.0f, 0.08f}, hi[3] = {0.18f, 0.1f, 0.18f};
+            const float o[3] = {eye.x, eye.y, eye.z}, d[3] = {dir.x, dir.y, dir.z};
+            for (int k = 0; k < 3; k++) {
+                float ta = (lo[k] - o[k]) / d[k], tb = (hi[k] - o[k]) / d[k];
+                t0 = std::max(t0, std::min(ta, tb));
+                t1 = std::min(t1, std::max(ta, tb));
+            }
+            if (t0 < t1) best = std::min(best, t0);
+            if (best < 1e8f) {
+                depth[v * WIDTH + u] = static_cast<uint16_t>(std::lround((best + noise(rng)) * 1000.0f));
+            }
+        }
+    }
+}
+
+// Translation (mm) and rotation (degrees) between two poses
+void poseError(const float* a, const float* b, float& mm, float& deg) {
+    mm = Vec3f(a[12] - b[12], a[13] - b[13], a[14] - b[14]).length() * 1000.0f;
+    float trace = 0;
+    for (int r = 0; r < 3; r++) {
+        for (int k = 0; k < 3; k++) trace += a[r * 4 + k] * b[r * 4 + k];  // trace(A^T B)
+    }
+    deg = std::acos(std::min(1.0f, std::max(-1.0f, (trace - 1.0f) * 0.5f))) * 57.29578f;
+}
+
+// Perturbs a pose by x = (rotation, translation) from the left
+void perturb(const float* pose, const double x[6], float* out) {
+    float R[9] = {pose[0], pose[4], pose[8], pose[1], pose[5], pose[9], pose[2], pose[6], pose[10]};
+    Vec3f t(pose[12], pose[13], pose[14]);
+    applyTwist(x, R, t);
+    const float cols[16] = {R[0], R[3], R[6], 0, R[1], R[4], R[7], 0, R[2], R[5], R[8], 0,
+                            t.x, t.y, t.z, 1};
+    std::copy(cols, cols + 16, out);
+}
+
+float sphereError(const TriangleMesh& mesh) {
+    double sum = 0;
+    size_t n = 0;
+    for (const Vec3f& p : mesh.vertices()) {
+        if (p.y < 0.02f || (p - SPHERE_CENTER).length() > 0.15f) continue;
+        sum += std::fabs((p - SPHERE_CENTER).length() - SPHERE_RADIUS) * 1000.0;
+        n++;
+    }
+    return n ? static_cast<float>(sum / n) : 0.0f;
+}
+
+} // namespace
+
+int main() {
+    const int frames = 48;
+    std::mt19937 rng(9);
+    std::vector<std::vector<uint16_t>> depth(frames);
+    std::vector<std::array<float, 16>> poses(frames);
+    for (int f = 0; f < frames; f++) {
+        float angle = 6.2831853f * f / frames;
+        lookAt(Vec3f(0.45f * std::cos(angle), 0.35f, 0.45f * std::sin(angle)),
+               Vec3f(0, 0.05f, 0), poses[f].data());
+        render(poses[f].data(), rng, depth[f]);
+    }
+    auto imageOf = [&](int f) {
+        DepthImage image;
+        image.depth_mm = depth[f].data();
+        image.depth_row_stride = WIDTH;
+        image.width = WIDTH;
+        image.height = HEIGHT;
+        image.intrinsics = INTRINSICS;
+        return image;
+    };
+    std::printf("%d frames %dx%d, 2 mm noise, %d hardware threads\n\n", frames, WIDTH, HEIGHT,
+                hardwareThreads());
+
+    // 1. Model from the first half of the orbit, tracking frame 24
+    SparseTSDFVolume volume(0.002f, size_t(256) << 20);
+    volume.setDepthRange(0.1f, 3.0f);
+    VoxelMap map(0.002f);
+    DepthFrameIntegrator integrator;
+    integrator.setDepthRange(0.1f, 3.0f);
+    for (int f = 0; f < 24; f++) {
+        volume.integrate(imageOf(f), poses[f].data());
+        integrator.integrate(imageOf(f), poses[f].data(), 1, f, map);
+    }
+    const int test = 24;
+    const double offset[6] = {0.03, -0.03, 0.03, 0.012, -0.012, 0.012};
+    float start[16];
+    perturb(poses[test].data(), offset, start);
+    float mm, deg;
+    poseError(start, poses[test].data(), mm, deg);
+    std::printf("start pose error %.1f mm, %.2f deg\n\n", mm, deg);
+    std::printf("%-38s %9s %9s %6s %8s %9s %9s\n", "", "render", "align", "iter", "fitness",
+                "err mm", "err deg");
+
+    // Half resolution for the model and frame, as the worker does
+    const DepthIntrinsics half{INTRINSICS.fx / 2, INTRINSICS.fy / 2, INTRINSICS.cx / 2,
+                               INTRINSICS.cy / 2};
+    ProjectiveICP icp(20, 1e-5f);
+    icp.setDepthRange(0.1f, 3.0f);
+    // The model is rendered at the predicted (perturbed) pose
+    double render_ms = bestOf(5, [&] { icp.renderModel(volume, half, WIDTH / 2, HEIGHT / 2, start); });
+    ICPResult result;
+    double align_ms = bestOf(5, [&] { result = icp.align(imageOf(test), start, 2); });
+    poseError(result.transformation.data(), poses[test].data(), mm, deg);
+    std::printf("%-38s %6.2f ms %6.2f ms %6d %8.2f %9.2f %9.3f\n", "projective, TSDF raycast",
+                render_ms, align_ms, result.iterations, result.fitness, mm, deg);
+
+    std::vector<float> map_xyz(map.size() * 3), map_normals(map.size() * 3);
+    map.copyPoints(map_xyz.data());
+    map.copyNormals(map_normals.data());
+    render_ms = bestOf(5, [&] {
+        icp.renderModel(map_xyz.data(), map_normals.data(), map.size(), half, WIDTH / 2,
+                        HEIGHT / 2, start);
+    });
+    align_ms = bestOf(5, [&] { result = icp.align(imageOf(test), start, 2); });
+    poseError(result.transformation.data(), poses[test].data(), mm, deg);
+    std::printf("%-38s %6.2f ms %6.2f ms %6d %8.2f %9.2f %9.3f\n", "projective, voxel map splat",
+                render_ms, align_ms, result.iterations, result.fitness, mm, deg);
+
+    // KD-tree ICP: frame points (at the start pose) to the voxel map
+    {
+        DepthUnprojection unprojection;
+        unprojection.setDepthRange(0.1f, 3.0f);
+        size_t n = unprojection.unproject(imageOf(test), start, 2);
+        PointCloud source, target;
+        for (size_t i = 0; i < n; i++) {
+            const float* p = unprojection.points() + i * 3;
+            source.addPoint(Vec3f(p[0], p[1], p[2]));
+        }
+        for (size_t i = 0; i < map.size(); i++) {
+            target.addPoint(Vec3f(map_xyz[i * 3], map_xyz[i * 3 + 1], map_xyz[i * 3 + 2]));
+        }
+        ICPResult kd;
+        double kd_ms = bestOf(1, [&] { kd = ICPRegistration(50, 1e-6f).align(source, target); });
+        Mat4f refined = multiply4x4(kd.transformation.data(), start);
+        poseError(refined.data(), poses[test].data(), mm, deg);
+        std::printf("%-38s %9s %6.1f ms %6d %8.2f %9.2f %9.3f\n", "ICPRegistration (KD-tree, incl. build)",
+                    "", kd_ms, kd.iterations, kd.fitness, mm, deg);
+    }
+
+    // 2. Drifting poses through the worker
+    std::printf("\n%-38s %9s %9s %9s %9s\n", "", "ms/frame", "refined", "rejected", "sphere mm");
+    for (bool refine : {false, true}) {
+        SparseTSDFVolume fused(0.002f, size_t(256) << 20);
+        fused.setDepthRange(0.1f, 3.0f);
+        VoxelMap worker_map(0.002f);
+        DepthFrameWorker worker(worker_map, 4, WIDTH * HEIGHT);
+        worker.setDepthRange(0.1f, 3.0f);
+        worker.setTSDFVolume(&fused);
+        worker.setPoseRefinement(refine);
+        worker.start();
+        Stopwatch sw;
+        for (int f = 0; f < frames; f++) {
+            const double drift[6] = {0, 0.00175 * f, 0, 0.0006 * f, 0, 0};
+            float drifted[16];
+            perturb(poses[f].data(), drift, drifted);
+            worker.submit(imageOf(f), drifted, 2, f);
+            // One frame at a time, so none is dropped
+            while (worker.stats().integrated < static_cast<uint64_t>(f + 1)) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+        worker.stop();
+        double ms = sw.elapsedMs() / frames;
+        DepthFrameWorkerStats stats = worker.stats();
+        std::printf("%-38s %9.2f %9llu %9llu %9.2f\n",
+                    refine ? "drifting poses, refined" : "drifting poses, as given", ms,
+                    static_cast<unsigned long long>(stats.refined),
+                    static_cast<unsigned long long>(stats.refine_rejected),
+                    sphereError(fused.extractMesh()));
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+// StatisticalOutlierRemoval on 2M points: the previous serial
+// statistics + addPoint compaction vs the parallel version, per phase.
+// Thread scaling needs a multi-core host; hardwareThreads() is printed.
+#include "bench_common.h"
+#include "point_cloud/statistical_outlier_removal.h"
+#include "util/parallel.h"
+#include <vector>
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+// Mask and compaction as StatisticalOutlierRemoval did them before
+static PointCloud serialSor(const PointCloud& input, const KNNGraph& graph, int k,
+                            float std_ratio) {
+    size_t n = graph.size();
+    std::vector<float> mean_distances(n);
+    for (size_t i = 0; i < n; i++) {
+        const int* neighbors = graph.neighbors(i);
+        const float* sq_dists = graph.distances(i);
+        float sum = 0;
+        int count = 0;
+        for (int j = 0; j < graph.k && count < k; j++) {
+            if (neighbors[j] == static_cast<int>(i)) continue;
+            sum += std::sqrt(sq_dists[j]);
+            count++;
+        }
+        mean_distances[i] = (count > 0) ? sum / count : 0;
+    }
+    float global_mean = 0;
+    for (float d : mean_distances) global_mean += d;
+    global_mean /= n;
+    float variance = 0;
+    for (float d : mean_distances) variance += (d - global_mean) * (d - global_mean);
+    float threshold = global_mean + std_ratio * std::sqrt(variance / n);
+
+    PointCloud result;
+    for (size_t i = 0; i < n; i++) {
+        if (mean_distances[i] <= threshold) result.addPoint(input.getPoint(i));
+    }
+    return result;
+}
+
+int main() {
+    const size_t n = 2000000;
+    const int k = 20;
+    PointCloud cloud = makeScanCloud(n);
+    // 1% scattered outliers around the object
+    PointCloud noise = makeUniformCloud(n / 100, 0.6f, 11);
+    for (size_t i = 0; i < noise.size(); i++) {
+        Vec3f p = noise.getPoint(i);
+        cloud.addPoint({p.x - 0.3f, p.y - 0.1f, p.z - 0.3f});
+    }
+    std::printf("%zu points, k=%d, %d hardware threads\n\n", cloud.size(), k,
+                hardwareThreads());
+
+    KDTree tree;
+    double build_ms = bestOf(1, [&] { tree.build(cloud); });
+    KNNGraph graph;
+    double knn_ms = bestOf(1, [&] { graph = tree.knnAll(k + 1); });
+
+    StatisticalOutlierRemoval sor(k, 2.0f);
+    PointCloud serial, parallel;
+    double serial_ms = bestOf(3, [&] { serial = serialSor(cloud, graph, k, 2.0f); });
+    std::vector<uint8_t> keep;
+    double mask_ms = bestOf(3, [&] { keep = sor.inlierMask(graph); });
+    double compact_ms = bestOf(3, [&] { parallel = cloud.retained(keep); });
+
+    std::printf("%-34s %10.1f ms\n", "KD-tree build", build_ms);
+    std::printf("%-34s %10.1f ms\n", "knnAll (k+1)", knn_ms);
+    std::printf("%-34s %10.1f ms\n", "stats + compaction, serial", serial_ms);
+    std::printf("%-34s %10.1f ms\n", "stats + mask, parallel", mask_ms);
+    std::printf("%-34s %10.1f ms\n", "compaction, parallel", compact_ms);
+    std::printf("%-34s %10.1f ms\n", "full apply()", bestOf(1, [&] { sor.apply(cloud); }));
+
+    // Welford in double vs float sums can flip points right at the threshold
+    size_t diff = serial.size() > parallel.size() ? serial.size() - parallel.size()
+                                                  : parallel.size() - serial.size();
+    std::printf("\nkept: serial %zu, parallel %zu (%zu differ)\n",
+                serial.size(), parallel.size(), diff);
+    return 0;
+}
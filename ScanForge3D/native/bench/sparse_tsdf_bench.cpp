@@ -0,0 +1,164 @@
+// A 1.6 m table with four spheres, scanned by a camera sliding along it
+// (80 frames, 2 mm depth noise): the dense TSDF volume over the table's
+// bounding box vs the sparse block volume at 2 mm, with a budget large
+// enough for the scan and with one that forces eviction, with and
+// without a spill file. Accuracy is the distance of the mesh vertices
+// on the spheres to the true spheres; "spheres" counts the spheres that
+// have a surface at all.
+#include "bench_common.h"
+#include "mesh/sparse_tsdf_volume.h"
+#include "mesh/tsdf_volume.h"
+#include "util/parallel.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <vector>
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+namespace {
+
+const int WIDTH = 320, HEIGHT = 240;
+const DepthIntrinsics INTRINSICS{260.0f, 260.0f, 160.0f, 120.0f};
+const float TABLE_HALF_X = 0.8f, TABLE_HALF_Z = 0.2f;
+const float SPHERE_RADIUS = 0.06f;
+const Vec3f SPHERES[4] = {{-0.6f, 0.06f, 0.0f}, {-0.2f, 0.06f, 0.05f},
+                          {0.2f, 0.06f, -0.05f}, {0.6f, 0.06f, 0.0f}};
+
+// Column-major camera-to-world matrix looking from eye at target (+y up)
+void lookAt(const Vec3f& eye, const Vec3f& target, float* m) {
+    Vec3f z = (eye - target).normalized();
+    Vec3f x = Vec3f(0, 1, 0).cross(z).normalized();
+    Vec3f y = z.cross(x);
+    const float cols[16] = {x.x, x.y, x.z, 0, y.x, y.y, y.z, 0, z.x, z.y, z.z, 0,
+                            eye.x, eye.y, eye.z, 1};
+    std::copy(cols, cols + 16, m);
+}
+
+void render(const float* m, std::mt19937& rng, std::vector<uint16_t>& depth) {
+    std::normal_distribution<float> noise(0.0f, 0.002f);
+    Vec3f eye(m[12], m[13], m[14]);
+    depth.assign(WIDTH * HEIGHT, 0);
+    for (int v = 0; v < HEIGHT; v++) {
+        for (int u = 0; u < WIDTH; u++) {
+            Vec3f c((u - INTRINSICS.cx) / INTRINSICS.fx, (v - INTRINSICS.cy) / INTRINSICS.fy, -1.0f);
+            Vec3f dir(m[0] * c.x + m[4] * c.y + m[8] * c.z,
+                      m[1] * c.x + m[5] * c.y + m[9] * c.z,
+                      m[2] * c.x + m[6] * c.y + m[10] * c.z);
+            float best = 1e9f;
+            for (const Vec3f& center : SPHERES) {
+                Vec3f oc = eye - center;
+                float a = dir.dot(dir), b = oc.dot(dir);
+                float disc = b * b - a * (oc.dot(oc) - SPHERE_RADIUS * SPHERE_RADIUS);
+                if (disc > 0) best = std::min(best, (-b - std::sqrt(disc)) / a);
+            }
+            if (dir.y < 0) {
+                float tp = -eye.y / dir.y;
+                Vec3f hit = eye + dir * tp;
+                if (std::fabs(hit.x) < TABLE_HALF_X && std::fabs(hit.z) < TABLE_HALF_Z) {
+                    best = std::min(best, tp);
+                }
+            }
+            if (best < 1e8f) {
+                depth[v * WIDTH + u] = static_cast<uint16_t>(std::lround((best + noise(rng)) * 1000.0f));
+            }
+        }
+    }
+}
+
+void report(const char* name, double fuse_ms, double extract_ms, size_t bytes,
+            const TriangleMesh& mesh) {
+    std::vector<float> err;
+    bool seen[4] = {};
+    for (const Vec3f& p : mesh.vertices()) {
+        if (p.y < 0.015f) continue;
+        for (int s = 0; s < 4; s++) {
+            float d = (p - SPHERES[s]).length();
+            if (d > SPHERE_RADIUS + 0.03f) continue;
+            err.push_back(std::fabs(d - SPHERE_RADIUS) * 1000.0f);
+            seen[s] = true;
+        }
+    }
+    std::sort(err.begin(), err.end());
+    float mean = 0;
+    for (float e : err) mean += e;
+    mean /= std::max<size_t>(1, err.size());
+    std::printf("%-30s %8.2f %9.1f %9.1f %9zu %8.2f %8.2f %8d\n", name, fuse_ms, extract_ms,
+                bytes / 1e6, mesh.triangleCount(), mean,
+                err.empty() ? 0.0f : err[err.size() * 95 / 100],
+                seen[0] + seen[1] + seen[2] + seen[3]);
+}
+
+} // namespace
+
+int main() {
+    const int frames = 80;
+    std::mt19937 rng(11);
+    std::vector<std::vector<uint16_t>> depth(frames);
+    std::vector<std::array<float, 16>> poses(frames);
+    for (int f = 0; f < frames; f++) {
+        float x = -0.8f + 1.6f * f / (frames - 1);
+        lookAt(Vec3f(x, 0.3f, 0.3f), Vec3f(x, 0.03f, 0.0f), poses[f].data());
+        render(poses[f].data(), rng, depth[f]);
+    }
+    auto imageOf = [&](int f) {
+        DepthImage image;
+        image.depth_mm = depth[f].data();
+        image.depth_row_stride = WIDTH;
+        image.width = WIDTH;
+        image.height = HEIGHT;
+        image.intrinsics = INTRINSICS;
+        return image;
+    };
+
+    std::printf("%d frames %dx%d, 2 mm noise, %d hardware threads\n\n", frames, WIDTH, HEIGHT,
+                hardwareThreads());
+    std::printf("%-30s %8s %9s %9s %9s %8s %8s %8s\n", "", "ms/frame", "mesh ms", "MB",
+                "triangles", "mean mm", "p95 mm", "spheres");
+
+    // Dense over the table's bounding box (1.64 x 0.18 x 0.44 m)
+    for (float voxel : {0.004f, 0.002f}) {
+        int nx = static_cast<int>(1.64f / voxel), ny = static_cast<int>(0.18f / voxel);
+        int nz = static_cast<int>(0.44f / voxel);
+        TSDFVolume volume(Vec3f(-0.82f, -0.04f, -0.22f), voxel, nx, ny, nz);
+        volume.setDepthRange(0.1f, 3.0f);
+        Stopwatch fuse;
+        for (int f = 0; f < frames; f++) volume.integrate(imageOf(f), poses[f].data());
+        double fuse_ms = fuse.elapsedMs() / frames;
+        TriangleMesh mesh;
+        double extract_ms = bestOf(1, [&] { mesh = volume.extractMesh(); });
+        char name[64];
+        std::snprintf(name, sizeof(name), "dense, %.0f mm", voxel * 1000);
+        report(name, fuse_ms, extract_ms, volume.memoryBytes(), mesh);
+    }
+
+    // Sparse at 2 mm: ample budget, then a budget of a quarter of the
+    // blocks the scan needs, spilling to a file, to nowhere and to a
+    // full disk (/dev/full, where every spill write fails)
+    size_t needed_blocks = 0;
+    struct Case { const char* name; size_t budget; bool spill; };
+    const char* spill_path = "sparse_tsdf_bench.spill";
+    for (int c = 0; c < 4; c++) {
+        size_t budget = c == 0 ? (size_t(512) << 20) : needed_blocks * 2100 / 4;
+        SparseTSDFVolume volume(0.002f, budget);
+        volume.setDepthRange(0.1f, 3.0f);
+        if (c == 1) volume.setSpillFile(spill_path);
+        if (c == 3 && !volume.setSpillFile("/dev/full")) continue;
+        Stopwatch fuse;
+        for (int f = 0; f < frames; f++) volume.integrate(imageOf(f), poses[f].data());
+        double fuse_ms = fuse.elapsedMs() / frames;
+        TriangleMesh mesh;
+        double extract_ms = bestOf(1, [&] { mesh = volume.extractMesh(); });
+        SparseTSDFVolume::Stats stats = volume.stats();
+        if (c == 0) needed_blocks = stats.resident_blocks;
+        const char* names[4] = {"sparse, 2 mm", "sparse, 1/4 budget + spill",
+                                "sparse, 1/4 budget, no spill", "sparse, 1/4 budget, disk full"};
+        report(names[c], fuse_ms, extract_ms, stats.memory_bytes, mesh);
+        std::printf("%-30s %zu resident of %zu, %zu spilled, %zu dropped blocks, %.1f MB spill file\n",
+                    "", stats.resident_blocks, stats.max_blocks, stats.spilled_blocks,
+                    stats.dropped_blocks, stats.spill_file_bytes / 1048576.0);
+    }
+    std::remove(spill_path);
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Fixed-radius search: SpatialHashGrid vs KD-tree, and radius vs
+// statistical outlier removal, on voxel-filtered scan clouds.
+#include "bench_common.h"
+#include "point_cloud/radius_outlier_removal.h"
+#include "point_cloud/statistical_outlier_removal.h"
+#include "point_cloud/voxel_grid_filter.h"
+#include "util/kdtree.h"
+#include "util/spatial_hash_grid.h"
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+int main() {
+    const float voxel = 0.002f;
+    const float radius = 3.0f * voxel;
+
+    std::printf("%-10s %14s %14s %16s %16s %16s\n", "points", "grid build", "kd build",
+                "grid count [ms]", "grid batch [ms]", "kd radius [ms]");
+    for (size_t raw : {size_t(1000000), size_t(4000000)}) {
+        PointCloud cloud = VoxelGridFilter(voxel).apply(makeScanCloud(raw));
+        size_t n = cloud.size();
+
+        SpatialHashGrid grid(radius);
+        double grid_build = bestOf(3, [&] { grid.build(cloud); });
+        KDTree tree;
+        double kd_build = bestOf(3, [&] { tree.build(cloud); });
+
+        volatile long sink = 0;
+        double grid_ms = bestOf(3, [&] {
+            for (size_t i = 0; i < n; i++) sink += grid.countWithinRadius(cloud.getPoint(i), radius);
+        });
+        double batch_ms = bestOf(3, [&] { sink += grid.countAllWithinRadius(radius)[0]; });
+        std::vector<int> found;
+        double kd_ms = bestOf(3, [&] {
+            for (size_t i = 0; i < n; i++) {
+                found.clear();
+                sink += tree.radiusSearch(cloud.getPoint(i), radius, found);
+            }
+        });
+
+        for (size_t i = 0; i < n; i += n / 50) {
+            found.clear();
+            int a = grid.countWithinRadius(cloud.getPoint(i), radius);
+            int b = tree.radiusSearch(cloud.getPoint(i), radius, found);
+            if (a != b) {
+                std::printf("MISMATCH at %zu: grid %d, kd %d\n", i, a, b);
+                return 1;
+            }
+        }
+        std::printf("%-10zu %11.1f ms %11.1f ms %16.1f %16.1f %16.1f\n",
+                    n, grid_build, kd_build, grid_ms, batch_ms, kd_ms);
+    }
+
+    std::printf("\n%-10s %18s %18s\n", "points", "ROR [ms] / kept", "SOR [ms] / kept");
+    for (size_t raw : {size_t(1000000), size_t(4000000)}) {
+        PointCloud cloud = VoxelGridFilter(voxel).apply(makeScanCloud(raw, 42, 0.003f));
+        PointCloud ror_out, sor_out;
+        double ror_ms = bestOf(1, [&] { ror_out = RadiusOutlierRemoval(radius, 4).apply(cloud); });
+        double sor_ms = bestOf(1, [&] { sor_out = StatisticalOutlierRemoval(20, 2.0f).apply(cloud); });
+        std::printf("%-10zu %9.1f / %-7zu %9.1f / %-7zu\n",
+                    cloud.size(), ror_ms, ror_out.size(), sor_ms, sor_out.size());
+    }
+    return 0;
+}
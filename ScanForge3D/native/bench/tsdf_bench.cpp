@@ -0,0 +1,153 @@
+// Surface from 48 synthetic depth frames (sphere on a table, camera
+// orbiting, 2 mm depth noise): fusing every frame into a TSDF volume and
+// running marching cubes on it, vs the post-scan path (accumulated voxel
+// map -> SOR -> normals -> k-NN SDF marching cubes). Accuracy is the
+// distance of the mesh vertices on the sphere to the true sphere.
+#include "bench_common.h"
+#include "mesh/marching_cubes.h"
+#include "mesh/tsdf_volume.h"
+#include "point_cloud/depth_frame_integrator.h"
+#include "point_cloud/normal_estimation.h"
+#include "point_cloud/statistical_outlier_removal.h"
+#include "point_cloud/voxel_map.h"
+#include "util/parallel.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+namespace {
+
+const int WIDTH = 320, HEIGHT = 240;
+const DepthIntrinsics INTRINSICS{260.0f, 260.0f, 160.0f, 120.0f};
+const Vec3f SPHERE_CENTER(0.0f, 0.1f, 0.0f);
+const float SPHERE_RADIUS = 0.1f;
+
+// Column-major camera-to-world matrix looking from eye at target (+y up)
+void lookAt(const Vec3f& eye, const Vec3f& target, float* m) {
+    Vec3f z = (eye - target).normalized();
+    Vec3f x = Vec3f(0, 1, 0).cross(z).normalized();
+    Vec3f y = z.cross(x);
+    const float cols[16] = {x.x, x.y, x.z, 0, y.x, y.y, y.z, 0, z.x, z.y, z.z, 0,
+                            eye.x, eye.y, eye.z, 1};
+    std::copy(cols, cols + 16, m);
+}
+
+// Ray-cast depth of the sphere and a 0.4 m table at y = 0
+void render(const float* m, std::mt19937& rng, std::vector<uint16_t>& depth) {
+    std::normal_distribution<float> noise(0.0f, 0.002f);
+    Vec3f eye(m[12], m[13], m[14]);
+    depth.assign(WIDTH * HEIGHT, 0);
+    for (int v = 0; v < HEIGHT; v++) {
+        for (int u = 0; u < WIDTH; u++) {
+            Vec3f c((u - INTRINSICS.cx) / INTRINSICS.fx, (v - INTRINSICS.cy) / INTRINSICS.fy, -1.0f);
+            Vec3f dir(m[0] * c.x + m[4] * c.y + m[8] * c.z,
+                      m[1] * c.x + m[5] * c.y + m[9] * c.z,
+                      m[2] * c.x + m[6] * c.y + m[10] * c.z);
+            // The ray parameter is the depth, since the camera ray has z = -1
+            float best = 1e9f;
+            Vec3f oc = eye - SPHERE_CENTER;
+            float a = dir.dot(dir), b = oc.dot(dir);
+            float disc = b * b - a * (oc.dot(oc) - SPHERE_RADIUS * SPHERE_RADIUS);
+            if (disc > 0) best = (-b - std::sqrt(disc)) / a;
+            if (dir.y < 0) {
+                float tp = -eye.y / dir.y;
+                Vec3f hit = eye + dir * tp;
+                if (std::fabs(hit.x) < 0.2f && std::fabs(hit.z) < 0.2f) best = std::min(best, tp);
+            }
+            if (best < 1e8f) {
+                depth[v * WIDTH + u] = static_cast<uint16_t>(std::lround((best + noise(rng)) * 1000.0f));
+            }
+        }
+    }
+}
+
+void accuracy(const char* name, double ms, const TriangleMesh& mesh) {
+    std::vector<float> err;
+    for (const Vec3f& p : mesh.vertices()) {
+        if (p.y < 0.02f || (p - SPHERE_CENTER).length() > 0.15f) continue;  // sphere only
+        err.push_back(std::fabs((p - SPHERE_CENTER).length() - SPHERE_RADIUS) * 1000.0f);
+    }
+    std::sort(err.begin(), err.end());
+    float mean = 0;
+    for (float e : err) mean += e;
+    mean /= std::max<size_t>(1, err.size());
+    std::printf("%-34s %9.1f ms %9zu %9zu %8.2f %8.2f\n", name, ms, mesh.vertexCount(),
+                mesh.triangleCount(), mean, err.empty() ? 0.0f : err[err.size() * 95 / 100]);
+}
+
+} // namespace
+
+int main() {
+    const int frames = 48;
+    std::mt19937 rng(9);
+    std::vector<std::vector<uint16_t>> depth(frames);
+    std::vector<std::array<float, 16>> poses(frames);
+    for (int f = 0; f < frames; f++) {
+        float angle = 6.2831853f * f / frames;
+        lookAt(Vec3f(0.45f * std::cos(angle), 0.35f, 0.45f * std::sin(angle)),
+               Vec3f(0, 0.05f, 0), poses[f].data());
+        render(poses[f].data(), rng, depth[f]);
+    }
+    auto imageOf = [&](int f) {
+        DepthImage image;
+        image.depth_mm = depth[f].data();
+        image.depth_row_stride = WIDTH;
+        image.width = WIDTH;
+        image.height = HEIGHT;
+        image.intrinsics = INTRINSICS;
+        return image;
+    };
+
+    std::printf("%d frames %dx%d, 2 mm noise, %d hardware threads\n\n", frames, WIDTH, HEIGHT,
+                hardwareThreads());
+    std::printf("%-34s %12s %9s %9s %8s %8s\n", "", "time", "vertices", "triangles",
+                "mean mm", "p95 mm");
+
+    // TSDF: 0.44 m x 0.28 m x 0.44 m at 4 mm
+    TSDFVolume volume(Vec3f(-0.22f, -0.04f, -0.22f), 0.004f, 110, 70, 110);
+    volume.setDepthRange(0.1f, 3.0f);
+    Stopwatch fuse;
+    for (int f = 0; f < frames; f++) volume.integrate(imageOf(f), poses[f].data());
+    double fuse_ms = fuse.elapsedMs();
+    TriangleMesh tsdf_mesh;
+    double extract_ms = bestOf(1, [&] { tsdf_mesh = volume.extractMesh(); });
+    std::printf("%-34s %9.2f ms/frame  (%.0f MB volume)\n", "TSDF integrate", fuse_ms / frames,
+                volume.memoryBytes() / 1e6);
+    accuracy("TSDF marching cubes (post-scan)", extract_ms, tsdf_mesh);
+
+    // Post-scan reference on the accumulated points
+    VoxelMap map(0.002f);
+    DepthFrameIntegrator integrator;
+    integrator.setDepthRange(0.1f, 3.0f);
+    std::vector<Vec3f> origins;
+    for (int f = 0; f < frames; f++) {
+        integrator.integrate(imageOf(f), poses[f].data(), 1, f, map);
+        origins.emplace_back(poses[f][12], poses[f][13], poses[f][14]);
+    }
+    PointCloud cloud = map.toPointCloud();
+    TriangleMesh mc_mesh;
+    double sor_ms = 0, normal_ms = 0, mc_ms = 0;
+    {
+        Stopwatch sw;
+        PointCloud filtered = StatisticalOutlierRemoval(20, 2.0f).apply(cloud);
+        sor_ms = sw.elapsedMs();
+        sw.reset();
+        NormalEstimation estimation(15);
+        estimation.setViewpoints(origins);
+        estimation.setKeepExisting(true);
+        std::vector<Vec3f> normals = estimation.estimate(filtered);
+        normal_ms = sw.elapsedMs();
+        sw.reset();
+        mc_mesh = MarchingCubes(0.004f).reconstruct(filtered, normals);
+        mc_ms = sw.elapsedMs();
+    }
+    std::printf("%-34s %9.1f ms  (%zu points)\n", "SOR", sor_ms, cloud.size());
+    std::printf("%-34s %9.1f ms\n", "normals", normal_ms);
+    accuracy("k-NN SDF marching cubes", mc_ms, mc_mesh);
+    std::printf("%-34s %9.1f ms vs %.1f ms\n", "post-scan total (TSDF vs points)", extract_ms,
+                sor_ms + normal_ms + mc_ms);
+    return 0;
+}
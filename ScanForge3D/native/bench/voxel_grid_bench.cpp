@@ -0,0 +1,106 @@
+// Sort-based VoxelGridFilter vs the previous unordered_map version, on
+// the accumulated-cloud sizes PointCloudAccumulator.downsample sees.
+#include "bench_common.h"
+#include "point_cloud/voxel_grid_filter.h"
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+// The hash-map filter this replaced (positions only)
+static PointCloud hashVoxelFilter(const PointCloud& input, float voxel_size) {
+    struct Accum { double sx = 0, sy = 0, sz = 0; int count = 0; };
+    std::unordered_map<uint64_t, Accum> voxels;
+    float inv = 1.0f / voxel_size;
+    for (size_t i = 0; i < input.size(); i++) {
+        Vec3f p = input.getPoint(i);
+        uint64_t key = (static_cast<uint64_t>(static_cast<int>(std::floor(p.x * inv)) + (1 << 20)) << 42) |
+                       (static_cast<uint64_t>(static_cast<int>(std::floor(p.y * inv)) + (1 << 20)) << 21) |
+                        static_cast<uint64_t>(static_cast<int>(std::floor(p.z * inv)) + (1 << 20));
+        Accum& a = voxels[key];
+        a.sx += p.x; a.sy += p.y; a.sz += p.z; a.count++;
+    }
+    PointCloud out;
+    out.reserve(voxels.size());
+    for (const auto& [key, a] : voxels) {
+        out.addPoint({static_cast<float>(a.sx / a.count), static_cast<float>(a.sy / a.count),
+                      static_cast<float>(a.sz / a.count)});
+    }
+    return out;
+}
+
+// Centroids sorted by the voxel they fall in (each stays inside its voxel)
+static std::vector<Vec3f> sortedPoints(const PointCloud& cloud, float voxel) {
+    std::vector<Vec3f> pts = cloud.getPoints();
+    auto cell = [voxel](const Vec3f& p) {
+        return std::array<int, 3>{static_cast<int>(std::floor(p.x / voxel)),
+                                  static_cast<int>(std::floor(p.y / voxel)),
+                                  static_cast<int>(std::floor(p.z / voxel))};
+    };
+    std::sort(pts.begin(), pts.end(), [&](const Vec3f& a, const Vec3f& b) {
+        return cell(a) < cell(b);
+    });
+    return pts;
+}
+
+// Accumulator-like order: 50k-point frames around the object, each in
+// image-row order (what DepthFrameProcessor emits frame by frame)
+static PointCloud inScanOrder(const PointCloud& cloud) {
+    std::vector<Vec3f> pts = cloud.getPoints();
+    const size_t frames = std::max<size_t>(1, pts.size() / 50000);
+    auto frame = [frames](const Vec3f& p) {
+        float a = (std::atan2(p.z, p.x) + 3.14159265f) / 6.2831853f;
+        return std::min(frames - 1, static_cast<size_t>(a * frames));
+    };
+    std::sort(pts.begin(), pts.end(), [&](const Vec3f& a, const Vec3f& b) {
+        size_t fa = frame(a), fb = frame(b);
+        return fa != fb ? fa < fb : a.y > b.y;
+    });
+    PointCloud out;
+    out.reserve(pts.size());
+    for (const Vec3f& p : pts) out.addPoint(p);
+    return out;
+}
+
+int main() {
+    const float voxel = 0.002f;
+    std::printf("%-10s %-8s %10s %16s %14s %9s\n", "points", "order", "voxels",
+                "unordered_map", "radix sort", "speedup");
+    for (size_t n : {size_t(500000), size_t(1000000), size_t(2000000)})
+    for (bool scan_order : {false, true}) {
+        PointCloud cloud = makeScanCloud(n);
+        if (scan_order) cloud = inScanOrder(cloud);
+
+        PointCloud a, b;
+        double hash_ms = bestOf(3, [&] { a = hashVoxelFilter(cloud, voxel); });
+        double sort_ms = bestOf(5, [&] { b = VoxelGridFilter(voxel).apply(cloud); });
+
+        // Same voxels (up to float rounding of the centroids) ...
+        std::vector<Vec3f> pa = sortedPoints(a, voxel), pb = sortedPoints(b, voxel);
+        if (pa.size() != pb.size()) {
+            std::printf("MISMATCH: %zu vs %zu voxels\n", pa.size(), pb.size());
+            return 1;
+        }
+        for (size_t i = 0; i < pa.size(); i++) {
+            if (pa[i].distanceTo(pb[i]) > 1e-6f) {
+                std::printf("MISMATCH at voxel %zu\n", i);
+                return 1;
+            }
+        }
+        // ... and the same order every run
+        PointCloud c = VoxelGridFilter(voxel).apply(cloud);
+        for (size_t i = 0; i < b.size(); i++) {
+            if (b.getPoint(i).x != c.getPoint(i).x) {
+                std::printf("NONDETERMINISTIC at %zu\n", i);
+                return 1;
+            }
+        }
+
+        std::printf("%-10zu %-8s %10zu %13.1f ms %11.1f ms %8.2fx\n", n,
+                    scan_order ? "scan" : "random", b.size(), hash_ms, sort_ms,
+                    hash_ms / sort_ms);
+    }
+    return 0;
+}
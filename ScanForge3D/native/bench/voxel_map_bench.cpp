@@ -0,0 +1,85 @@
+// Streaming accumulation: VoxelMap (merge every frame) vs the previous
+// PointCloudAccumulator scheme (append raw points, re-run the voxel
+// filter over everything every 10 frames). ~20k points per frame, the
+// size of a subsampled ARCore depth frame. The camera sweeps along x, so
+// every frame partly overlaps the previous ones and partly adds new
+// surface, and the accumulated cloud keeps growing.
+#include "bench_common.h"
+#include "point_cloud/voxel_grid_filter.h"
+#include "point_cloud/voxel_map.h"
+#include <vector>
+
+using namespace scanforge;
+using namespace scanforge::bench;
+
+static std::vector<float> flatten(const PointCloud& cloud, float shift_x = 0.0f) {
+    std::vector<float> flat(cloud.size() * 3);
+    for (size_t i = 0; i < cloud.size(); i++) {
+        flat[3 * i] = cloud.xs()[i] + shift_x;
+        flat[3 * i + 1] = cloud.ys()[i];
+        flat[3 * i + 2] = cloud.zs()[i];
+    }
+    return flat;
+}
+
+int main() {
+    const int frames = 300;
+    const size_t frame_points = 20000;
+    const float voxel = 0.002f;
+
+    std::vector<std::vector<float>> stream;
+    for (int f = 0; f < frames; f++) {
+        stream.push_back(flatten(makeScanCloud(frame_points, 1000 + f), 0.02f * f));
+    }
+
+    std::printf("%6s %12s %18s %18s\n", "frames", "voxels",
+                "map [ms/frame]", "refilter [ms/frame]");
+
+    VoxelMap map(voxel);
+    std::vector<float> raw;
+    double map_ms = 0, refilter_ms = 0;
+    int window = 0;
+    for (int f = 0; f < frames; f++) {
+        Stopwatch sw;
+        map.addPoints(stream[f].data(), nullptr, frame_points);
+        map_ms += sw.elapsedMs();
+
+        // Old scheme: append, and every 10 frames filter the whole list
+        sw.reset();
+        raw.insert(raw.end(), stream[f].begin(), stream[f].end());
+        if ((f + 1) % 10 == 0) {
+            PointCloud cloud;
+            cloud.resize(raw.size() / 3);
+            for (size_t i = 0; i < cloud.size(); i++) {
+                cloud.xs()[i] = raw[3 * i];
+                cloud.ys()[i] = raw[3 * i + 1];
+                cloud.zs()[i] = raw[3 * i + 2];
+            }
+            PointCloud filtered = VoxelGridFilter(voxel).apply(cloud);
+            raw = flatten(filtered);
+        }
+        refilter_ms += sw.elapsedMs();
+
+        if (++window == 50) {
+            std::printf("%6d %12zu %18.2f %18.2f\n", f + 1, map.size(),
+                        map_ms / window, refilter_ms / window);
+            map_ms = refilter_ms = 0;
+            window = 0;
+        }
+    }
+
+    // Same cells as a one-shot filter over all frames; means differ only
+    // by float accumulation order
+    PointCloud all;
+    for (const auto& frame : stream) {
+        for (size_t i = 0; i < frame_points; i++) {
+            all.addPoint({frame[3 * i], frame[3 * i + 1], frame[3 * i + 2]});
+        }
+    }
+    PointCloud reference = VoxelGridFilter(voxel).apply(all);
+    Stopwatch sw;
+    PointCloud accumulated = map.toPointCloud();
+    std::printf("\nexport %zu voxels: %.2f ms; one-shot filter over %zu points: %zu voxels\n",
+                accumulated.size(), sw.elapsedMs(), all.size(), reference.size());
+    return 0;
+}
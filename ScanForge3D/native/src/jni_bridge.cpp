@@ -3,13 +3,19 @@
 #include "point_cloud/point_cloud.h"
 #include "point_cloud/icp_registration.h"
 #include "point_cloud/voxel_grid_filter.h"
+#include "point_cloud/voxel_map.h"
 #include "point_cloud/statistical_outlier_removal.h"
+#include "point_cloud/radius_outlier_removal.h"
 #include "mesh/poisson_reconstruction.h"
 #include "mesh/marching_cubes.h"
+#include "mesh/sparse_tsdf_volume.h"
 #include "mesh/mesh_decimation.h"
 #include "mesh/mesh_repair.h"
 #include "mesh/mesh_smoothing.h"
 #include "point_cloud/normal_estimation.h"
+#include "point_cloud/depth_frame_worker.h"
+#include "util/morton_order.h"
+#include "util/neighborhood_index.h"
 #include "export/stl_writer.h"
 #include "export/obj_writer.h"
 #include "export/ply_writer.h"
@@ -20,6 +26,22 @@
 
 using namespace scanforge;
 
+// Helper: read an optional [nx,ny,nz, ...] array with one normal per
+// point; false if it is null or too short
+static bool readNormals(JNIEnv *env, jfloatArray normals_flat, int num_points,
+                        std::vector<Vec3f>& normals) {
+    if (normals_flat == nullptr || env->GetArrayLength(normals_flat) < num_points * 3) {
+        return false;
+    }
+    std::vector<float> flat(num_points * 3);
+    env->GetFloatArrayRegion(normals_flat, 0, flat.size(), flat.data());
+    normals.resize(num_points);
+    for (int i = 0; i < num_points; i++) {
+        normals[i] = Vec3f(flat[i*3], flat[i*3+1], flat[i*3+2]);
+    }
+    return true;
+}
+
 // Helper: deserialize flat float array to TriangleMesh
 static TriangleMesh deserializeMesh(jfloat *data) {
     int vcount = static_cast<int>(data[0]);
@@ -103,6 +125,91 @@ Java_com_scanforge3d_processing_NativeMeshProcessor_voxelGridFilter(
     return result;
 }
 
+/**
+ * Voxel filter with confidence weighting and adaptive cell size
+ *
+ * @param points_flat Float-Array [x0,y0,z0, x1,y1,z1, ...]
+ * @param confidence Per-point confidence in [0, 1], or null; points are
+ *                   weighted by it when averaging
+ * @param frame_ids Per-point source frame, or null
+ * @param normals Per-point normals [nx0,ny0,nz0, ...], or null; summed
+ *                per voxel and renormalized
+ * @param voxel_size Finest voxel edge length in meters
+ * @param adaptive_levels Flat cells up to 2^levels voxels wide are merged
+ *                        into one point (0 = fixed voxel size)
+ * @param max_plane_deviation RMS distance from a plane (meters) under
+ *                            which a cell counts as flat
+ * @param frame_ids_out, normals_out Caller arrays sized for the input
+ *        that receive the per-voxel frame id / normal, or null
+ */
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelGridFilterWeighted(
+    JNIEnv *env, jobject thiz,
+    jfloatArray points_flat, jfloatArray confidence, jintArray frame_ids,
+    jfloatArray normals, jfloat voxel_size, jint adaptive_levels,
+    jfloat max_plane_deviation, jintArray frame_ids_out, jfloatArray normals_out) {
+
+    jsize len = env->GetArrayLength(points_flat);
+    int num_points = len / 3;
+
+    PointCloud cloud;
+    cloud.resize(num_points);
+    jfloat *points = env->GetFloatArrayElements(points_flat, nullptr);
+    for (int i = 0; i < num_points; i++) {
+        cloud.setPoint(i, {points[i*3], points[i*3+1], points[i*3+2]});
+    }
+    env->ReleaseFloatArrayElements(points_flat, points, JNI_ABORT);
+
+    if (confidence != nullptr && env->GetArrayLength(confidence) == num_points) {
+        std::vector<float> conf(num_points);
+        env->GetFloatArrayRegion(confidence, 0, num_points, conf.data());
+        cloud.setConfidence(std::move(conf));
+    }
+    if (frame_ids != nullptr && env->GetArrayLength(frame_ids) == num_points) {
+        std::vector<int32_t> ids(num_points);
+        env->GetIntArrayRegion(frame_ids, 0, num_points, ids.data());
+        cloud.setFrameIds(std::move(ids));
+    }
+    std::vector<Vec3f> point_normals;
+    if (readNormals(env, normals, num_points, point_normals)) {
+        cloud.setNormals(std::move(point_normals));
+    }
+
+    VoxelGridFilter filter(voxel_size);
+    filter.setConfidenceWeighting(true);
+    filter.setAdaptive(adaptive_levels, max_plane_deviation);
+    PointCloud filtered = filter.apply(cloud);
+
+    LOGI("Voxel filter (weighted=%d, levels=%d): %d -> %zu points",
+         cloud.hasConfidence(), adaptive_levels, num_points, filtered.size());
+
+    // Per-voxel frame ids and normals go to the caller's arrays (sized
+    // for the input)
+    if (filtered.hasFrameIds() && frame_ids_out != nullptr &&
+        static_cast<size_t>(env->GetArrayLength(frame_ids_out)) >= filtered.size()) {
+        env->SetIntArrayRegion(frame_ids_out, 0, filtered.size(), filtered.frameIds().data());
+    }
+    if (filtered.hasNormals() && normals_out != nullptr &&
+        static_cast<size_t>(env->GetArrayLength(normals_out)) >= filtered.size() * 3) {
+        std::vector<float> flat(filtered.size() * 3);
+        for (size_t i = 0; i < filtered.size(); i++) {
+            const Vec3f& n = filtered.normals()[i];
+            flat[i*3] = n.x; flat[i*3+1] = n.y; flat[i*3+2] = n.z;
+        }
+        env->SetFloatArrayRegion(normals_out, 0, flat.size(), flat.data());
+    }
+
+    std::vector<float> flat(filtered.size() * 3);
+    for (size_t i = 0; i < filtered.size(); i++) {
+        flat[i*3] = filtered.xs()[i];
+        flat[i*3+1] = filtered.ys()[i];
+        flat[i*3+2] = filtered.zs()[i];
+    }
+    jfloatArray result = env->NewFloatArray(flat.size());
+    env->SetFloatArrayRegion(result, 0, flat.size(), flat.data());
+    return result;
+}
+
 JNIEXPORT jfloatArray JNICALL
 Java_com_scanforge3d_processing_NativeMeshProcessor_statisticalOutlierRemoval(
     JNIEnv *env, jobject thiz,
@@ -134,11 +241,61 @@ Java_com_scanforge3d_processing_NativeMeshProcessor_statisticalOutlierRemoval(
     return result;
 }
 
+/**
+ * Radius Outlier Removal: keeps points with at least min_neighbors other
+ * points within radius. Hash-grid based, for voxel-filtered clouds.
+ */
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_radiusOutlierRemoval(
+    JNIEnv *env, jobject thiz,
+    jfloatArray points_flat, jfloat radius, jint min_neighbors) {
+
+    jfloat *points = env->GetFloatArrayElements(points_flat, nullptr);
+    jsize len = env->GetArrayLength(points_flat);
+    int num_points = len / 3;
+
+    PointCloud cloud;
+    cloud.reserve(num_points);
+    for (int i = 0; i < num_points; i++) {
+        cloud.addPoint({points[i*3], points[i*3+1], points[i*3+2]});
+    }
+    env->ReleaseFloatArrayElements(points_flat, points, 0);
+
+    RadiusOutlierRemoval ror(radius, min_neighbors);
+    PointCloud cleaned = ror.apply(cloud);
+
+    LOGI("ROR: %d -> %zu points (r=%.4f, min=%d)",
+         num_points, cleaned.size(), radius, min_neighbors);
+
+    jfloatArray result = env->NewFloatArray(cleaned.size() * 3);
+    std::vector<float> flat(cleaned.size() * 3);
+    for (size_t i = 0; i < cleaned.size(); i++) {
+        const auto& p = cleaned.getPoint(i);
+        flat[i*3] = p.x; flat[i*3+1] = p.y; flat[i*3+2] = p.z;
+    }
+    env->SetFloatArrayRegion(result, 0, flat.size(), flat.data());
+    return result;
+}
+
+/**
+ * ICP Registration: rigid transform mapping source onto target
+ *
+ * @param target_normals Float-Array [nx0,ny0,nz0, ...] per target point,
+ *                       or null; with normals point-to-plane ICP is used
+ * @param pyramid_levels Resolution levels incl. the full clouds; levels
+ *                       above 1 are voxel-downsampled and registered
+ *                       coarse to fine (<= 1 = full resolution only)
+ * @param pyramid_voxel_size Voxel size of the finest downsampled level,
+ *                       doubling per coarser level
+ * @return Column-major 4x4 matrix
+ */
 JNIEXPORT jfloatArray JNICALL
 Java_com_scanforge3d_processing_NativeMeshProcessor_icpRegistration(
     JNIEnv *env, jobject thiz,
-    jfloatArray source_flat, jfloatArray target_flat,
-    jint max_iterations, jfloat tolerance) {
+    jfloatArray source_flat, jfloatArray target_flat, jfloatArray target_normals,
+    jint max_iterations, jfloat tolerance,
+    jfloat approx_epsilon, jint max_leaf_visits,
+    jint pyramid_levels, jfloat pyramid_voxel_size) {
 
     jfloat *src = env->GetFloatArrayElements(source_flat, nullptr);
     jsize src_len = env->GetArrayLength(source_flat);
@@ -156,7 +313,14 @@ Java_com_scanforge3d_processing_NativeMeshProcessor_icpRegistration(
     }
     env->ReleaseFloatArrayElements(target_flat, tgt, 0);
 
+    std::vector<Vec3f> normals;
+    bool point_to_plane = readNormals(env, target_normals, static_cast<int>(target.size()), normals);
+    if (point_to_plane) target.setNormals(std::move(normals));
+
     ICPRegistration icp(max_iterations, tolerance);
+    icp.setApproximateSearch(approx_epsilon, max_leaf_visits);
+    icp.setPointToPlane(point_to_plane);
+    icp.setPyramid(pyramid_levels, pyramid_voxel_size);
     auto result_matrix = icp.align(source, target);
 
     LOGI("ICP converged: fitness=%.6f, rmse=%.6f",
@@ -167,6 +331,461 @@ Java_com_scanforge3d_processing_NativeMeshProcessor_icpRegistration(
     return result;
 }
 
+/**
+ * Shared Neighborhood Index
+ *
+ * Builds one KD-tree and k-NN graph for the post-scan pipeline. The
+ * *Indexed functions below operate on it in place, so outlier removal,
+ * normal estimation and reconstruction pay for spatial indexing once.
+ * The returned handle must be passed to releaseNeighborhoodIndex.
+ *
+ * @param points_flat Float-Array [x0,y0,z0, x1,y1,z1, ...]
+ * @param k_neighbors Neighbors per point incl. the point itself; use the
+ *                    largest k any later stage needs (SOR needs k+1)
+ */
+JNIEXPORT jlong JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_createNeighborhoodIndex(
+    JNIEnv *env, jobject thiz,
+    jfloatArray points_flat, jint k_neighbors, jintArray frame_ids,
+    jfloatArray normals) {
+
+    jfloat *points = env->GetFloatArrayElements(points_flat, nullptr);
+    jsize len = env->GetArrayLength(points_flat);
+    int num_points = len / 3;
+
+    PointCloud cloud;
+    cloud.reserve(num_points);
+    for (int i = 0; i < num_points; i++) {
+        cloud.addPoint({points[i*3], points[i*3+1], points[i*3+2]});
+    }
+    env->ReleaseFloatArrayElements(points_flat, points, 0);
+
+    // Optional source frame per point, for viewpoint normal orientation;
+    // extra trailing entries are ignored
+    if (frame_ids != nullptr && env->GetArrayLength(frame_ids) >= num_points) {
+        std::vector<int32_t> ids(num_points);
+        env->GetIntArrayRegion(frame_ids, 0, num_points, ids.data());
+        cloud.setFrameIds(std::move(ids));
+    }
+    // Optional normals carried from the scan ((0, 0, 0) = none)
+    std::vector<Vec3f> point_normals;
+    if (readNormals(env, normals, num_points, point_normals)) {
+        cloud.setNormals(std::move(point_normals));
+    }
+
+    auto *index = new NeighborhoodIndex(std::move(cloud), k_neighbors);
+    LOGI("Neighborhood index: %d points, k=%d", num_points, index->graph().k);
+    return reinterpret_cast<jlong>(index);
+}
+
+JNIEXPORT void JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_releaseNeighborhoodIndex(
+    JNIEnv *env, jobject thiz, jlong handle) {
+    delete reinterpret_cast<NeighborhoodIndex *>(handle);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_statisticalOutlierRemovalIndexed(
+    JNIEnv *env, jobject thiz,
+    jlong handle, jint k_neighbors, jfloat std_ratio) {
+
+    auto *index = reinterpret_cast<NeighborhoodIndex *>(handle);
+    size_t before = index->size();
+
+    StatisticalOutlierRemoval sor(k_neighbors, std_ratio);
+    sor.apply(*index);
+
+    LOGI("SOR (indexed): %zu -> %zu points", before, index->size());
+    return static_cast<jint>(index->size());
+}
+
+JNIEXPORT jint JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_radiusOutlierRemovalIndexed(
+    JNIEnv *env, jobject thiz,
+    jlong handle, jfloat radius, jint min_neighbors) {
+
+    auto *index = reinterpret_cast<NeighborhoodIndex *>(handle);
+    size_t before = index->size();
+
+    RadiusOutlierRemoval ror(radius, min_neighbors);
+    ror.apply(*index);
+
+    LOGI("ROR (indexed): %zu -> %zu points", before, index->size());
+    return static_cast<jint>(index->size());
+}
+
+JNIEXPORT jint JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_estimateNormalsIndexed(
+    JNIEnv *env, jobject thiz, jlong handle, jint k_neighbors,
+    jfloatArray camera_origins, jboolean keep_existing) {
+
+    auto *index = reinterpret_cast<NeighborhoodIndex *>(handle);
+
+    NormalEstimation estimator(k_neighbors);
+    // Camera position per frame id [x0,y0,z0, x1,y1,z1, ...]; with frame
+    // ids on the index, normals are oriented toward them
+    if (camera_origins != nullptr) {
+        jsize len = env->GetArrayLength(camera_origins);
+        std::vector<float> flat(len);
+        env->GetFloatArrayRegion(camera_origins, 0, len, flat.data());
+        std::vector<Vec3f> origins(len / 3);
+        for (size_t f = 0; f < origins.size(); f++) {
+            origins[f] = Vec3f(flat[f*3], flat[f*3+1], flat[f*3+2]);
+        }
+        estimator.setViewpoints(std::move(origins));
+    }
+    // Normals already on the index (from the scan) stay; PCA fills the rest
+    estimator.setKeepExisting(keep_existing);
+    index->setNormals(estimator.estimate(*index));
+
+    LOGI("Normal estimation (indexed): %zu normals", index->size());
+    return static_cast<jint>(index->size());
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_poissonReconstructionIndexed(
+    JNIEnv *env, jobject thiz, jlong handle, jint depth) {
+
+    auto *index = reinterpret_cast<NeighborhoodIndex *>(handle);
+
+    PoissonReconstruction poisson(depth);
+    TriangleMesh mesh = poisson.reconstruct(*index);
+
+    LOGI("Poisson result (indexed): %zu vertices, %zu triangles",
+         mesh.vertexCount(), mesh.triangleCount());
+
+    return serializeMesh(env, mesh);
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_marchingCubesReconstructionIndexed(
+    JNIEnv *env, jobject thiz, jlong handle, jfloat voxel_size) {
+
+    auto *index = reinterpret_cast<NeighborhoodIndex *>(handle);
+
+    MarchingCubes mc(voxel_size);
+    TriangleMesh mesh = mc.reconstruct(*index);
+
+    LOGI("Marching Cubes result (indexed): %zu vertices, %zu triangles",
+         mesh.vertexCount(), mesh.triangleCount());
+
+    return serializeMesh(env, mesh);
+}
+
+/**
+ * Streaming Voxel Map
+ *
+ * Persistent per-scan accumulator: each frame is merged into running
+ * voxel means, so a frame costs O(frame size) regardless of how much has
+ * been accumulated. The returned handle must be passed to
+ * releaseVoxelMap.
+ *
+ * @param voxel_size Voxel edge length in meters
+ * @param max_voxels Voxel limit (0 = unlimited); points that would need
+ *                   a new voxel beyond it are dropped
+ */
+JNIEXPORT jlong JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_createVoxelMap(
+    JNIEnv *env, jobject thiz, jfloat voxel_size, jint max_voxels) {
+    auto *map = new VoxelMap(voxel_size, max_voxels > 0 ? max_voxels : 0);
+    return reinterpret_cast<jlong>(map);
+}
+
+JNIEXPORT void JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_releaseVoxelMap(
+    JNIEnv *env, jobject thiz, jlong handle) {
+    delete reinterpret_cast<VoxelMap *>(handle);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelMapAddPoints(
+    JNIEnv *env, jobject thiz, jlong handle,
+    jfloatArray points_flat, jfloatArray confidence, jint frame_id,
+    jfloatArray normals) {
+
+    auto *map = reinterpret_cast<VoxelMap *>(handle);
+    jsize len = env->GetArrayLength(points_flat);
+    int num_points = len / 3;
+
+    // Read-only access; JNI_ABORT skips the copy-back. Confidence and
+    // normals are optional and ignored unless they have one entry per
+    // point.
+    jfloat *points = env->GetFloatArrayElements(points_flat, nullptr);
+    jfloat *conf = nullptr;
+    if (confidence != nullptr && env->GetArrayLength(confidence) == num_points) {
+        conf = env->GetFloatArrayElements(confidence, nullptr);
+    }
+    jfloat *norm = nullptr;
+    if (normals != nullptr && env->GetArrayLength(normals) == len) {
+        norm = env->GetFloatArrayElements(normals, nullptr);
+    }
+    map->addPoints(points, conf, num_points, frame_id, norm);
+    if (norm != nullptr) env->ReleaseFloatArrayElements(normals, norm, JNI_ABORT);
+    if (conf != nullptr) env->ReleaseFloatArrayElements(confidence, conf, JNI_ABORT);
+    env->ReleaseFloatArrayElements(points_flat, points, JNI_ABORT);
+
+    return static_cast<jint>(map->size());
+}
+
+JNIEXPORT jint JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelMapSize(
+    JNIEnv *env, jobject thiz, jlong handle) {
+    return static_cast<jint>(reinterpret_cast<VoxelMap *>(handle)->size());
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelMapGetPoints(
+    JNIEnv *env, jobject thiz, jlong handle) {
+
+    auto *map = reinterpret_cast<VoxelMap *>(handle);
+    LOGI("Voxel map: %zu points -> %zu voxels", map->pointCount(), map->size());
+
+    std::vector<float> flat(map->size() * 3);
+    map->copyPoints(flat.data());
+    jfloatArray result = env->NewFloatArray(flat.size());
+    env->SetFloatArrayRegion(result, 0, flat.size(), flat.data());
+    return result;
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelMapGetConfidence(
+    JNIEnv *env, jobject thiz, jlong handle) {
+
+    const std::vector<float>& confidence =
+        reinterpret_cast<VoxelMap *>(handle)->confidence();
+    jfloatArray result = env->NewFloatArray(confidence.size());
+    env->SetFloatArrayRegion(result, 0, confidence.size(), confidence.data());
+    return result;
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelMapGetNormals(
+    JNIEnv *env, jobject thiz, jlong handle) {
+
+    auto *map = reinterpret_cast<VoxelMap *>(handle);
+    if (!map->hasNormals()) return env->NewFloatArray(0);
+    std::vector<float> flat(map->size() * 3);
+    map->copyNormals(flat.data());
+    jfloatArray result = env->NewFloatArray(flat.size());
+    env->SetFloatArrayRegion(result, 0, flat.size(), flat.data());
+    return result;
+}
+
+JNIEXPORT jintArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelMapGetFrameIds(
+    JNIEnv *env, jobject thiz, jlong handle) {
+
+    const std::vector<int32_t>& frame_ids =
+        reinterpret_cast<VoxelMap *>(handle)->frameIds();
+    jintArray result = env->NewIntArray(frame_ids.size());
+    env->SetIntArrayRegion(result, 0, frame_ids.size(), frame_ids.data());
+    return result;
+}
+
+JNIEXPORT void JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelMapClear(
+    JNIEnv *env, jobject thiz, jlong handle) {
+    reinterpret_cast<VoxelMap *>(handle)->clear();
+}
+
+/**
+ * TSDF Volume
+ *
+ * Sparse truncated signed distance field fused from depth frames (by
+ * the depth frame worker): 8x8x8 voxel blocks are allocated where
+ * surfaces are observed, so the volume needs no placement and grows
+ * with the scan up to a memory budget. Past the budget the least
+ * recently observed blocks are written to the spill file, or dropped
+ * without one. The surface is extracted with marching cubes directly on
+ * the blocks. The returned handle must be passed to releaseTSDFVolume.
+ *
+ * @param voxel_size Voxel edge length in meters
+ * @param truncation Truncation distance in meters (<= 0: 4 voxels)
+ * @param memory_budget_mb Memory for resident blocks, in MiB
+ * @param spill_path File for evicted blocks, or null to drop them
+ * @param min_depth, max_depth Valid depth range in meters
+ * @param min_confidence Pixels below this confidence (0-255) are ignored
+ */
+JNIEXPORT jlong JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_createTSDFVolume(
+    JNIEnv *env, jobject thiz, jfloat voxel_size, jfloat truncation, jint memory_budget_mb,
+    jstring spill_path, jfloat min_depth, jfloat max_depth, jint min_confidence) {
+    size_t budget = static_cast<size_t>(std::max(1, memory_budget_mb)) << 20;
+    auto *volume = new SparseTSDFVolume(voxel_size, budget, truncation);
+    volume->setDepthRange(min_depth, max_depth);
+    volume->setMinConfidence(static_cast<uint8_t>(std::min(255, std::max(0, min_confidence))));
+    if (spill_path) {
+        const char *path = env->GetStringUTFChars(spill_path, nullptr);
+        if (!volume->setSpillFile(path)) {
+            LOGI("TSDF volume: cannot open spill file %s, evicted blocks are dropped", path);
+        }
+        env->ReleaseStringUTFChars(spill_path, path);
+    }
+    LOGI("TSDF volume: %.4f m voxels, up to %zu blocks in %d MiB",
+         voxel_size, volume->stats().max_blocks, memory_budget_mb);
+    return reinterpret_cast<jlong>(volume);
+}
+
+JNIEXPORT void JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_releaseTSDFVolume(
+    JNIEnv *env, jobject thiz, jlong handle) {
+    delete reinterpret_cast<SparseTSDFVolume *>(handle);
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_tsdfVolumeExtractMesh(
+    JNIEnv *env, jobject thiz, jlong handle) {
+
+    auto *volume = reinterpret_cast<SparseTSDFVolume *>(handle);
+    TriangleMesh mesh = volume->extractMesh();
+
+    SparseTSDFVolume::Stats stats = volume->stats();
+    LOGI("TSDF surface: %zu vertices, %zu triangles (%zu resident, %zu spilled, "
+         "%zu dropped blocks, %zu bytes)",
+         mesh.vertexCount(), mesh.triangleCount(), stats.resident_blocks,
+         stats.spilled_blocks, stats.dropped_blocks, stats.memory_bytes);
+
+    return serializeMesh(env, mesh);
+}
+
+/**
+ * Depth Frame Worker
+ *
+ * Depth frames are integrated into a voxel map on a native worker
+ * thread. depthFrameWorkerSubmit copies the ARCore depth and confidence
+ * images (read in place from the direct buffers) into a preallocated
+ * slot of a lock-free ring and returns immediately; the worker
+ * unprojects and filters them with SIMD, estimates normals on the
+ * organized depth image and merges the points into the map. When the
+ * worker falls behind, frames are dropped instead of blocking the
+ * caller. The map (and TSDF volume) must not be read or released
+ * before releaseDepthFrameWorker, which finishes the queued frames
+ * first.
+ *
+ * With refine_pose, each frame is tracked against the TSDF volume by
+ * projective point-to-plane ICP before it is integrated, correcting
+ * ARCore pose drift.
+ *
+ * @param map_handle Voxel map the worker writes to
+ * @param tsdf_handle TSDF volume every frame is also fused into, or 0
+ * @param capacity Number of frame slots
+ * @param max_pixels Slot size in pixels (width * height of the depth image)
+ * @param window_radius Normal smoothing window radius in pixels
+ * @param max_depth_change Relative depth jump treated as an edge
+ * @param min_depth, max_depth Valid depth range in meters
+ * @param min_confidence Pixels below this confidence (0-255) are dropped
+ * @param refine_pose Track frames against the TSDF volume (needs tsdf_handle)
+ */
+JNIEXPORT jlong JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_createDepthFrameWorker(
+    JNIEnv *env, jobject thiz, jlong map_handle, jlong tsdf_handle, jint capacity,
+    jint max_pixels, jint window_radius, jfloat max_depth_change,
+    jfloat min_depth, jfloat max_depth, jint min_confidence, jboolean refine_pose) {
+    auto *map = reinterpret_cast<VoxelMap *>(map_handle);
+    auto *worker = new DepthFrameWorker(*map, std::max(1, capacity), std::max(0, max_pixels),
+                                        window_radius, max_depth_change);
+    worker->setDepthRange(min_depth, max_depth);
+    worker->setMinConfidence(static_cast<uint8_t>(std::min(255, std::max(0, min_confidence))));
+    worker->setTSDFVolume(reinterpret_cast<SparseTSDFVolume *>(tsdf_handle));
+    worker->setPoseRefinement(refine_pose == JNI_TRUE);
+    worker->start();
+    LOGI("Depth frame worker: %d slots of %d pixels", capacity, max_pixels);
+    return reinterpret_cast<jlong>(worker);
+}
+
+JNIEXPORT void JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_releaseDepthFrameWorker(
+    JNIEnv *env, jobject thiz, jlong handle) {
+    auto *worker = reinterpret_cast<DepthFrameWorker *>(handle);
+    worker->stop();
+    DepthFrameWorkerStats stats = worker->stats();
+    LOGI("Depth frame worker: %llu frames integrated (%llu pose-refined, %llu refinements "
+         "rejected), %llu of %llu dropped, %llu invalid",
+         (unsigned long long)stats.integrated, (unsigned long long)stats.refined,
+         (unsigned long long)stats.refine_rejected, (unsigned long long)stats.dropped,
+         (unsigned long long)stats.submitted, (unsigned long long)stats.rejected);
+    delete worker;
+}
+
+/**
+ * @param depth_buffer Direct buffer, 16-bit little-endian depth in mm
+ * @param depth_row_stride, confidence_row_stride Row strides in bytes
+ * @param confidence_buffer Direct buffer, 8-bit confidence, or null
+ * @param pose Column-major camera-to-world matrix (Pose.toMatrix)
+ * @param stride Sampling step in pixels
+ * @param frame_id Frame number stored with the voxels
+ * @return True if the frame was queued, false if it was dropped (ring
+ *         full) or rejected (a buffer is not direct or too short for
+ *         height rows of its stride, or a stride is invalid)
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_depthFrameWorkerSubmit(
+    JNIEnv *env, jobject thiz, jlong handle,
+    jobject depth_buffer, jint depth_row_stride,
+    jobject confidence_buffer, jint confidence_row_stride,
+    jint width, jint height, jfloat fx, jfloat fy, jfloat cx, jfloat cy,
+    jfloatArray pose, jint stride, jint frame_id) {
+
+    auto *worker = reinterpret_cast<DepthFrameWorker *>(handle);
+
+    // Bytes the worker reads from a buffer: height rows of row_stride,
+    // the last one only width pixels long
+    auto fits = [&](jobject buffer, jint row_stride, int bytes_per_pixel) {
+        if (width <= 0 || height <= 0 || row_stride < width * bytes_per_pixel) return false;
+        jlong needed = static_cast<jlong>(height - 1) * row_stride +
+                       static_cast<jlong>(width) * bytes_per_pixel;
+        return env->GetDirectBufferCapacity(buffer) >= needed;
+    };
+
+    // An unusable buffer is passed on as missing, so submit() counts the
+    // frame as rejected
+    DepthImage image;
+    image.depth_mm = static_cast<const uint16_t *>(env->GetDirectBufferAddress(depth_buffer));
+    if (image.depth_mm == nullptr) {
+        LOGE("depthFrameWorkerSubmit: depth buffer is not direct");
+    } else if (depth_row_stride % 2 != 0 || !fits(depth_buffer, depth_row_stride, 2)) {
+        image.depth_mm = nullptr;
+    }
+    image.depth_row_stride = depth_row_stride / 2;
+    if (confidence_buffer != nullptr) {
+        image.confidence = static_cast<const uint8_t *>(env->GetDirectBufferAddress(confidence_buffer));
+        if (image.confidence == nullptr || !fits(confidence_buffer, confidence_row_stride, 1)) {
+            image.depth_mm = nullptr;
+        }
+        image.confidence_row_stride = confidence_row_stride;
+    }
+    image.width = width;
+    image.height = height;
+    image.intrinsics = DepthIntrinsics{fx, fy, cx, cy};
+
+    float pose_matrix[16];
+    bool has_pose = pose != nullptr && env->GetArrayLength(pose) == 16;
+    if (has_pose) env->GetFloatArrayRegion(pose, 0, 16, pose_matrix);
+
+    return worker->submit(image, has_pose ? pose_matrix : nullptr, stride, frame_id)
+        ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * @return Long-Array [queued, capacity, submitted, dropped, integrated, voxels, refined,
+ *         rejected, refine_rejected]
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_depthFrameWorkerStats(
+    JNIEnv *env, jobject thiz, jlong handle) {
+    DepthFrameWorkerStats stats = reinterpret_cast<DepthFrameWorker *>(handle)->stats();
+    jlong values[9] = {
+        static_cast<jlong>(stats.queued), static_cast<jlong>(stats.capacity),
+        static_cast<jlong>(stats.submitted), static_cast<jlong>(stats.dropped),
+        static_cast<jlong>(stats.integrated), static_cast<jlong>(stats.map_size),
+        static_cast<jlong>(stats.refined), static_cast<jlong>(stats.rejected),
+        static_cast<jlong>(stats.refine_rejected)
+    };
+    jlongArray result = env->NewLongArray(9);
+    env->SetLongArrayRegion(result, 0, 9, values);
+    return result;
+}
+
 /**
  * PCA Normal Estimation: Computes surface normals for a point cloud
  *
@@ -303,6 +922,9 @@ Java_com_scanforge3d_processing_NativeMeshProcessor_smoothMesh(
     TriangleMesh mesh = deserializeMesh(data);
     env->ReleaseFloatArrayElements(mesh_data, data, 0);
 
+    // Z-curve vertex order keeps neighbor lookups in cache
+    MortonOrder::sortMesh(mesh);
+
     MeshSmoothing smoother;
     smoother.taubinSmooth(mesh, iterations, lambda);
 
@@ -9,15 +9,136 @@ JNIEXPORT jfloatArray JNICALL
 Java_com_scanforge3d_processing_NativeMeshProcessor_voxelGridFilter(
     JNIEnv *env, jobject thiz, jfloatArray points_flat, jfloat voxel_size);
 
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelGridFilterWeighted(
+    JNIEnv *env, jobject thiz, jfloatArray points_flat, jfloatArray confidence,
+    jintArray frame_ids, jfloatArray normals, jfloat voxel_size, jint adaptive_levels,
+    jfloat max_plane_deviation, jintArray frame_ids_out, jfloatArray normals_out);
+
 JNIEXPORT jfloatArray JNICALL
 Java_com_scanforge3d_processing_NativeMeshProcessor_statisticalOutlierRemoval(
     JNIEnv *env, jobject thiz, jfloatArray points_flat,
     jint k_neighbors, jfloat std_ratio);
 
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_radiusOutlierRemoval(
+    JNIEnv *env, jobject thiz, jfloatArray points_flat,
+    jfloat radius, jint min_neighbors);
+
 JNIEXPORT jfloatArray JNICALL
 Java_com_scanforge3d_processing_NativeMeshProcessor_icpRegistration(
     JNIEnv *env, jobject thiz, jfloatArray source_flat, jfloatArray target_flat,
-    jint max_iterations, jfloat tolerance);
+    jfloatArray target_normals, jint max_iterations, jfloat tolerance,
+    jfloat approx_epsilon, jint max_leaf_visits,
+    jint pyramid_levels, jfloat pyramid_voxel_size);
+
+// Shared neighborhood index: one KD-tree + k-NN graph reused by
+// outlier removal, normal estimation and reconstruction
+JNIEXPORT jlong JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_createNeighborhoodIndex(
+    JNIEnv *env, jobject thiz, jfloatArray points_flat, jint k_neighbors,
+    jintArray frame_ids, jfloatArray normals);
+
+JNIEXPORT void JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_releaseNeighborhoodIndex(
+    JNIEnv *env, jobject thiz, jlong handle);
+
+JNIEXPORT jint JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_statisticalOutlierRemovalIndexed(
+    JNIEnv *env, jobject thiz, jlong handle, jint k_neighbors, jfloat std_ratio);
+
+JNIEXPORT jint JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_radiusOutlierRemovalIndexed(
+    JNIEnv *env, jobject thiz, jlong handle, jfloat radius, jint min_neighbors);
+
+JNIEXPORT jint JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_estimateNormalsIndexed(
+    JNIEnv *env, jobject thiz, jlong handle, jint k_neighbors,
+    jfloatArray camera_origins, jboolean keep_existing);
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_poissonReconstructionIndexed(
+    JNIEnv *env, jobject thiz, jlong handle, jint depth);
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_marchingCubesReconstructionIndexed(
+    JNIEnv *env, jobject thiz, jlong handle, jfloat voxel_size);
+
+// Streaming voxel map: persistent accumulator for scan frames
+JNIEXPORT jlong JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_createVoxelMap(
+    JNIEnv *env, jobject thiz, jfloat voxel_size, jint max_voxels);
+
+JNIEXPORT void JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_releaseVoxelMap(
+    JNIEnv *env, jobject thiz, jlong handle);
+
+JNIEXPORT jint JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelMapAddPoints(
+    JNIEnv *env, jobject thiz, jlong handle,
+    jfloatArray points_flat, jfloatArray confidence, jint frame_id,
+    jfloatArray normals);
+
+JNIEXPORT jint JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelMapSize(
+    JNIEnv *env, jobject thiz, jlong handle);
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelMapGetPoints(
+    JNIEnv *env, jobject thiz, jlong handle);
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelMapGetConfidence(
+    JNIEnv *env, jobject thiz, jlong handle);
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelMapGetNormals(
+    JNIEnv *env, jobject thiz, jlong handle);
+
+JNIEXPORT jintArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelMapGetFrameIds(
+    JNIEnv *env, jobject thiz, jlong handle);
+
+JNIEXPORT void JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_voxelMapClear(
+    JNIEnv *env, jobject thiz, jlong handle);
+
+// Sparse TSDF volume (fused from depth frames, marching cubes on the blocks)
+JNIEXPORT jlong JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_createTSDFVolume(
+    JNIEnv *env, jobject thiz, jfloat voxel_size, jfloat truncation, jint memory_budget_mb,
+    jstring spill_path, jfloat min_depth, jfloat max_depth, jint min_confidence);
+
+JNIEXPORT void JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_releaseTSDFVolume(
+    JNIEnv *env, jobject thiz, jlong handle);
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_tsdfVolumeExtractMesh(
+    JNIEnv *env, jobject thiz, jlong handle);
+
+// Depth frame worker (ring buffer + native integration thread)
+JNIEXPORT jlong JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_createDepthFrameWorker(
+    JNIEnv *env, jobject thiz, jlong map_handle, jlong tsdf_handle, jint capacity,
+    jint max_pixels, jint window_radius, jfloat max_depth_change,
+    jfloat min_depth, jfloat max_depth, jint min_confidence, jboolean refine_pose);
+
+JNIEXPORT void JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_releaseDepthFrameWorker(
+    JNIEnv *env, jobject thiz, jlong handle);
+
+JNIEXPORT jboolean JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_depthFrameWorkerSubmit(
+    JNIEnv *env, jobject thiz, jlong handle,
+    jobject depth_buffer, jint depth_row_stride,
+    jobject confidence_buffer, jint confidence_row_stride,
+    jint width, jint height, jfloat fx, jfloat fy, jfloat cx, jfloat cy,
+    jfloatArray pose, jint stride, jint frame_id);
+
+JNIEXPORT jlongArray JNICALL
+Java_com_scanforge3d_processing_NativeMeshProcessor_depthFrameWorkerStats(
+    JNIEnv *env, jobject thiz, jlong handle);
 
 // Normal estimation
 JNIEXPORT jfloatArray JNICALL
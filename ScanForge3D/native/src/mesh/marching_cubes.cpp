@@ -1,6 +1,7 @@
 #include "marching_cubes.h"
 #include "../util/kdtree.h"
 #include <android/log.h>
+#include <algorithm>
 #include <cmath>
 #include <unordered_map>
 
@@ -307,14 +308,11 @@ const int MarchingCubes::TRI_TABLE[256][16] = {
 
 std::vector<float> MarchingCubes::computeSDF(
     const PointCloud& cloud, const std::vector<Vec3f>& normals,
+    const KDTree& tree,
     const Vec3f& grid_origin, int nx, int ny, int nz) const {
 
     std::vector<float> sdf(nx * ny * nz, 1.0f); // default: outside
 
-    // Build KD-tree for nearest neighbor queries
-    KDTree tree;
-    tree.build(cloud);
-
     for (int iz = 0; iz < nz; iz++) {
         for (int iy = 0; iy < ny; iy++) {
             for (int ix = 0; ix < nx; ix++) {
@@ -362,6 +360,21 @@ Vec3f MarchingCubes::interpolateEdge(const Vec3f& p1, const Vec3f& p2,
 TriangleMesh MarchingCubes::reconstruct(
     const PointCloud& cloud, const std::vector<Vec3f>& normals) const {
 
+    // Build KD-tree for nearest neighbor queries
+    KDTree tree;
+    tree.build(cloud);
+    return reconstruct(cloud, normals, tree);
+}
+
+TriangleMesh MarchingCubes::reconstruct(const NeighborhoodIndex& index) const {
+    if (index.normals().size() != index.size()) return TriangleMesh();
+    return reconstruct(index.cloud(), index.normals(), index.tree());
+}
+
+TriangleMesh MarchingCubes::reconstruct(
+    const PointCloud& cloud, const std::vector<Vec3f>& normals,
+    const KDTree& tree) const {
+
     TriangleMesh mesh;
     if (cloud.empty()) return mesh;
 
@@ -382,31 +395,46 @@ TriangleMesh MarchingCubes::reconstruct(
     int ny = static_cast<int>((max_bound.y - min_bound.y) / voxel_size_) + 2 * padding_ + 1;
     int nz = static_cast<int>((max_bound.z - min_bound.z) / voxel_size_) + 2 * padding_ + 1;
 
-    // Limit grid size for mobile
-    int max_dim = 200;
+    // Limit grid size for mobile: coarsen the voxels rather than cut
+    // off the part of the cloud beyond max_dim
+    const int max_dim = 200;
     if (nx > max_dim || ny > max_dim || nz > max_dim) {
-        float scale = static_cast<float>(max_dim) /
-            static_cast<float>(std::max({nx, ny, nz}));
-        // Recalculate with larger voxel size - but keep the member as const
-        // Just limit dimensions
-        nx = std::min(nx, max_dim);
-        ny = std::min(ny, max_dim);
-        nz = std::min(nz, max_dim);
+        float scale = static_cast<float>(std::max({nx, ny, nz})) / static_cast<float>(max_dim);
+        LOGI("Grid exceeds %d cells per axis, voxel size %.4f -> %.4f",
+             max_dim, voxel_size_, voxel_size_ * scale * 1.01f);
+        return MarchingCubes(voxel_size_ * scale * 1.01f, padding_).reconstruct(cloud, normals, tree);
     }
 
     LOGI("Grid: %d x %d x %d = %d cells", nx, ny, nz, nx * ny * nz);
 
     // Compute signed distance field
-    auto sdf = computeSDF(cloud, normals, grid_origin, nx, ny, nz);
+    auto sdf = computeSDF(cloud, normals, tree, grid_origin, nx, ny, nz);
+    mesh = extractSurface(sdf.data(), nullptr, grid_origin, nx, ny, nz);
 
-    // Vertex deduplication map
+    LOGI("Marching Cubes result: %zu vertices, %zu triangles",
+         mesh.vertexCount(), mesh.triangleCount());
+
+    return mesh;
+}
+
+TriangleMesh MarchingCubes::extractSurface(const float* sdf, const float* weights,
+                                           const Vec3f& grid_origin,
+                                           int nx, int ny, int nz) const {
+    TriangleMesh mesh;
     std::unordered_map<long long, int> vertex_map;
+    extractSurface(sdf, weights, grid_origin, nx, ny, nz, mesh, vertex_map);
+    return mesh;
+}
 
+void MarchingCubes::extractSurface(const float* sdf, const float* weights,
+                                   const Vec3f& grid_origin, int nx, int ny, int nz,
+                                   TriangleMesh& mesh,
+                                   std::unordered_map<long long, int>& vertex_map) const {
     auto getOrAddVertex = [&](const Vec3f& v) -> int {
-        // Quantize to grid for deduplication
-        long long key = (long long)(v.x * 10000.0f) * 1000000000LL +
-                        (long long)(v.y * 10000.0f) * 1000000LL +
-                        (long long)(v.z * 10000.0f);
+        // Quantize to 0.1 mm for deduplication, 21 bits per axis (+-104 m)
+        long long key = ((std::llround(v.x * 10000.0f) & 0x1FFFFFLL) << 42) |
+                        ((std::llround(v.y * 10000.0f) & 0x1FFFFFLL) << 21) |
+                        (std::llround(v.z * 10000.0f) & 0x1FFFFFLL);
         auto it = vertex_map.find(key);
         if (it != vertex_map.end()) {
             return it->second;
@@ -432,6 +460,19 @@ TriangleMesh MarchingCubes::reconstruct(
                 val[6] = sdf[(iz + 1) * ny * nx + (iy + 1) * nx + (ix + 1)];
                 val[7] = sdf[(iz + 1) * ny * nx + (iy + 1) * nx + (ix)    ];
 
+                if (weights) {
+                    if (weights[(iz)     * ny * nx + (iy)     * nx + (ix)    ] == 0.0f ||
+                        weights[(iz)     * ny * nx + (iy)     * nx + (ix + 1)] == 0.0f ||
+                        weights[(iz)     * ny * nx + (iy + 1) * nx + (ix + 1)] == 0.0f ||
+                        weights[(iz)     * ny * nx + (iy + 1) * nx + (ix)    ] == 0.0f ||
+                        weights[(iz + 1) * ny * nx + (iy)     * nx + (ix)    ] == 0.0f ||
+                        weights[(iz + 1) * ny * nx + (iy)     * nx + (ix + 1)] == 0.0f ||
+                        weights[(iz + 1) * ny * nx + (iy + 1) * nx + (ix + 1)] == 0.0f ||
+                        weights[(iz + 1) * ny * nx + (iy + 1) * nx + (ix)    ] == 0.0f) {
+                        continue;
+                    }
+                }
+
                 // Determine cube configuration index
                 int cube_index = 0;
                 if (val[0] < 0) cube_index |= 1;
@@ -489,11 +530,6 @@ TriangleMesh MarchingCubes::reconstruct(
             }
         }
     }
-
-    LOGI("Marching Cubes result: %zu vertices, %zu triangles",
-         mesh.vertexCount(), mesh.triangleCount());
-
-    return mesh;
 }
 
 } // namespace scanforge
@@ -1,5 +1,8 @@
 #pragma once
 #include "../point_cloud/point_cloud.h"
+#include "../util/kdtree.h"
+#include "../util/neighborhood_index.h"
+#include <unordered_map>
 #include <vector>
 
 namespace scanforge {
@@ -23,13 +26,36 @@ public:
     TriangleMesh reconstruct(const PointCloud& cloud,
                              const std::vector<Vec3f>& normals) const;
 
+    // Reconstruct from a shared index, reusing its KD-tree for the SDF.
+    // Uses the normals stored on the index.
+    TriangleMesh reconstruct(const NeighborhoodIndex& index) const;
+
+    // Zero level set of a signed distance grid sampled at
+    // origin + (ix, iy, iz) * voxel_size, x fastest, negative inside.
+    // With weights, cells with an unobserved corner (weight 0) are
+    // skipped, so a TSDF volume only yields observed surface.
+    TriangleMesh extractSurface(const float* sdf, const float* weights,
+                                const Vec3f& origin, int nx, int ny, int nz) const;
+
+    // Same, appending to mesh; vertex_map (quantized position -> vertex)
+    // merges the vertices shared with earlier calls, e.g. along the
+    // borders of TSDF blocks meshed one at a time
+    void extractSurface(const float* sdf, const float* weights,
+                        const Vec3f& origin, int nx, int ny, int nz,
+                        TriangleMesh& mesh, std::unordered_map<long long, int>& vertex_map) const;
+
 private:
     float voxel_size_;
     int padding_;
 
+    TriangleMesh reconstruct(const PointCloud& cloud,
+                             const std::vector<Vec3f>& normals,
+                             const KDTree& tree) const;
+
     // Compute signed distance field on a 3D grid
     std::vector<float> computeSDF(
         const PointCloud& cloud, const std::vector<Vec3f>& normals,
+        const KDTree& tree,
         const Vec3f& grid_origin, int nx, int ny, int nz) const;
 
     // Interpolate vertex position on edge between two grid vertices
@@ -9,16 +9,7 @@
 
 namespace scanforge {
 
-TriangleMesh PoissonReconstruction::reconstruct(
-    const PointCloud& cloud,
-    const std::vector<Vec3f>& normals) const {
-
-    LOGI("Surface reconstruction: %zu points, depth=%d", cloud.size(), depth_);
-
-    if (cloud.empty() || normals.empty()) {
-        return TriangleMesh();
-    }
-
+float PoissonReconstruction::computeVoxelSize(const PointCloud& cloud) const {
     // Convert octree depth to voxel size:
     // depth_ controls the resolution. Higher depth = finer voxels.
     // We compute voxel size from the bounding box diagonal and depth.
@@ -34,7 +25,7 @@ TriangleMesh PoissonReconstruction::reconstruct(
 
     if (diagonal < 1e-8f) {
         LOGI("Point cloud has zero extent, cannot reconstruct");
-        return TriangleMesh();
+        return 0.0f;
     }
 
     // Clamp depth to safe range for mobile (max grid ~200^3)
@@ -51,6 +42,21 @@ TriangleMesh PoissonReconstruction::reconstruct(
     }
 
     LOGI("Voxel size: %.6f (depth=%d, diagonal=%.4f)", voxel_size, effective_depth, diagonal);
+    return voxel_size;
+}
+
+TriangleMesh PoissonReconstruction::reconstruct(
+    const PointCloud& cloud,
+    const std::vector<Vec3f>& normals) const {
+
+    LOGI("Surface reconstruction: %zu points, depth=%d", cloud.size(), depth_);
+
+    if (cloud.empty() || normals.empty()) {
+        return TriangleMesh();
+    }
+
+    float voxel_size = computeVoxelSize(cloud);
+    if (voxel_size <= 0.0f) return TriangleMesh();
 
     // Use Marching Cubes for surface reconstruction
     // MarchingCubes computes an SDF from the oriented point cloud
@@ -65,4 +71,24 @@ TriangleMesh PoissonReconstruction::reconstruct(
     return mesh;
 }
 
+TriangleMesh PoissonReconstruction::reconstruct(const NeighborhoodIndex& index) const {
+    LOGI("Surface reconstruction (shared index): %zu points, depth=%d",
+         index.size(), depth_);
+
+    if (index.size() == 0 || index.normals().empty()) {
+        return TriangleMesh();
+    }
+
+    float voxel_size = computeVoxelSize(index.cloud());
+    if (voxel_size <= 0.0f) return TriangleMesh();
+
+    MarchingCubes mc(voxel_size, 2);
+    TriangleMesh mesh = mc.reconstruct(index);
+
+    LOGI("Reconstruction result: %zu vertices, %zu triangles",
+         mesh.vertexCount(), mesh.triangleCount());
+
+    return mesh;
+}
+
 } // namespace scanforge
@@ -1,5 +1,6 @@
 #pragma once
 #include "../point_cloud/point_cloud.h"
+#include "../util/neighborhood_index.h"
 #include <vector>
 
 namespace scanforge {
@@ -13,8 +14,14 @@ public:
     TriangleMesh reconstruct(const PointCloud& cloud,
                              const std::vector<Vec3f>& normals) const;
 
+    // Same, reusing the KD-tree and normals of a shared index
+    TriangleMesh reconstruct(const NeighborhoodIndex& index) const;
+
 private:
     int depth_; // Octree depth (8-12)
+
+    // Voxel size for the configured depth, or <= 0 if the cloud is degenerate
+    float computeVoxelSize(const PointCloud& cloud) const;
 };
 
 } // namespace scanforge
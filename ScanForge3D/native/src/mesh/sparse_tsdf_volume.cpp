@@ -0,0 +1,613 @@
+#include "sparse_tsdf_volume.h"
+#include "marching_cubes.h"
+#include "../util/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace scanforge {
+
+namespace {
+
+// Pixels sampled for block allocation; at 1 m and fx = 450 two pixels
+// are 4.4 mm apart, well below a block
+constexpr int ALLOCATION_STRIDE = 2;
+constexpr int32_t KEY_OFFSET = 1 << 20;  // block coordinates in [-2^20, 2^20)
+
+inline uint64_t hashKey(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+inline int floorDiv(float v, float size) {
+    return static_cast<int>(std::floor(v / size));
+}
+
+} // namespace
+
+SparseTSDFVolume::SparseTSDFVolume(float voxel_size, size_t memory_budget_bytes, float truncation)
+    : voxel_size_(voxel_size),
+      truncation_(truncation > 0.0f ? truncation : 4.0f * voxel_size) {
+    // Per block: the voxels, its table entry and two hash slots
+    const size_t per_block = sizeof(Block) + sizeof(BlockInfo) +
+                             2 * (sizeof(uint64_t) + sizeof(uint32_t));
+    max_blocks_ = std::max<size_t>(1, memory_budget_bytes / per_block);
+    size_t capacity = 1;
+    while (capacity < 2 * max_blocks_) capacity <<= 1;
+    keys_.assign(capacity, EMPTY_KEY);
+    values_.assign(capacity, 0);
+    hash_mask_ = capacity - 1;
+}
+
+SparseTSDFVolume::~SparseTSDFVolume() {
+    if (spill_file_) std::fclose(spill_file_);
+}
+
+void SparseTSDFVolume::setMaxWeight(int max_weight) {
+    max_weight_ = static_cast<uint32_t>(std::min(256, std::max(1, max_weight))) * 255;
+}
+
+bool SparseTSDFVolume::setSpillFile(const std::string& path) {
+    if (spill_file_) std::fclose(spill_file_);
+    spill_index_.clear();
+    spill_free_.clear();
+    spill_end_ = 0;
+    spill_path_ = path;
+    spill_file_ = path.empty() ? nullptr : std::fopen(path.c_str(), "w+b");
+    return spill_file_ != nullptr;
+}
+
+void SparseTSDFVolume::clear() {
+    chunks_.clear();
+    info_.clear();
+    free_.clear();
+    resident_ = 0;
+    std::fill(keys_.begin(), keys_.end(), EMPTY_KEY);
+    frame_ = 0;
+    for (int k = 0; k < 3; k++) {
+        bounds_min_[k] = 0;
+        bounds_max_[k] = -1;
+    }
+    dropped_ = 0;
+    if (spill_file_) setSpillFile(spill_path_);
+}
+
+uint64_t SparseTSDFVolume::packKey(int32_t x, int32_t y, int32_t z) {
+    return (static_cast<uint64_t>((x + KEY_OFFSET) & 0x1FFFFF) << 42) |
+           (static_cast<uint64_t>((y + KEY_OFFSET) & 0x1FFFFF) << 21) |
+           static_cast<uint64_t>((z + KEY_OFFSET) & 0x1FFFFF);
+}
+
+void SparseTSDFVolume::unpackKey(uint64_t key, int32_t& x, int32_t& y, int32_t& z) {
+    x = static_cast<int32_t>((key >> 42) & 0x1FFFFF) - KEY_OFFSET;
+    y = static_cast<int32_t>((key >> 21) & 0x1FFFFF) - KEY_OFFSET;
+    z = static_cast<int32_t>(key & 0x1FFFFF) - KEY_OFFSET;
+}
+
+int64_t SparseTSDFVolume::find(uint64_t key) const {
+    for (size_t i = hashKey(key) & hash_mask_;; i = (i + 1) & hash_mask_) {
+        if (keys_[i] == key) return values_[i];
+        if (keys_[i] == EMPTY_KEY) return -1;
+    }
+}
+
+void SparseTSDFVolume::insert(uint64_t key, uint32_t index) {
+    size_t i = hashKey(key) & hash_mask_;
+    while (keys_[i] != EMPTY_KEY) i = (i + 1) & hash_mask_;
+    keys_[i] = key;
+    values_[i] = index;
+}
+
+void SparseTSDFVolume::erase(uint64_t key) {
+    size_t i = hashKey(key) & hash_mask_;
+    while (keys_[i] != key) {
+        if (keys_[i] == EMPTY_KEY) return;
+        i = (i + 1) & hash_mask_;
+    }
+    // Backward-shift deletion: move later entries of the probe run into
+    // the gap unless their home slot lies cyclically in (i, j]
+    for (size_t j = (i + 1) & hash_mask_; keys_[j] != EMPTY_KEY; j = (j + 1) & hash_mask_) {
+        size_t home = hashKey(keys_[j]) & hash_mask_;
+        bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (stays) continue;
+        keys_[i] = keys_[j];
+        values_[i] = values_[j];
+        i = j;
+    }
+    keys_[i] = EMPTY_KEY;
+}
+
+int64_t SparseTSDFVolume::acquire(uint64_t key) {
+    int64_t found = find(key);
+    if (found >= 0) return found;
+
+    if (resident_ >= max_blocks_) {
+        evictOldest();
+        if (resident_ >= max_blocks_) return -1;
+    }
+
+    uint32_t index;
+    if (!free_.empty()) {
+        index = free_.back();
+        free_.pop_back();
+    } else {
+        index = static_cast<uint32_t>(info_.size());
+        if (index % CHUNK_BLOCKS == 0) chunks_.emplace_back(new Block[CHUNK_BLOCKS]);
+        info_.emplace_back();
+    }
+
+    // A spilled block comes back from its slot, which is freed either
+    // way: the block is resident again, or its data is lost
+    Block& b = block(index);
+    bool restored = false;
+    auto spilled = spill_index_.find(key);
+    if (spilled != spill_index_.end()) {
+        restored = readSpilled(key, spilled->second, b);
+        if (!restored) dropped_++;
+        spill_free_.emplace(spilled->second.capacity, spilled->second.offset);
+        spill_index_.erase(spilled);
+    }
+    if (!restored) {
+        std::fill(b.tsdf, b.tsdf + BLOCK_VOXELS, static_cast<int16_t>(32767));
+        std::fill(b.weight, b.weight + BLOCK_VOXELS, static_cast<uint16_t>(0));
+    }
+
+    BlockInfo& info = info_[index];
+    unpackKey(key, info.x, info.y, info.z);
+    const int32_t coords[3] = {info.x, info.y, info.z};
+    const bool first = bounds_max_[0] < bounds_min_[0];
+    for (int k = 0; k < 3; k++) {
+        bounds_min_[k] = first ? coords[k] : std::min(bounds_min_[k], coords[k]);
+        bounds_max_[k] = first ? coords[k] : std::max(bounds_max_[k], coords[k]);
+    }
+    info.last_seen = 0;
+    info.used = true;
+    insert(key, index);
+    resident_++;
+    return index;
+}
+
+void SparseTSDFVolume::evictOldest() {
+    std::vector<uint32_t> candidates;
+    candidates.reserve(resident_);
+    for (uint32_t i = 0; i < info_.size(); i++) {
+        if (info_[i].used && info_[i].last_seen < frame_) candidates.push_back(i);
+    }
+    if (candidates.empty()) return;
+
+    // A sixteenth of the pool at a time, so the scan above is amortized
+    size_t batch = std::min(candidates.size(), std::max<size_t>(1, max_blocks_ / 16));
+    std::nth_element(candidates.begin(), candidates.begin() + (batch - 1), candidates.end(),
+                     [this](uint32_t a, uint32_t b) {
+                         return info_[a].last_seen < info_[b].last_seen;
+                     });
+    for (size_t c = 0; c < batch; c++) {
+        uint32_t i = candidates[c];
+        spill(i);
+        BlockInfo& info = info_[i];
+        erase(packKey(info.x, info.y, info.z));
+        info.used = false;
+        free_.push_back(i);
+        resident_--;
+    }
+}
+
+void SparseTSDFVolume::spill(uint32_t index) {
+    const Block& b = block(index);
+    uint64_t mask[BLOCK_VOXELS / 64] = {};
+    size_t observed = 0;
+    for (int v = 0; v < BLOCK_VOXELS; v++) {
+        if (b.weight[v] == 0) continue;
+        mask[v / 64] |= 1ull << (v % 64);
+        observed++;
+    }
+    if (observed == 0) return;
+    if (!spill_file_) {
+        dropped_++;
+        return;
+    }
+
+    // Record: key, observed-voxel mask, then (tsdf, weight) per observed
+    // voxel, assembled so it is written (and checked) in one call
+    const BlockInfo& info = info_[index];
+    uint64_t key = packKey(info.x, info.y, info.z);
+    const size_t bytes = sizeof(key) + sizeof(mask) + observed * 2 * sizeof(int16_t);
+    spill_record_.resize(bytes);
+    uint8_t* out = spill_record_.data();
+    std::memcpy(out, &key, sizeof(key));
+    std::memcpy(out + sizeof(key), mask, sizeof(mask));
+    int16_t* values = reinterpret_cast<int16_t*>(out + sizeof(key) + sizeof(mask));
+    for (int v = 0; v < BLOCK_VOXELS; v++) {
+        if (b.weight[v] == 0) continue;
+        *values++ = b.tsdf[v];
+        *values++ = static_cast<int16_t>(b.weight[v]);
+    }
+
+    // Smallest free slot that fits, else a new one at the end
+    const uint32_t capacity = static_cast<uint32_t>(
+        (bytes + SPILL_SLOT_BYTES - 1) / SPILL_SLOT_BYTES * SPILL_SLOT_BYTES);
+    SpillSlot slot{spill_end_, capacity};
+    auto free_slot = spill_free_.lower_bound(capacity);
+    const bool reused = free_slot != spill_free_.end();
+    if (reused) {
+        slot = {free_slot->second, free_slot->first};
+        spill_free_.erase(free_slot);
+    }
+
+    // Flushed so a full disk shows up here rather than on a later seek
+    bool written = std::fseek(spill_file_, slot.offset, SEEK_SET) == 0 &&
+                   std::fwrite(spill_record_.data(), 1, bytes, spill_file_) == bytes &&
+                   std::fflush(spill_file_) == 0;
+    if (!written) {
+        std::clearerr(spill_file_);
+        if (reused) spill_free_.emplace(slot.capacity, slot.offset);
+        dropped_++;
+        return;
+    }
+    if (!reused) spill_end_ += capacity;
+    spill_index_[key] = slot;
+}
+
+bool SparseTSDFVolume::readSpilled(uint64_t key, const SpillSlot& slot, Block& out) {
+    if (!spill_file_) return false;
+
+    uint64_t stored_key = 0;
+    uint64_t mask[BLOCK_VOXELS / 64];
+    if (std::fseek(spill_file_, slot.offset, SEEK_SET) != 0 ||
+        std::fread(&stored_key, sizeof(stored_key), 1, spill_file_) != 1 || stored_key != key ||
+        std::fread(mask, sizeof(mask), 1, spill_file_) != 1) {
+        std::clearerr(spill_file_);
+        return false;
+    }
+    int16_t values[2 * BLOCK_VOXELS];
+    size_t observed = 0;
+    for (uint64_t m : mask) observed += __builtin_popcountll(m);
+    if (std::fread(values, sizeof(int16_t), 2 * observed, spill_file_) != 2 * observed) {
+        std::clearerr(spill_file_);
+        return false;
+    }
+
+    size_t k = 0;
+    for (int v = 0; v < BLOCK_VOXELS; v++) {
+        if (mask[v / 64] & (1ull << (v % 64))) {
+            out.tsdf[v] = values[2 * k];
+            out.weight[v] = static_cast<uint16_t>(values[2 * k + 1]);
+            k++;
+        } else {
+            out.tsdf[v] = 32767;
+            out.weight[v] = 0;
+        }
+    }
+    return true;
+}
+
+size_t SparseTSDFVolume::integrate(const DepthImage& image, const float* pose) {
+    if (image.width <= 0 || image.height <= 0 || !image.depth_mm) return 0;
+    frame_++;
+    visible_.clear();
+
+    static const float IDENTITY[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    const float* m = pose ? pose : IDENTITY;
+    const DepthIntrinsics& in = image.intrinsics;
+    const float lo = std::max(min_depth_, 1e-6f);
+    const float block_m = voxel_size_ * BLOCK_SIZE;
+
+    auto pixelValid = [&](int u, int v, float& depth) {
+        if (image.confidence &&
+            image.confidence[static_cast<size_t>(v) * image.confidence_row_stride + u] <
+                min_confidence_) {
+            return false;
+        }
+        depth = image.depth_mm[static_cast<size_t>(v) * image.depth_row_stride + u] * 0.001f;
+        return depth >= lo && depth <= max_depth_;
+    };
+
+    // Allocation: walk the truncation band of each sampled pixel's ray
+    // in half-block steps
+    for (int v = 0; v < image.height; v += ALLOCATION_STRIDE) {
+        for (int u = 0; u < image.width; u += ALLOCATION_STRIDE) {
+            float depth;
+            if (!pixelValid(u, v, depth)) continue;
+            Vec3f c((u - in.cx) / in.fx, (v - in.cy) / in.fy, -1.0f);
+            Vec3f dir(m[0] * c.x + m[4] * c.y + m[8] * c.z,
+                      m[1] * c.x + m[5] * c.y + m[9] * c.z,
+                      m[2] * c.x + m[6] * c.y + m[10] * c.z);
+            const float ds = 0.5f * block_m / dir.length();
+            const float s_end = depth + truncation_;
+            uint64_t last_key = EMPTY_KEY;
+            for (float s = std::max(lo, depth - truncation_); s <= s_end + 0.5f * ds; s += ds) {
+                float sc = std::min(s, s_end);
+                uint64_t key = packKey(floorDiv(m[12] + dir.x * sc, block_m),
+                                       floorDiv(m[13] + dir.y * sc, block_m),
+                                       floorDiv(m[14] + dir.z * sc, block_m));
+                if (key == last_key) continue;
+                last_key = key;
+                int64_t index = acquire(key);
+                if (index < 0) continue;
+                BlockInfo& info = info_[index];
+                if (info.last_seen != frame_) {
+                    info.last_seen = frame_;
+                    visible_.push_back(static_cast<uint32_t>(index));
+                }
+            }
+        }
+    }
+
+    // Update the voxels of the visible blocks
+    const Vec3f t(m[12], m[13], m[14]);
+    const Vec3f rx(m[0], m[1], m[2]), ry(m[4], m[5], m[6]), rz(m[8], m[9], m[10]);
+    const Vec3f step(rx.x * voxel_size_, ry.x * voxel_size_, rz.x * voxel_size_);
+    const float inv_trunc = 1.0f / truncation_;
+    std::vector<size_t> updated(parallelThreadCount(visible_.size(), 8), 0);
+
+    parallelFor(0, visible_.size(), [&](size_t begin, size_t end, int chunk) {
+        size_t local = 0;
+        for (size_t k = begin; k < end; k++) {
+            const BlockInfo& info = info_[visible_[k]];
+            Block& b = block(visible_[k]);
+            for (int lz = 0; lz < BLOCK_SIZE; lz++) {
+                for (int ly = 0; ly < BLOCK_SIZE; ly++) {
+                    Vec3f w(info.x * block_m, (info.y * BLOCK_SIZE + ly) * voxel_size_,
+                            (info.z * BLOCK_SIZE + lz) * voxel_size_);
+                    Vec3f d = w - t;
+                    Vec3f c(rx.dot(d), ry.dot(d), rz.dot(d));
+                    int row = (lz * BLOCK_SIZE + ly) * BLOCK_SIZE;
+                    for (int lx = 0; lx < BLOCK_SIZE; lx++, c = c + step) {
+                        float z = -c.z;
+                        if (z < lo) continue;
+                        float inv_z = 1.0f / z;
+                        int u = static_cast<int>(std::lround(in.fx * c.x * inv_z + in.cx));
+                        int v = static_cast<int>(std::lround(in.fy * c.y * inv_z + in.cy));
+                        if (u < 0 || u >= image.width || v < 0 || v >= image.height) continue;
+                        float depth;
+                        if (!pixelValid(u, v, depth)) continue;
+
+                        float sdf = depth - z;
+                        if (sdf < -truncation_) continue;  // occluded
+                        float value = std::min(1.0f, sdf * inv_trunc);
+                        uint32_t weight = image.confidence
+                            ? image.confidence[static_cast<size_t>(v) * image.confidence_row_stride + u]
+                            : 255;
+                        if (weight == 0) continue;
+
+                        int i = row + lx;
+                        uint32_t w_old = b.weight[i];
+                        float old = b.tsdf[i] * (1.0f / 32767.0f);
+                        float fused = (old * w_old + value * weight) / static_cast<float>(w_old + weight);
+                        b.tsdf[i] = static_cast<int16_t>(std::lround(fused * 32767.0f));
+                        b.weight[i] = static_cast<uint16_t>(std::min(w_old + weight, max_weight_));
+                        local++;
+                    }
+                }
+            }
+        }
+        updated[chunk] = local;
+    }, 8);
+
+    size_t total = 0;
+    for (size_t n : updated) total += n;
+    return total;
+}
+
+TriangleMesh SparseTSDFVolume::extractMesh() {
+    std::vector<uint64_t> keys;
+    keys.reserve(resident_ + spill_index_.size());
+    for (uint64_t key : keys_) {
+        if (key != EMPTY_KEY) keys.push_back(key);
+    }
+    for (const auto& entry : spill_index_) keys.push_back(entry.first);
+
+    // Each block is meshed on a 9^3 grid: its own voxels plus the first
+    // layer of its +x / +y / +z neighbors, so the cells between blocks
+    // are covered exactly once
+    constexpr int G = BLOCK_SIZE + 1;
+    std::vector<float> sdf(G * G * G), weight(G * G * G);
+    std::unique_ptr<Block[]> spilled(new Block[8]);
+    MarchingCubes mc(voxel_size_, 0);
+    TriangleMesh mesh;
+    std::unordered_map<long long, int> vertex_map;
+
+    for (uint64_t key : keys) {
+        int32_t bx, by, bz;
+        unpackKey(key, bx, by, bz);
+        const Block* neighbors[8];
+        for (int n = 0; n < 8; n++) {
+            uint64_t nkey = packKey(bx + (n & 1), by + ((n >> 1) & 1), bz + ((n >> 2) & 1));
+            int64_t index = find(nkey);
+            auto slot = index >= 0 ? spill_index_.end() : spill_index_.find(nkey);
+            if (index >= 0) neighbors[n] = &block(static_cast<uint32_t>(index));
+            else if (slot != spill_index_.end() && readSpilled(nkey, slot->second, spilled[n]))
+                neighbors[n] = &spilled[n];
+            else neighbors[n] = nullptr;
+        }
+        for (int z = 0; z < G; z++) {
+            for (int y = 0; y < G; y++) {
+                for (int x = 0; x < G; x++) {
+                    int n = (x / BLOCK_SIZE) | ((y / BLOCK_SIZE) << 1) | ((z / BLOCK_SIZE) << 2);
+                    int g = (z * G + y) * G + x;
+                    const Block* b = neighbors[n];
+                    if (!b) {
+                        sdf[g] = 1.0f;
+                        weight[g] = 0.0f;
+                        continue;
+                    }
+                    int v = ((z % BLOCK_SIZE) * BLOCK_SIZE + (y % BLOCK_SIZE)) * BLOCK_SIZE +
+                            x % BLOCK_SIZE;
+                    sdf[g] = b->tsdf[v] * (1.0f / 32767.0f);
+                    weight[g] = b->weight[v];
+                }
+            }
+        }
+        Vec3f origin(bx * BLOCK_SIZE * voxel_size_, by * BLOCK_SIZE * voxel_size_,
+                     bz * BLOCK_SIZE * voxel_size_);
+        mc.extractSurface(sdf.data(), weight.data(), origin, G, G, G, mesh, vertex_map);
+    }
+    return mesh;
+}
+
+bool SparseTSDFVolume::sample(const Vec3f& p, float& value) const {
+    const float gx = p.x / voxel_size_, gy = p.y / voxel_size_, gz = p.z / voxel_size_;
+    const int x0 = static_cast<int>(std::floor(gx));
+    const int y0 = static_cast<int>(std::floor(gy));
+    const int z0 = static_cast<int>(std::floor(gz));
+    const float fx = gx - x0, fy = gy - y0, fz = gz - z0;
+
+    float corners[8];
+    const Block* cached = nullptr;
+    int32_t cached_key[3] = {0, 0, 0};
+    for (int c = 0; c < 8; c++) {
+        const int x = x0 + (c & 1), y = y0 + ((c >> 1) & 1), z = z0 + ((c >> 2) & 1);
+        const int32_t bx = floorDiv(static_cast<float>(x), BLOCK_SIZE);
+        const int32_t by = floorDiv(static_cast<float>(y), BLOCK_SIZE);
+        const int32_t bz = floorDiv(static_cast<float>(z), BLOCK_SIZE);
+        if (!cached || bx != cached_key[0] || by != cached_key[1] || bz != cached_key[2]) {
+            cached = findBlock(bx, by, bz);
+            if (!cached) return false;
+            cached_key[0] = bx;
+            cached_key[1] = by;
+            cached_key[2] = bz;
+        }
+        const int v = ((z - bz * BLOCK_SIZE) * BLOCK_SIZE + (y - by * BLOCK_SIZE)) * BLOCK_SIZE +
+                      (x - bx * BLOCK_SIZE);
+        if (cached->weight[v] == 0) return false;
+        corners[c] = cached->tsdf[v] * (1.0f / 32767.0f);
+    }
+    const float x00 = corners[0] + (corners[1] - corners[0]) * fx;
+    const float x10 = corners[2] + (corners[3] - corners[2]) * fx;
+    const float x01 = corners[4] + (corners[5] - corners[4]) * fx;
+    const float x11 = corners[6] + (corners[7] - corners[6]) * fx;
+    const float y0v = x00 + (x10 - x00) * fy;
+    const float y1v = x01 + (x11 - x01) * fy;
+    value = y0v + (y1v - y0v) * fz;
+    return true;
+}
+
+size_t SparseTSDFVolume::raycast(const DepthIntrinsics& intrinsics, int width, int height,
+                                 const float* pose, Vec3f* points, Vec3f* normals) const {
+    if (width <= 0 || height <= 0 || bounds_max_[0] < bounds_min_[0]) return 0;
+    static const float IDENTITY[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    const float* m = pose ? pose : IDENTITY;
+    const Vec3f eye(m[12], m[13], m[14]);
+    const float block_m = voxel_size_ * BLOCK_SIZE;
+    const float near = std::max(min_depth_, 1e-3f);
+    const float far = std::min(max_depth_, MAX_RAYCAST_DEPTH);
+    const float box_min[3] = {bounds_min_[0] * block_m, bounds_min_[1] * block_m,
+                              bounds_min_[2] * block_m};
+    const float box_max[3] = {(bounds_max_[0] + 1) * block_m, (bounds_max_[1] + 1) * block_m,
+                              (bounds_max_[2] + 1) * block_m};
+    std::vector<size_t> hits(parallelThreadCount(height, 8), 0);
+
+    parallelFor(0, static_cast<size_t>(height), [&](size_t begin, size_t end, int chunk) {
+        size_t local = 0;
+        for (size_t v = begin; v < end; v++) {
+            for (int u = 0; u < width; u++) {
+                const size_t p = v * width + u;
+                points[p] = Vec3f(0, 0, 0);
+                normals[p] = Vec3f(0, 0, 0);
+
+                // Ray parameter s is the depth, the camera ray has z = -1
+                Vec3f c((u - intrinsics.cx) / intrinsics.fx, (v - intrinsics.cy) / intrinsics.fy, -1.0f);
+                Vec3f dir(m[0] * c.x + m[4] * c.y + m[8] * c.z,
+                          m[1] * c.x + m[5] * c.y + m[9] * c.z,
+                          m[2] * c.x + m[6] * c.y + m[10] * c.z);
+                const float inv_len = 1.0f / dir.length();
+
+                // Clip the ray to the allocated bounds (slab test)
+                float s = near, s_end = far;
+                const float o[3] = {eye.x, eye.y, eye.z}, d[3] = {dir.x, dir.y, dir.z};
+                for (int k = 0; k < 3; k++) {
+                    if (std::fabs(d[k]) < 1e-12f) {
+                        if (o[k] < box_min[k] || o[k] > box_max[k]) s_end = -1.0f;
+                        continue;
+                    }
+                    float ta = (box_min[k] - o[k]) / d[k], tb = (box_max[k] - o[k]) / d[k];
+                    s = std::max(s, std::min(ta, tb));
+                    s_end = std::min(s_end, std::max(ta, tb));
+                }
+
+                float prev_s = 0.0f, prev_value = 0.0f;
+                bool has_prev = false;
+                while (s <= s_end) {
+                    Vec3f w = eye + dir * s;
+                    const int vx = floorDiv(w.x, voxel_size_);
+                    const int vy = floorDiv(w.y, voxel_size_);
+                    const int vz = floorDiv(w.z, voxel_size_);
+                    const int32_t bx = vx >> BLOCK_SHIFT, by = vy >> BLOCK_SHIFT,
+                                  bz = vz >> BLOCK_SHIFT;
+                    const Block* b = findBlock(bx, by, bz);
+                    if (!b) {
+                        // Nothing observed within this block
+                        has_prev = false;
+                        s += 0.5f * block_m * inv_len;
+                        continue;
+                    }
+                    // March on the nearest voxel; trilinear only at the crossing
+                    const int i = (((vz & BLOCK_MASK) * BLOCK_SIZE) + (vy & BLOCK_MASK)) * BLOCK_SIZE +
+                                  (vx & BLOCK_MASK);
+                    if (b->weight[i] == 0) {
+                        has_prev = false;
+                        s += voxel_size_ * inv_len;
+                        continue;
+                    }
+                    const float value = b->tsdf[i] * (1.0f / 32767.0f);
+                    if (has_prev && prev_value > 0.0f && value <= 0.0f) {
+                        // Zero crossing: interpolate, normal from the gradient
+                        float v0 = prev_value, v1 = value;
+                        float t0, t1;
+                        if (sample(eye + dir * prev_s, t0) && sample(w, t1) && t0 > 0.0f && t1 <= 0.0f) {
+                            v0 = t0;
+                            v1 = t1;
+                        }
+                        float hit_s = prev_s + (s - prev_s) * v0 / (v0 - v1);
+                        Vec3f hit = eye + dir * hit_s;
+                        float gx0, gx1, gy0, gy1, gz0, gz1;
+                        const float h = voxel_size_;
+                        if (sample(hit + Vec3f(h, 0, 0), gx1) && sample(hit - Vec3f(h, 0, 0), gx0) &&
+                            sample(hit + Vec3f(0, h, 0), gy1) && sample(hit - Vec3f(0, h, 0), gy0) &&
+                            sample(hit + Vec3f(0, 0, h), gz1) && sample(hit - Vec3f(0, 0, h), gz0)) {
+                            Vec3f g(gx1 - gx0, gy1 - gy0, gz1 - gz0);
+                            float len = g.length();
+                            if (len > 1e-6f) {
+                                points[p] = hit;
+                                normals[p] = g * (1.0f / len);
+                                local++;
+                            }
+                        }
+                        break;
+                    }
+                    if (has_prev && prev_value < 0.0f && value > 0.0f) break;  // back face
+                    has_prev = true;
+                    prev_s = s;
+                    prev_value = value;
+                    // Step by the stored distance, but never past a voxel
+                    // near the surface
+                    s += std::max(voxel_size_, 0.8f * value * truncation_) * inv_len;
+                }
+            }
+        }
+        hits[chunk] = local;
+    }, 8);
+
+    size_t total = 0;
+    for (size_t n : hits) total += n;
+    return total;
+}
+
+SparseTSDFVolume::Stats SparseTSDFVolume::stats() const {
+    Stats s;
+    s.resident_blocks = resident_;
+    s.max_blocks = max_blocks_;
+    s.spilled_blocks = spill_index_.size();
+    s.dropped_blocks = dropped_;
+    s.spill_file_bytes = static_cast<size_t>(spill_end_);
+    s.memory_bytes = chunks_.size() * CHUNK_BLOCKS * sizeof(Block) +
+                     info_.capacity() * sizeof(BlockInfo) +
+                     keys_.size() * (sizeof(uint64_t) + sizeof(uint32_t));
+    return s;
+}
+
+} // namespace scanforge
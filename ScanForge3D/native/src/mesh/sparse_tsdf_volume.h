@@ -0,0 +1,188 @@
+#pragma once
+#include "../point_cloud/depth_image.h"
+#include "../point_cloud/point_cloud.h"
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace scanforge {
+
+/**
+ * Truncated signed distance field stored as 8x8x8 voxel blocks that are
+ * allocated only where surfaces are observed, within a fixed memory
+ * budget.
+ *
+ * Blocks live in a pool that grows in chunks up to the budget and are
+ * found through an open-addressing hash table (linear probing, sized
+ * once for the budget, so it never rehashes). A voxel is 4 bytes:
+ * 16-bit normalized distance and a 16-bit weight that sums the 8-bit
+ * pixel confidences, capped at max_weight * 255.
+ *
+ * Per frame, the blocks within the truncation band around each
+ * measured depth are looked up or allocated, then only those blocks
+ * are updated (in parallel), with the same projective update as
+ * TSDFVolume. When the pool is full, the blocks observed least
+ * recently are evicted. With a spill file they are written to it
+ * compressed (only observed voxels), read back if the camera sees them
+ * again and included in extractMesh(); without one they are dropped.
+ * Records sit in slots rounded up to SPILL_SLOT_BYTES; a slot freed by
+ * reading its block back is reused by a later record that fits, so the
+ * file stays near the size of the blocks spilled at once instead of
+ * growing with every eviction. Blocks whose record cannot be written
+ * or read back (e.g. the disk is full) count as dropped.
+ */
+class SparseTSDFVolume {
+public:
+    static constexpr int BLOCK_SIZE = 8;
+    // Voxel to block index by shift and mask (floors negatives too)
+    static constexpr int BLOCK_SHIFT = 3;
+    static constexpr int BLOCK_MASK = BLOCK_SIZE - 1;
+    static_assert(BLOCK_SIZE == 1 << BLOCK_SHIFT, "BLOCK_SIZE must be 2^BLOCK_SHIFT");
+    static constexpr int BLOCK_VOXELS = BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE;
+
+    struct Stats {
+        size_t resident_blocks = 0;
+        size_t max_blocks = 0;
+        size_t spilled_blocks = 0;    // in the spill file
+        size_t dropped_blocks = 0;    // evicted without a spill file, or lost to a failed
+                                      // spill write or read
+        size_t spill_file_bytes = 0;  // live and free slots
+        size_t memory_bytes = 0;      // pool, block table and hash table
+    };
+
+    // truncation <= 0 uses 4 voxels
+    SparseTSDFVolume(float voxel_size, size_t memory_budget_bytes, float truncation = 0.0f);
+    ~SparseTSDFVolume();
+
+    SparseTSDFVolume(const SparseTSDFVolume&) = delete;
+    SparseTSDFVolume& operator=(const SparseTSDFVolume&) = delete;
+
+    // Depth outside [min_m, max_m] is ignored
+    void setDepthRange(float min_m, float max_m) {
+        min_depth_ = min_m;
+        max_depth_ = max_m;
+    }
+    // Pixels with lower confidence are ignored
+    void setMinConfidence(uint8_t min_confidence) { min_confidence_ = min_confidence; }
+    // Weight cap in full-confidence observations (at most 256)
+    void setMaxWeight(int max_weight);
+    // Evicted blocks go to this file (created or truncated); false if
+    // it cannot be opened
+    bool setSpillFile(const std::string& path);
+
+    /**
+     * Fuses one frame. pose: column-major 4x4 camera-to-world matrix
+     * (Pose.toMatrix), or null for camera space. Returns the number of
+     * voxels updated.
+     */
+    size_t integrate(const DepthImage& image, const float* pose);
+
+    // Marching cubes over all observed blocks, resident and spilled
+    TriangleMesh extractMesh();
+
+    /**
+     * Renders the resident part of the surface into a virtual camera:
+     * each pixel's ray is marched through the field (skipping absent
+     * blocks, stepping by the stored distance elsewhere) up to the
+     * first zero crossing from free space, refined by trilinear
+     * interpolation. Writes width * height world-space points and unit
+     * normals (the field gradient, facing free space), row-major;
+     * (0, 0, 0) normals mark pixels without a surface. pose as for
+     * integrate(). Returns the number of surface pixels.
+     */
+    size_t raycast(const DepthIntrinsics& intrinsics, int width, int height, const float* pose,
+                   Vec3f* points, Vec3f* normals) const;
+
+    void clear();
+
+    float voxelSize() const { return voxel_size_; }
+    float truncation() const { return truncation_; }
+    Stats stats() const;
+
+private:
+    struct Block {
+        int16_t tsdf[BLOCK_VOXELS];     // distance / truncation * 32767
+        uint16_t weight[BLOCK_VOXELS];  // summed confidence, 0 = unobserved
+    };
+    struct BlockInfo {
+        int32_t x = 0, y = 0, z = 0;   // block coordinates
+        uint32_t last_seen = 0;         // frame counter of the last observation
+        bool used = false;
+    };
+
+    static constexpr size_t CHUNK_BLOCKS = 256;
+    static constexpr uint64_t EMPTY_KEY = ~0ull;
+    // Rays stop here when no depth range is set
+    static constexpr float MAX_RAYCAST_DEPTH = 8.0f;
+    // Spill slot granularity; a full record (all voxels observed) is
+    // 2120 bytes, so there are nine slot sizes
+    static constexpr uint32_t SPILL_SLOT_BYTES = 256;
+
+    struct SpillSlot {
+        long offset;
+        uint32_t capacity;
+    };
+
+    static uint64_t packKey(int32_t x, int32_t y, int32_t z);
+    static void unpackKey(uint64_t key, int32_t& x, int32_t& y, int32_t& z);
+
+    Block& block(uint32_t i) { return chunks_[i / CHUNK_BLOCKS][i % CHUNK_BLOCKS]; }
+    const Block& block(uint32_t i) const { return chunks_[i / CHUNK_BLOCKS][i % CHUNK_BLOCKS]; }
+    const Block* findBlock(int32_t x, int32_t y, int32_t z) const {
+        int64_t i = find(packKey(x, y, z));
+        return i >= 0 ? &block(static_cast<uint32_t>(i)) : nullptr;
+    }
+    // Trilinear distance (normalized) at a world point; false if any of
+    // the eight voxels is unobserved
+    bool sample(const Vec3f& p, float& value) const;
+
+    // Hash table
+    int64_t find(uint64_t key) const;
+    void insert(uint64_t key, uint32_t index);
+    void erase(uint64_t key);
+
+    // Resident block for key, allocated (or read back from the spill
+    // file) if needed; -1 if the pool is full of blocks seen this frame
+    int64_t acquire(uint64_t key);
+    void evictOldest();
+    void spill(uint32_t index);
+    bool readSpilled(uint64_t key, const SpillSlot& slot, Block& out);
+
+    float voxel_size_;
+    float truncation_;
+    float min_depth_ = 0.0f;
+    float max_depth_ = 1e30f;
+    uint8_t min_confidence_ = 0;
+    uint32_t max_weight_ = 64 * 255;
+
+    size_t max_blocks_;
+    std::vector<std::unique_ptr<Block[]>> chunks_;
+    std::vector<BlockInfo> info_;
+    std::vector<uint32_t> free_;
+    size_t resident_ = 0;
+
+    std::vector<uint64_t> keys_;
+    std::vector<uint32_t> values_;
+    size_t hash_mask_;
+
+    uint32_t frame_ = 0;
+    std::vector<uint32_t> visible_;
+    // Bounds of all blocks ever allocated (inclusive, in blocks), so
+    // rays can be clipped to them
+    int32_t bounds_min_[3] = {0, 0, 0};
+    int32_t bounds_max_[3] = {-1, -1, -1};
+
+    std::string spill_path_;
+    std::FILE* spill_file_ = nullptr;
+    std::unordered_map<uint64_t, SpillSlot> spill_index_;
+    std::multimap<uint32_t, long> spill_free_;  // capacity -> offset of free slots
+    long spill_end_ = 0;                        // end of the last slot
+    std::vector<uint8_t> spill_record_;         // record being written
+    size_t dropped_ = 0;
+};
+
+} // namespace scanforge
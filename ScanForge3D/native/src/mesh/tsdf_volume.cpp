@@ -0,0 +1,133 @@
+#include "tsdf_volume.h"
+#include "marching_cubes.h"
+#include "../util/parallel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace scanforge {
+
+TSDFVolume::TSDFVolume(const Vec3f& origin, float voxel_size, int nx, int ny, int nz,
+                       float truncation)
+    : origin_(origin), voxel_size_(voxel_size),
+      nx_(std::max(nx, 1)), ny_(std::max(ny, 1)), nz_(std::max(nz, 1)),
+      truncation_(truncation > 0.0f ? truncation : 4.0f * voxel_size) {
+    size_t n = static_cast<size_t>(nx_) * ny_ * nz_;
+    tsdf_.assign(n, 1.0f);
+    weight_.assign(n, 0.0f);
+}
+
+void TSDFVolume::clear() {
+    std::fill(tsdf_.begin(), tsdf_.end(), 1.0f);
+    std::fill(weight_.begin(), weight_.end(), 0.0f);
+}
+
+size_t TSDFVolume::integrate(const DepthImage& image, const float* pose) {
+    if (image.width <= 0 || image.height <= 0 || !image.depth_mm) return 0;
+
+    static const float IDENTITY[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    const float* m = pose ? pose : IDENTITY;
+    const Vec3f t(m[12], m[13], m[14]);
+    // Rows of R^T (world to camera) are the columns of R
+    const Vec3f rx(m[0], m[1], m[2]), ry(m[4], m[5], m[6]), rz(m[8], m[9], m[10]);
+
+    const DepthIntrinsics& in = image.intrinsics;
+    const float lo = std::max(min_depth_, 1e-6f);
+    // Farthest valid depth of this frame, so the frustum box below is
+    // no deeper than needed
+    uint16_t max_mm = 0;
+    for (int v = 0; v < image.height; v++) {
+        const uint16_t* row = image.depth_mm + static_cast<size_t>(v) * image.depth_row_stride;
+        for (int u = 0; u < image.width; u++) max_mm = std::max(max_mm, row[u]);
+    }
+    const float far = std::min(max_depth_, max_mm * 0.001f) + truncation_;
+    if (max_mm == 0) return 0;
+
+    // Bounding box of the frustum up to the far plane, in voxels
+    Vec3f box_min = t, box_max = t;
+    const float us[2] = {0.0f, static_cast<float>(image.width - 1)};
+    const float vs[2] = {0.0f, static_cast<float>(image.height - 1)};
+    for (float u : us) {
+        for (float v : vs) {
+            Vec3f c((u - in.cx) / in.fx * far, (v - in.cy) / in.fy * far, -far);
+            Vec3f w(m[0] * c.x + m[4] * c.y + m[8] * c.z + t.x,
+                    m[1] * c.x + m[5] * c.y + m[9] * c.z + t.y,
+                    m[2] * c.x + m[6] * c.y + m[10] * c.z + t.z);
+            box_min = Vec3f(std::min(box_min.x, w.x), std::min(box_min.y, w.y),
+                            std::min(box_min.z, w.z));
+            box_max = Vec3f(std::max(box_max.x, w.x), std::max(box_max.y, w.y),
+                            std::max(box_max.z, w.z));
+        }
+    }
+    auto toIndex = [&](float p, float o, int n, bool upper) {
+        float f = (p - o) / voxel_size_;
+        int i = static_cast<int>(upper ? std::ceil(f) + 1 : std::floor(f));
+        return std::min(std::max(i, 0), n);
+    };
+    const int x0 = toIndex(box_min.x, origin_.x, nx_, false), x1 = toIndex(box_max.x, origin_.x, nx_, true);
+    const int y0 = toIndex(box_min.y, origin_.y, ny_, false), y1 = toIndex(box_max.y, origin_.y, ny_, true);
+    const int z0 = toIndex(box_min.z, origin_.z, nz_, false), z1 = toIndex(box_max.z, origin_.z, nz_, true);
+    if (x0 >= x1 || y0 >= y1 || z0 >= z1) return 0;
+
+    const float inv_trunc = 1.0f / truncation_;
+    // Camera-space step per voxel along x
+    const Vec3f step(rx.x * voxel_size_, ry.x * voxel_size_, rz.x * voxel_size_);
+    std::vector<size_t> updated(parallelThreadCount(z1 - z0, 1), 0);
+
+    parallelFor(static_cast<size_t>(z0), static_cast<size_t>(z1),
+                [&](size_t begin, size_t end, int chunk) {
+        size_t local = 0;
+        for (size_t iz = begin; iz < end; iz++) {
+            for (int iy = y0; iy < y1; iy++) {
+                Vec3f w(origin_.x + x0 * voxel_size_, origin_.y + iy * voxel_size_,
+                        origin_.z + iz * voxel_size_);
+                Vec3f d = w - t;
+                // Camera-space position of voxel (x0, iy, iz)
+                Vec3f c(rx.dot(d), ry.dot(d), rz.dot(d));
+                size_t row = (iz * ny_ + iy) * nx_;
+                for (int ix = x0; ix < x1; ix++, c = c + step) {
+                    float z = -c.z;
+                    if (z < lo) continue;
+                    float inv_z = 1.0f / z;
+                    int u = static_cast<int>(std::lround(in.fx * c.x * inv_z + in.cx));
+                    int v = static_cast<int>(std::lround(in.fy * c.y * inv_z + in.cy));
+                    if (u < 0 || u >= image.width || v < 0 || v >= image.height) continue;
+                    if (image.confidence &&
+                        image.confidence[static_cast<size_t>(v) * image.confidence_row_stride + u] <
+                            min_confidence_) {
+                        continue;
+                    }
+                    float depth = image.depth_mm[static_cast<size_t>(v) * image.depth_row_stride + u] *
+                                  0.001f;
+                    if (depth < lo || depth > max_depth_) continue;
+
+                    float sdf = depth - z;
+                    if (sdf < -truncation_) continue;  // occluded
+                    float value = std::min(1.0f, sdf * inv_trunc);
+                    float weight = image.confidence
+                        ? image.confidence[static_cast<size_t>(v) * image.confidence_row_stride + u] *
+                              (1.0f / 255.0f)
+                        : 1.0f;
+                    if (weight <= 0.0f) continue;
+
+                    size_t i = row + ix;
+                    float w_old = weight_[i];
+                    tsdf_[i] = (tsdf_[i] * w_old + value * weight) / (w_old + weight);
+                    weight_[i] = std::min(w_old + weight, max_weight_);
+                    local++;
+                }
+            }
+        }
+        updated[chunk] = local;
+    }, 1);
+
+    size_t total = 0;
+    for (size_t n : updated) total += n;
+    return total;
+}
+
+TriangleMesh TSDFVolume::extractMesh() const {
+    MarchingCubes mc(voxel_size_, 0);
+    return mc.extractSurface(tsdf_.data(), weight_.data(), origin_, nx_, ny_, nz_);
+}
+
+} // namespace scanforge
@@ -0,0 +1,83 @@
+#pragma once
+#include "../point_cloud/depth_image.h"
+#include "../point_cloud/point_cloud.h"
+#include <cstdint>
+#include <vector>
+
+namespace scanforge {
+
+/**
+ * Truncated signed distance field over a dense voxel volume, fused
+ * directly from depth frames.
+ *
+ * Each voxel center is projected into the frame with the camera pose;
+ * the difference between the measured depth at that pixel and the
+ * voxel's depth, divided by the truncation distance and clamped to
+ * [-1, 1], is averaged into the voxel with the pixel confidence as
+ * weight (capped at max_weight so the field keeps adapting). Voxels
+ * more than the truncation distance behind the surface are left alone.
+ * Positive is free space, matching MarchingCubes. Only the voxels
+ * inside the camera frustum's bounding box are visited; z slices are
+ * processed in parallel.
+ *
+ * Averaging over frames smooths depth noise, and the surface is
+ * extracted by marching cubes straight on the volume, so no outlier
+ * removal, normal estimation or nearest-neighbor SDF is needed after
+ * the scan.
+ */
+class TSDFVolume {
+public:
+    /**
+     * origin: position of voxel (0, 0, 0); nx * ny * nz voxels of edge
+     * voxel_size. truncation <= 0 uses 4 voxels.
+     */
+    TSDFVolume(const Vec3f& origin, float voxel_size, int nx, int ny, int nz,
+               float truncation = 0.0f);
+
+    // Depth outside [min_m, max_m] is ignored
+    void setDepthRange(float min_m, float max_m) {
+        min_depth_ = min_m;
+        max_depth_ = max_m;
+    }
+    // Pixels with lower confidence are ignored
+    void setMinConfidence(uint8_t min_confidence) { min_confidence_ = min_confidence; }
+    void setMaxWeight(float max_weight) { max_weight_ = max_weight; }
+
+    /**
+     * Fuses one frame. pose: column-major 4x4 camera-to-world matrix
+     * (Pose.toMatrix), or null for camera space. Returns the number of
+     * voxels updated.
+     */
+    size_t integrate(const DepthImage& image, const float* pose);
+
+    // Marching cubes over the observed part of the volume
+    TriangleMesh extractMesh() const;
+
+    void clear();
+
+    float voxelSize() const { return voxel_size_; }
+    float truncation() const { return truncation_; }
+    const Vec3f& origin() const { return origin_; }
+    int nx() const { return nx_; }
+    int ny() const { return ny_; }
+    int nz() const { return nz_; }
+    // Normalized distance and weight per voxel, x fastest
+    const std::vector<float>& tsdf() const { return tsdf_; }
+    const std::vector<float>& weights() const { return weight_; }
+    size_t memoryBytes() const { return (tsdf_.size() + weight_.size()) * sizeof(float); }
+
+private:
+    Vec3f origin_;
+    float voxel_size_;
+    int nx_, ny_, nz_;
+    float truncation_;
+    float min_depth_ = 0.0f;
+    float max_depth_ = 1e30f;
+    uint8_t min_confidence_ = 0;
+    float max_weight_ = 64.0f;
+
+    std::vector<float> tsdf_;
+    std::vector<float> weight_;
+};
+
+} // namespace scanforge
@@ -0,0 +1,29 @@
+#include "depth_frame_integrator.h"
+
+namespace scanforge {
+
+size_t DepthFrameIntegrator::integrate(const DepthImage& image, const float* pose, int stride,
+                                       int32_t frame_id, VoxelMap& map) {
+    size_t n = unprojection_.unproject(image, pose, stride);
+    if (n == 0) return 0;
+
+    size_t cells = static_cast<size_t>((image.width + stride - 1) / stride) *
+                   static_cast<size_t>((image.height + stride - 1) / stride);
+    if (grid_normals_.size() < cells) grid_normals_.resize(cells);
+    if (point_normals_.size() < n * 3) point_normals_.resize(n * 3);
+    normal_estimation_.estimate(image, pose, stride, grid_normals_.data());
+
+    const uint32_t* cell = unprojection_.cells();
+    for (size_t i = 0; i < n; i++) {
+        const Vec3f& normal = grid_normals_[cell[i]];
+        point_normals_[i * 3] = normal.x;
+        point_normals_[i * 3 + 1] = normal.y;
+        point_normals_[i * 3 + 2] = normal.z;
+    }
+
+    map.addPoints(unprojection_.points(), unprojection_.confidence(), n, frame_id,
+                  point_normals_.data());
+    return n;
+}
+
+} // namespace scanforge
@@ -0,0 +1,48 @@
+#pragma once
+#include "depth_image.h"
+#include "depth_normal_estimation.h"
+#include "depth_unprojection.h"
+#include "voxel_map.h"
+#include <vector>
+
+namespace scanforge {
+
+/**
+ * One depth frame into a VoxelMap, entirely native: DepthUnprojection
+ * for the points, DepthNormalEstimation for their normals (looked up
+ * by stride grid cell) and VoxelMap::addPoints with per-point
+ * confidence and the frame id. All scratch buffers are reused across
+ * frames, so a scan allocates nothing per frame once the sizes settle.
+ */
+class DepthFrameIntegrator {
+public:
+    explicit DepthFrameIntegrator(int normal_window_radius = 2,
+                                  float max_depth_change = 0.05f)
+        : normal_estimation_(normal_window_radius, max_depth_change) {}
+
+    // Depth range and confidence threshold for points and normals alike
+    void setDepthRange(float min_m, float max_m) {
+        unprojection_.setDepthRange(min_m, max_m);
+        normal_estimation_.setDepthRange(min_m, max_m);
+    }
+    void setMinConfidence(uint8_t min_confidence) {
+        unprojection_.setMinConfidence(min_confidence);
+        normal_estimation_.setMinConfidence(min_confidence);
+    }
+
+    /**
+     * Unprojects the frame on a stride grid, estimates normals and
+     * merges the points into map. pose: column-major camera-to-world
+     * matrix. Returns the number of points merged.
+     */
+    size_t integrate(const DepthImage& image, const float* pose, int stride,
+                     int32_t frame_id, VoxelMap& map);
+
+private:
+    DepthUnprojection unprojection_;
+    DepthNormalEstimation normal_estimation_;
+    std::vector<Vec3f> grid_normals_;
+    std::vector<float> point_normals_;
+};
+
+} // namespace scanforge
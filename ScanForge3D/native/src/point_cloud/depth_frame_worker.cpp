@@ -0,0 +1,172 @@
+#include "depth_frame_worker.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace scanforge {
+
+namespace {
+
+// The producer notifies without taking the mutex, so a wakeup can be
+// missed between the worker's empty check and its wait; the timeout
+// bounds the resulting delay
+constexpr auto WAKE_TIMEOUT = std::chrono::milliseconds(2);
+
+} // namespace
+
+DepthFrameWorker::DepthFrameWorker(VoxelMap& map, size_t capacity, size_t max_pixels,
+                                   int normal_window_radius, float max_depth_change)
+    : map_(map), integrator_(normal_window_radius, max_depth_change), ring_(capacity) {
+    for (size_t i = 0; i < ring_.capacity(); i++) {
+        ring_.slot(i).depth.resize(max_pixels);
+        ring_.slot(i).confidence.resize(max_pixels);
+    }
+}
+
+DepthFrameWorker::~DepthFrameWorker() {
+    stop();
+}
+
+void DepthFrameWorker::start() {
+    if (thread_.joinable()) return;
+    stopping_.store(false);
+    thread_ = std::thread(&DepthFrameWorker::run, this);
+}
+
+void DepthFrameWorker::stop() {
+    if (!thread_.joinable()) return;
+    stopping_.store(true);
+    wake_.notify_one();
+    thread_.join();
+}
+
+bool DepthFrameWorker::submit(const DepthImage& image, const float* pose, int stride,
+                              int32_t frame_id) {
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    // Rows must not overlap (this also rules out negative strides)
+    if (image.width <= 0 || image.height <= 0 || stride < 1 || !image.depth_mm ||
+        image.depth_row_stride < image.width ||
+        (image.confidence && image.confidence_row_stride < image.width)) {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    Slot* slot = ring_.beginWrite();
+    if (!slot) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Rows are packed; the slot only grows for a larger frame than it
+    // was allocated for
+    const size_t width = image.width, height = image.height;
+    if (slot->depth.size() < width * height) slot->depth.resize(width * height);
+    for (size_t v = 0; v < height; v++) {
+        std::memcpy(&slot->depth[v * width], image.depth_mm + v * image.depth_row_stride,
+                    width * sizeof(uint16_t));
+    }
+    slot->has_confidence = image.confidence != nullptr;
+    if (slot->has_confidence) {
+        if (slot->confidence.size() < width * height) slot->confidence.resize(width * height);
+        for (size_t v = 0; v < height; v++) {
+            std::memcpy(&slot->confidence[v * width],
+                        image.confidence + v * image.confidence_row_stride, width);
+        }
+    }
+    slot->has_pose = pose != nullptr;
+    if (pose) std::memcpy(slot->pose, pose, sizeof(slot->pose));
+    slot->width = image.width;
+    slot->height = image.height;
+    slot->intrinsics = image.intrinsics;
+    slot->stride = stride;
+    slot->frame_id = frame_id;
+
+    ring_.commitWrite();
+    wake_.notify_one();
+    return true;
+}
+
+void DepthFrameWorker::run() {
+    for (;;) {
+        Slot* slot = ring_.beginRead();
+        if (slot) {
+            DepthImage image;
+            image.depth_mm = slot->depth.data();
+            image.depth_row_stride = slot->width;
+            if (slot->has_confidence) {
+                image.confidence = slot->confidence.data();
+                image.confidence_row_stride = slot->width;
+            }
+            image.width = slot->width;
+            image.height = slot->height;
+            image.intrinsics = slot->intrinsics;
+            const float* pose = slot->has_pose ? slot->pose : nullptr;
+            Mat4f tracked;
+            if (pose && tsdf_ && refine_pose_) {
+                tracked = multiply4x4(correction_.data(), pose);
+                if (integrated_.load(std::memory_order_relaxed) >= MIN_MODEL_FRAMES &&
+                    refinePose(image, tracked)) {
+                    correction_ = multiply4x4(tracked.data(), rigidInverse4x4(pose).data());
+                    refined_.fetch_add(1, std::memory_order_relaxed);
+                }
+                pose = tracked.data();
+            }
+            integrator_.integrate(image, pose, slot->stride, slot->frame_id, map_);
+            if (tsdf_) tsdf_->integrate(image, pose);
+            ring_.commitRead();
+            map_size_.store(map_.size(), std::memory_order_relaxed);
+            integrated_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        // Empty: queued frames are finished before stopping
+        if (stopping_.load()) break;
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait_for(lock, WAKE_TIMEOUT,
+                       [this] { return stopping_.load() || ring_.size() > 0; });
+    }
+}
+
+bool DepthFrameWorker::refinePose(const DepthImage& image, Mat4f& pose) {
+    // Model and frame at the same reduced resolution: pixel u of the
+    // model is frame pixel u * stride
+    const int stride = (image.width + REFINE_MAX_WIDTH - 1) / REFINE_MAX_WIDTH;
+    const float scale = 1.0f / stride;
+    const DepthIntrinsics& in = image.intrinsics;
+    const DepthIntrinsics model{in.fx * scale, in.fy * scale, in.cx * scale, in.cy * scale};
+    const int width = (image.width + stride - 1) / stride;
+    const int height = (image.height + stride - 1) / stride;
+    if (icp_.renderModel(*tsdf_, model, width, height, pose.data()) == 0) return false;
+
+    ICPResult result = icp_.align(image, pose.data(), stride);
+    if (result.iterations == 0) return false;
+
+    // Change to the predicted pose: result * pose^-1 (column-major)
+    Mat4f delta = multiply4x4(result.transformation.data(), rigidInverse4x4(pose.data()).data());
+    float translation = std::sqrt(delta[12] * delta[12] + delta[13] * delta[13] +
+                                  delta[14] * delta[14]);
+    // cos of the rotation angle, from the trace
+    float cos_angle = (delta[0] + delta[5] + delta[10] - 1.0f) * 0.5f;
+    const float min_cos_angle = std::cos(MAX_REFINE_ROTATION_DEG * 0.017453292f);
+    if (result.fitness < MIN_REFINE_FITNESS || result.rmse > MAX_REFINE_RMSE ||
+        translation > MAX_REFINE_TRANSLATION || cos_angle < min_cos_angle) {
+        refine_rejected_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    pose = result.transformation;
+    return true;
+}
+
+DepthFrameWorkerStats DepthFrameWorker::stats() const {
+    DepthFrameWorkerStats s;
+    s.queued = ring_.size();
+    s.capacity = ring_.capacity();
+    s.submitted = submitted_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.rejected = rejected_.load(std::memory_order_relaxed);
+    s.integrated = integrated_.load(std::memory_order_relaxed);
+    s.refined = refined_.load(std::memory_order_relaxed);
+    s.refine_rejected = refine_rejected_.load(std::memory_order_relaxed);
+    s.map_size = map_size_.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace scanforge
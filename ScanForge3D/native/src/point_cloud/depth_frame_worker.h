@@ -0,0 +1,147 @@
+#pragma once
+#include "depth_frame_integrator.h"
+#include "depth_image.h"
+#include "projective_icp.h"
+#include "voxel_map.h"
+#include "../mesh/sparse_tsdf_volume.h"
+#include "../util/math_utils.h"
+#include "../util/spsc_ring.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace scanforge {
+
+struct DepthFrameWorkerStats {
+    size_t queued = 0;         // frames waiting in the ring
+    size_t capacity = 0;       // ring slots
+    uint64_t submitted = 0;    // submit() calls
+    uint64_t dropped = 0;      // submitted frames rejected because the ring was full
+    uint64_t rejected = 0;     // submitted frames without depth or with an invalid size / stride
+    uint64_t integrated = 0;   // frames merged into the map
+    uint64_t refined = 0;      // integrated frames whose pose ICP corrected
+    uint64_t refine_rejected = 0;  // ICP results discarded by the fitness / rmse / motion gate
+    size_t map_size = 0;       // voxels after the last integrated frame
+
+    double dropRate() const {
+        return submitted > 0 ? static_cast<double>(dropped) / submitted : 0.0;
+    }
+};
+
+/**
+ * Moves depth integration off the thread that receives camera frames.
+ *
+ * submit() copies the depth and confidence planes into a free slot of
+ * a lock-free SPSC ring and returns at once; a dedicated thread drains
+ * the ring and runs DepthFrameIntegrator into the map. Slots are
+ * allocated up front for max_pixels, so a submit costs one memcpy per
+ * plane. When the worker falls behind the ring fills up and new frames
+ * are dropped (and counted) instead of blocking the producer.
+ *
+ * With a TSDF volume set, every frame is fused into it as well. With
+ * pose refinement on, each frame is first tracked against the volume
+ * (raycast at the predicted pose, projective point-to-plane ICP at up
+ * to 160 columns), and the correction is kept and applied to later
+ * ARCore poses, so drift does not smear the surface. A result is only
+ * used if enough points matched, their rmse is small and it moves the
+ * predicted pose by no more than drift could have (a few cm / degrees);
+ * anything else is a false match and is counted, not applied.
+ *
+ * The worker is the only writer of the map and the volume while it
+ * runs; read them only after stop(). Options must be set before
+ * start().
+ */
+class DepthFrameWorker {
+public:
+    DepthFrameWorker(VoxelMap& map, size_t capacity = 4, size_t max_pixels = 640 * 480,
+                     int normal_window_radius = 2, float max_depth_change = 0.05f);
+    ~DepthFrameWorker();
+
+    DepthFrameWorker(const DepthFrameWorker&) = delete;
+    DepthFrameWorker& operator=(const DepthFrameWorker&) = delete;
+
+    void setDepthRange(float min_m, float max_m) {
+        integrator_.setDepthRange(min_m, max_m);
+        icp_.setDepthRange(min_m, max_m);
+    }
+    void setMinConfidence(uint8_t min_confidence) {
+        integrator_.setMinConfidence(min_confidence);
+        icp_.setMinConfidence(min_confidence);
+    }
+    // Optional, not owned
+    void setTSDFVolume(SparseTSDFVolume* volume) { tsdf_ = volume; }
+    // Track frames against the TSDF volume (needs one); off by default
+    void setPoseRefinement(bool enabled) { refine_pose_ = enabled; }
+
+    void start();
+    // Integrates the frames still queued, then joins the thread
+    void stop();
+
+    /**
+     * Producer side, one thread only. Queues a copy of the frame (pose:
+     * column-major camera-to-world matrix or null, stride and frame_id
+     * as for DepthFrameIntegrator::integrate). Returns false if the
+     * frame was dropped because the ring is full, or rejected because it
+     * has no depth, an invalid size or sampling stride, or a row stride
+     * below its width. Never blocks.
+     */
+    bool submit(const DepthImage& image, const float* pose, int stride, int32_t frame_id);
+
+    DepthFrameWorkerStats stats() const;
+
+private:
+    struct Slot {
+        std::vector<uint16_t> depth;
+        std::vector<uint8_t> confidence;
+        bool has_confidence = false;
+        bool has_pose = false;
+        int width = 0, height = 0;
+        DepthIntrinsics intrinsics;
+        float pose[16];
+        int stride = 1;
+        int32_t frame_id = -1;
+    };
+
+    void run();
+    // ICP of the frame against the volume rendered at pose; updates
+    // pose and returns true if the match passed the gate below
+    bool refinePose(const DepthImage& image, Mat4f& pose);
+
+    // Frames fused before tracking starts, so the model has a surface
+    static constexpr uint64_t MIN_MODEL_FRAMES = 10;
+    static constexpr int REFINE_MAX_WIDTH = 160;
+    // Fraction of frame points that must find a model point
+    static constexpr float MIN_REFINE_FITNESS = 0.3f;
+    // Residual of the matched points, metres
+    static constexpr float MAX_REFINE_RMSE = 0.01f;
+    // Largest change to the predicted pose, metres / degrees
+    static constexpr float MAX_REFINE_TRANSLATION = 0.05f;
+    static constexpr float MAX_REFINE_ROTATION_DEG = 5.0f;
+
+    VoxelMap& map_;
+    SparseTSDFVolume* tsdf_ = nullptr;
+    DepthFrameIntegrator integrator_;
+    SpscRing<Slot> ring_;
+
+    bool refine_pose_ = false;
+    ProjectiveICP icp_;
+    Mat4f correction_ = identity4x4();  // refined pose * ARCore pose^-1
+
+    std::thread thread_;
+    std::atomic<bool> stopping_{false};
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> integrated_{0};
+    std::atomic<uint64_t> refined_{0};
+    std::atomic<uint64_t> refine_rejected_{0};
+    std::atomic<size_t> map_size_{0};
+};
+
+} // namespace scanforge
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+
+namespace scanforge {
+
+// Pinhole intrinsics of a depth image, in pixels
+struct DepthIntrinsics {
+    float fx, fy, cx, cy;
+};
+
+/**
+ * Non-owning view of one depth frame as ARCore delivers it: 16-bit
+ * depth in millimeters (0 = missing) and an optional 8-bit confidence
+ * image of the same size. Camera space follows DepthFrameProcessor:
+ * x = (u - cx) / fx * d, y = (v - cy) / fy * d, z = -d.
+ */
+struct DepthImage {
+    const uint16_t* depth_mm = nullptr;
+    int depth_row_stride = 0;          // in pixels
+    const uint8_t* confidence = nullptr;
+    int confidence_row_stride = 0;     // in bytes
+    int width = 0;
+    int height = 0;
+    DepthIntrinsics intrinsics{0, 0, 0, 0};
+};
+
+} // namespace scanforge
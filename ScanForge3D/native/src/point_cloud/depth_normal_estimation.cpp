@@ -0,0 +1,161 @@
+#include "depth_normal_estimation.h"
+#include "../util/parallel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace scanforge {
+
+namespace {
+
+// Box sums over [u0, u1) x [v0, v1) from an integral image with row
+// length w1 = width + 1
+template <typename T>
+inline T boxSum(const std::vector<T>& s, size_t w1, int u0, int v0, int u1, int v1) {
+    return s[v1 * w1 + u1] - s[v0 * w1 + u1] - s[v1 * w1 + u0] + s[v0 * w1 + u0];
+}
+
+} // namespace
+
+size_t DepthNormalEstimation::estimate(const DepthImage& image, const float* pose,
+                                       int stride, Vec3f* normals) {
+    const int width = image.width, height = image.height;
+    const DepthIntrinsics& intrinsics = image.intrinsics;
+    if (width <= 0 || height <= 0 || stride < 1 || !image.depth_mm) return 0;
+
+    const size_t pixels = static_cast<size_t>(width) * height;
+    xs_.resize(pixels);
+    ys_.resize(pixels);
+    zs_.resize(pixels);
+
+    // Unproject every pixel; missing ones get the point (0, 0, 0)
+    const float inv_fx = 1.0f / intrinsics.fx;
+    const float inv_fy = 1.0f / intrinsics.fy;
+    parallelFor(0, static_cast<size_t>(height), [&](size_t begin, size_t end, int) {
+        for (size_t v = begin; v < end; v++) {
+            const uint16_t* depth_row = image.depth_mm + v * image.depth_row_stride;
+            const uint8_t* conf_row = image.confidence
+                ? image.confidence + v * image.confidence_row_stride : nullptr;
+            float* xr = &xs_[v * width];
+            float* yr = &ys_[v * width];
+            float* zr = &zs_[v * width];
+            const float ray_y = (static_cast<float>(v) - intrinsics.cy) * inv_fy;
+            for (int u = 0; u < width; u++) {
+                float d = depth_row[u] * 0.001f;
+                bool valid = d > 0.0f && d >= min_depth_ && d <= max_depth_ &&
+                             (!conf_row || conf_row[u] >= min_confidence_);
+                if (!valid) d = 0.0f;
+                xr[u] = (static_cast<float>(u) - intrinsics.cx) * inv_fx * d;
+                yr[u] = ray_y * d;
+                zr[u] = -d;
+            }
+        }
+    }, 64);
+
+    // Integral images; row 0 and column 0 stay zero. Double sums, since
+    // box means are differenced at millimeter scale.
+    const size_t w1 = static_cast<size_t>(width) + 1;
+    const size_t integral_size = w1 * (static_cast<size_t>(height) + 1);
+    sum_x_.assign(integral_size, 0.0);
+    sum_y_.assign(integral_size, 0.0);
+    sum_z_.assign(integral_size, 0.0);
+    sum_n_.assign(integral_size, 0);
+    for (int v = 0; v < height; v++) {
+        double rx = 0, ry = 0, rz = 0;
+        int32_t rn = 0;
+        const size_t src = static_cast<size_t>(v) * width;
+        const size_t above = static_cast<size_t>(v) * w1 + 1;
+        const size_t row = above + w1;
+        for (int u = 0; u < width; u++) {
+            float z = zs_[src + u];
+            rx += xs_[src + u];
+            ry += ys_[src + u];
+            rz += z;
+            rn += z != 0.0f;
+            sum_x_[row + u] = sum_x_[above + u] + rx;
+            sum_y_[row + u] = sum_y_[above + u] + ry;
+            sum_z_[row + u] = sum_z_[above + u] + rz;
+            sum_n_[row + u] = sum_n_[above + u] + rn;
+        }
+    }
+
+    const int r = window_radius_;
+    const int offset = std::max(1, r);
+
+    // Mean of the valid points in the window around (cu, cv); needs at
+    // least half the window (inside the image) to be valid
+    auto boxMean = [&](int cu, int cv, Vec3f& mean) {
+        if (cu < 0 || cu >= width || cv < 0 || cv >= height) return false;
+        int u0 = std::max(0, cu - r), u1 = std::min(width, cu + r + 1);
+        int v0 = std::max(0, cv - r), v1 = std::min(height, cv + r + 1);
+        int32_t n = boxSum(sum_n_, w1, u0, v0, u1, v1);
+        if (n == 0 || 2 * n < (u1 - u0) * (v1 - v0)) return false;
+        double inv = 1.0 / n;
+        mean = Vec3f(static_cast<float>(boxSum(sum_x_, w1, u0, v0, u1, v1) * inv),
+                     static_cast<float>(boxSum(sum_y_, w1, u0, v0, u1, v1) * inv),
+                     static_cast<float>(boxSum(sum_z_, w1, u0, v0, u1, v1) * inv));
+        return true;
+    };
+
+    // Tangent through the center from the boxes at -offset / +offset
+    // along (du, dv), skipping boxes across a depth edge
+    auto tangent = [&](int u, int v, int du, int dv, const Vec3f& center,
+                       float max_change, Vec3f& t) {
+        Vec3f lo, hi;
+        bool has_lo = boxMean(u - du, v - dv, lo) && std::fabs(lo.z - center.z) <= max_change;
+        bool has_hi = boxMean(u + du, v + dv, hi) && std::fabs(hi.z - center.z) <= max_change;
+        if (has_lo && has_hi) t = hi - lo;
+        else if (has_hi) t = hi - center;
+        else if (has_lo) t = center - lo;
+        else return false;
+        return true;
+    };
+
+    const int columns = (width + stride - 1) / stride;
+    const int rows = (height + stride - 1) / stride;
+    std::vector<size_t> found(parallelThreadCount(rows, 8), 0);
+
+    parallelFor(0, static_cast<size_t>(rows), [&](size_t begin, size_t end, int chunk) {
+        size_t local_found = 0;
+        for (size_t row = begin; row < end; row++) {
+            int v = static_cast<int>(row) * stride;
+            for (int col = 0; col < columns; col++) {
+                int u = col * stride;
+                Vec3f& out = normals[row * columns + col];
+                out = Vec3f(0, 0, 0);
+
+                size_t p = static_cast<size_t>(v) * width + u;
+                if (zs_[p] == 0.0f) continue;
+                Vec3f center(xs_[p], ys_[p], zs_[p]);
+                float max_change = max_depth_change_ * -center.z;
+
+                Vec3f tu, tv;
+                if (!tangent(u, v, offset, 0, center, max_change, tu) ||
+                    !tangent(u, v, 0, offset, center, max_change, tv)) {
+                    continue;
+                }
+                Vec3f n = tu.cross(tv);
+                float len2 = n.dot(n);
+                if (!(len2 > 1e-20f)) continue;
+                n = n * (1.0f / std::sqrt(len2));
+
+                // The camera is at the origin: face it
+                if (n.dot(center) > 0) n = n * (-1.0f);
+
+                if (pose) {
+                    n = Vec3f(pose[0] * n.x + pose[4] * n.y + pose[8] * n.z,
+                              pose[1] * n.x + pose[5] * n.y + pose[9] * n.z,
+                              pose[2] * n.x + pose[6] * n.y + pose[10] * n.z);
+                }
+                out = n;
+                local_found++;
+            }
+        }
+        found[chunk] = local_found;
+    }, 8);
+
+    size_t total = 0;
+    for (size_t f : found) total += f;
+    return total;
+}
+
+} // namespace scanforge
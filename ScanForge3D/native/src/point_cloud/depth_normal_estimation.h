@@ -0,0 +1,65 @@
+#pragma once
+#include "depth_image.h"
+#include "point_cloud.h"
+#include <cstdint>
+#include <vector>
+
+namespace scanforge {
+
+/**
+ * Normal estimation on an organized depth image, without any spatial
+ * index: the pixel grid already is the neighborhood structure.
+ *
+ * Every valid pixel is unprojected (see DepthImage) and integral
+ * images of the points are built once per frame. The normal of a pixel
+ * is the cross product of the horizontal and vertical tangents, each
+ * the difference of two box means window_radius pixels to either side
+ * (the averaged 3D gradient), so smoothing costs the same for any
+ * window size and a frame is O(pixels).
+ *
+ * Depth edges: a box whose mean depth differs from the center pixel by
+ * more than max_depth_change * depth is not used; with one side left
+ * the tangent is one-sided, with none the pixel gets no normal.
+ *
+ * Normals face the camera and are optionally rotated into world space
+ * by the camera pose. Scratch buffers are kept between frames.
+ */
+class DepthNormalEstimation {
+public:
+    explicit DepthNormalEstimation(int window_radius = 2, float max_depth_change = 0.05f)
+        : window_radius_(window_radius), max_depth_change_(max_depth_change) {}
+
+    // Depth outside [min_m, max_m] counts as missing
+    void setDepthRange(float min_m, float max_m) {
+        min_depth_ = min_m;
+        max_depth_ = max_m;
+    }
+    // Pixels with lower confidence count as missing
+    void setMinConfidence(uint8_t min_confidence) { min_confidence_ = min_confidence; }
+
+    /**
+     * pose (optional): column-major 4x4 camera-to-world matrix whose
+     * rotation is applied to the normals.
+     *
+     * Normals are written for the pixels (u, v) with u and v multiples
+     * of stride, row-major: normals[(v / stride) * columns + u / stride]
+     * with columns = ceil(width / stride). Pixels without a normal get
+     * (0, 0, 0). Returns the number of normals found.
+     */
+    size_t estimate(const DepthImage& image, const float* pose, int stride, Vec3f* normals);
+
+private:
+    int window_radius_;
+    float max_depth_change_;
+    float min_depth_ = 0.0f;
+    float max_depth_ = 1e30f;
+    uint8_t min_confidence_ = 0;
+
+    // Camera-space points (z = 0 marks a missing pixel) and integral
+    // images of x, y, z and the valid count, (width + 1) x (height + 1)
+    std::vector<float> xs_, ys_, zs_;
+    std::vector<double> sum_x_, sum_y_, sum_z_;
+    std::vector<int32_t> sum_n_;
+};
+
+} // namespace scanforge
@@ -0,0 +1,117 @@
+#include "depth_unprojection.h"
+#include "../util/simd_distance.h"
+#include <algorithm>
+
+namespace scanforge {
+
+size_t DepthUnprojection::unproject(const DepthImage& image, const float* pose, int stride) {
+    size_ = 0;
+    if (image.width <= 0 || image.height <= 0 || stride < 1 || !image.depth_mm) return 0;
+
+    const int columns = (image.width + stride - 1) / stride;
+    const int rows = (image.height + stride - 1) / stride;
+    const size_t max_points = static_cast<size_t>(columns) * rows;
+    if (xyz_.size() < max_points * 3) {
+        xyz_.resize(max_points * 3);
+        confidence_.resize(max_points);
+        cells_.resize(max_points);
+    }
+    if (ray_x_.size() < static_cast<size_t>(columns)) {
+        ray_x_.resize(columns);
+        row_depth_.resize(columns);
+        row_confidence_.resize(columns);
+        row_x_.resize(columns);
+        row_y_.resize(columns);
+        row_z_.resize(columns);
+        row_mask_.resize(columns);
+    }
+
+    const DepthIntrinsics& in = image.intrinsics;
+    const float inv_fx = 1.0f / in.fx;
+    const float inv_fy = 1.0f / in.fy;
+    for (int j = 0; j < columns; j++) {
+        ray_x_[j] = (static_cast<float>(j * stride) - in.cx) * inv_fx;
+    }
+
+    static const float IDENTITY[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    const float* m = pose ? pose : IDENTITY;
+    // Depth 0 marks a missing pixel, so the lower bound is never 0
+    const float lo = std::max(min_depth_, 1e-6f);
+    const float hi = max_depth_;
+    const float min_conf = static_cast<float>(min_confidence_);
+
+    for (int row = 0; row < rows; row++) {
+        const int v = row * stride;
+        const uint16_t* depth_row = image.depth_mm + static_cast<size_t>(v) * image.depth_row_stride;
+        const uint8_t* conf_row = image.confidence
+            ? image.confidence + static_cast<size_t>(v) * image.confidence_row_stride : nullptr;
+
+        // Gather the sampled pixels of this row
+        for (int j = 0; j < columns; j++) {
+            row_depth_[j] = static_cast<float>(depth_row[j * stride]) * 0.001f;
+            row_confidence_[j] = conf_row ? static_cast<float>(conf_row[j * stride]) : 255.0f;
+        }
+
+        const float ray_y = (static_cast<float>(v) - in.cy) * inv_fy;
+        // Camera point (rx d, ry d, -d); world = R p + t, so the terms
+        // that only depend on the row are folded per row
+        const float ax = m[4] * ray_y - m[8], ay = m[5] * ray_y - m[9], az = m[6] * ray_y - m[10];
+
+        int j = 0;
+#if defined(SCANFORGE_SIMD_NEON)
+        float32x4_t v_lo = vdupq_n_f32(lo), v_hi = vdupq_n_f32(hi), v_conf = vdupq_n_f32(min_conf);
+        float32x4_t m0 = vdupq_n_f32(m[0]), m1 = vdupq_n_f32(m[1]), m2 = vdupq_n_f32(m[2]);
+        float32x4_t vax = vdupq_n_f32(ax), vay = vdupq_n_f32(ay), vaz = vdupq_n_f32(az);
+        float32x4_t tx = vdupq_n_f32(m[12]), ty = vdupq_n_f32(m[13]), tz = vdupq_n_f32(m[14]);
+        for (; j + 4 <= columns; j += 4) {
+            float32x4_t d = vld1q_f32(&row_depth_[j]);
+            float32x4_t rd = vmulq_f32(vld1q_f32(&ray_x_[j]), d);
+            uint32x4_t valid = vandq_u32(vandq_u32(vcgeq_f32(d, v_lo), vcleq_f32(d, v_hi)),
+                                         vcgeq_f32(vld1q_f32(&row_confidence_[j]), v_conf));
+            vst1q_f32(&row_x_[j], vaddq_f32(vmlaq_f32(vmulq_f32(m0, rd), vax, d), tx));
+            vst1q_f32(&row_y_[j], vaddq_f32(vmlaq_f32(vmulq_f32(m1, rd), vay, d), ty));
+            vst1q_f32(&row_z_[j], vaddq_f32(vmlaq_f32(vmulq_f32(m2, rd), vaz, d), tz));
+            vst1q_u32(&row_mask_[j], valid);
+        }
+#elif defined(SCANFORGE_SIMD_AVX) || defined(SCANFORGE_SIMD_SSE)
+        __m128 v_lo = _mm_set1_ps(lo), v_hi = _mm_set1_ps(hi), v_conf = _mm_set1_ps(min_conf);
+        __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+        __m128 vax = _mm_set1_ps(ax), vay = _mm_set1_ps(ay), vaz = _mm_set1_ps(az);
+        __m128 tx = _mm_set1_ps(m[12]), ty = _mm_set1_ps(m[13]), tz = _mm_set1_ps(m[14]);
+        for (; j + 4 <= columns; j += 4) {
+            __m128 d = _mm_loadu_ps(&row_depth_[j]);
+            __m128 rd = _mm_mul_ps(_mm_loadu_ps(&ray_x_[j]), d);
+            __m128 valid = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(d, v_lo), _mm_cmple_ps(d, v_hi)),
+                                      _mm_cmpge_ps(_mm_loadu_ps(&row_confidence_[j]), v_conf));
+            _mm_storeu_ps(&row_x_[j], _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, rd), _mm_mul_ps(vax, d)), tx));
+            _mm_storeu_ps(&row_y_[j], _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, rd), _mm_mul_ps(vay, d)), ty));
+            _mm_storeu_ps(&row_z_[j], _mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, rd), _mm_mul_ps(vaz, d)), tz));
+            _mm_storeu_ps(reinterpret_cast<float*>(&row_mask_[j]), valid);
+        }
+#endif
+        for (; j < columns; j++) {
+            float d = row_depth_[j];
+            float rd = ray_x_[j] * d;
+            bool valid = d >= lo && d <= hi && row_confidence_[j] >= min_conf;
+            row_x_[j] = m[0] * rd + ax * d + m[12];
+            row_y_[j] = m[1] * rd + ay * d + m[13];
+            row_z_[j] = m[2] * rd + az * d + m[14];
+            row_mask_[j] = valid ? ~0u : 0u;
+        }
+
+        // Compact the valid lanes into the output
+        const uint32_t row_cell = static_cast<uint32_t>(row) * columns;
+        for (int c = 0; c < columns; c++) {
+            if (!row_mask_[c]) continue;
+            xyz_[size_ * 3] = row_x_[c];
+            xyz_[size_ * 3 + 1] = row_y_[c];
+            xyz_[size_ * 3 + 2] = row_z_[c];
+            confidence_[size_] = row_confidence_[c] * (1.0f / 255.0f);
+            cells_[size_] = row_cell + c;
+            size_++;
+        }
+    }
+    return size_;
+}
+
+} // namespace scanforge
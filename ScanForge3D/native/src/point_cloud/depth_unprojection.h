@@ -0,0 +1,66 @@
+#pragma once
+#include "depth_image.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace scanforge {
+
+/**
+ * Depth frame to world-space points, straight from the sensor buffers.
+ *
+ * Pixels on a stride grid are filtered by confidence and depth range,
+ * unprojected and transformed by the camera pose four at a time (NEON
+ * on ARM, SSE on x86, scalar tail), then the valid ones are compacted
+ * into output buffers owned by this object. The buffers only grow, so
+ * after the first frame of a given size unprojection allocates nothing.
+ */
+class DepthUnprojection {
+public:
+    DepthUnprojection() = default;
+
+    // Depth outside [min_m, max_m] is dropped
+    void setDepthRange(float min_m, float max_m) {
+        min_depth_ = min_m;
+        max_depth_ = max_m;
+    }
+    // Pixels with lower confidence are dropped (ignored without a
+    // confidence image)
+    void setMinConfidence(uint8_t min_confidence) { min_confidence_ = min_confidence; }
+
+    /**
+     * Unprojects the pixels (u, v) with u and v multiples of stride.
+     * pose: column-major 4x4 camera-to-world matrix (Pose.toMatrix), or
+     * null for camera space. Returns the number of points kept; the
+     * previous frame's output is overwritten.
+     */
+    size_t unproject(const DepthImage& image, const float* pose, int stride);
+
+    size_t size() const { return size_; }
+    // Interleaved xyz, 3 * size() floats
+    const float* points() const { return xyz_.data(); }
+    // Confidence / 255 per point (1 without a confidence image)
+    const float* confidence() const { return confidence_.data(); }
+    // Stride grid cell of each point, (v / stride) * columns + u / stride
+    // as used by DepthNormalEstimation
+    const uint32_t* cells() const { return cells_.data(); }
+
+private:
+    float min_depth_ = 0.0f;
+    float max_depth_ = 1e30f;
+    uint8_t min_confidence_ = 0;
+    size_t size_ = 0;
+
+    std::vector<float> xyz_;
+    std::vector<float> confidence_;
+    std::vector<uint32_t> cells_;
+
+    // Per-row scratch: camera ray x per sampled column, sampled depth
+    // and confidence, transformed points and the validity mask
+    std::vector<float> ray_x_;
+    std::vector<float> row_depth_, row_confidence_;
+    std::vector<float> row_x_, row_y_, row_z_;
+    std::vector<uint32_t> row_mask_;
+};
+
+} // namespace scanforge
@@ -1,4 +1,9 @@
 #include "icp_registration.h"
+#include "voxel_grid_filter.h"
+#include "../util/morton_order.h"
+#include "../util/parallel.h"
+#include "../util/simd_transform.h"
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <android/log.h>
@@ -8,19 +13,46 @@
 
 namespace scanforge {
 
-std::vector<std::pair<int, float>> ICPRegistration::findCorrespondences(
-    const PointCloud& source, const KDTree& target_tree,
-    const PointCloud& target) const {
+namespace {
+
+// Sums per-thread partials of fn(begin, end, partial) over [0, n). The
+// partials are reset to init first; partial must hold at least
+// parallelThreadCount(n, min_chunk) entries.
+template <typename T, typename Fn, typename Merge>
+T parallelReduce(std::vector<T>& partial, const T& init, size_t n, size_t min_chunk,
+                 Fn&& fn, Merge&& merge) {
+    const int chunks = parallelThreadCount(n, min_chunk);
+    for (int c = 0; c < chunks; c++) partial[c] = init;
+    parallelFor(0, n, [&](size_t begin, size_t end, int chunk) {
+        fn(begin, end, partial[chunk]);
+    }, min_chunk);
+    T total = init;
+    for (int c = 0; c < chunks; c++) merge(total, partial[c]);
+    return total;
+}
 
-    std::vector<std::pair<int, float>> correspondences(source.size());
+} // namespace
 
-    for (size_t i = 0; i < source.size(); i++) {
-        int nearest = target_tree.findNearest(source.getPoint(i));
-        float dist = source.getPoint(i).distanceTo(target.getPoint(nearest));
-        correspondences[i] = {nearest, dist};
-    }
+void ICPRegistration::findCorrespondences(
+    PointCloud& source, const float* move_R, const Vec3f& move_t,
+    const KDTree& target_tree, const PointCloud& target, float epsilon,
+    Correspondences& correspondences) const {
+
+    correspondences.resize(source.size());
 
-    return correspondences;
+    parallelFor(0, source.size(), [&](size_t begin, size_t end, int) {
+        if (move_R) {
+            transformPointsInPlace(source.xs() + begin, source.ys() + begin, source.zs() + begin,
+                                   end - begin, move_R, move_t.x, move_t.y, move_t.z);
+        }
+        for (size_t i = begin; i < end; i++) {
+            Vec3f p = source.getPoint(i);
+            int nearest = epsilon > 0
+                ? target_tree.findNearestApprox(p, epsilon, max_leaf_visits_)
+                : target_tree.findNearest(p);
+            correspondences[i] = {nearest, p.distanceTo(target.getPoint(nearest))};
+        }
+    }, SEARCH_MIN_CHUNK);
 }
 
 void ICPRegistration::svd3x3(const float H[9], float U[9], float S[3], float V[9]) const {
@@ -40,8 +72,12 @@ void ICPRegistration::svd3x3(const float H[9], float U[9], float S[3], float V[9
     for (int i = 0; i < 9; i++) V[i] = 0;
     V[0] = V[4] = V[8] = 1.0f;
 
-    // Jacobi eigenvalue iterations on ATA -> V, eigenvalues
+    // Jacobi eigenvalue iterations on ATA -> V, eigenvalues; stop once
+    // the off-diagonal is negligible (a few sweeps for 3x3)
     for (int sweep = 0; sweep < 30; sweep++) {
+        float off = std::abs(ATA[1]) + std::abs(ATA[2]) + std::abs(ATA[5]);
+        float diag = std::abs(ATA[0]) + std::abs(ATA[4]) + std::abs(ATA[8]);
+        if (off <= 1e-7f * diag) break;
         for (int p = 0; p < 3; p++) {
             for (int q = p + 1; q < 3; q++) {
                 float app = ATA[p * 3 + p];
@@ -127,30 +163,55 @@ void ICPRegistration::svd3x3(const float H[9], float U[9], float S[3], float V[9
 
 void ICPRegistration::computeOptimalTransform(
     const PointCloud& source, const PointCloud& target,
-    const std::vector<std::pair<int, float>>& correspondences,
-    Vec3f& translation, float rotation[9]) const {
-
-    size_t n = source.size();
-
-    // Compute centroids
-    Vec3f src_centroid(0, 0, 0);
-    Vec3f tgt_centroid(0, 0, 0);
-    for (size_t i = 0; i < n; i++) {
-        src_centroid = src_centroid + source.getPoint(i);
-        tgt_centroid = tgt_centroid + target.getPoint(correspondences[i].first);
-    }
-    float fn = static_cast<float>(n);
-    src_centroid = src_centroid / fn;
-    tgt_centroid = tgt_centroid / fn;
-
-    // Build cross-covariance matrix H = sum((src - src_centroid) * (tgt - tgt_centroid)^T)
-    float H[9] = {0};
-    for (size_t i = 0; i < n; i++) {
-        Vec3f s = source.getPoint(i) - src_centroid;
-        Vec3f t = target.getPoint(correspondences[i].first) - tgt_centroid;
-        H[0] += s.x * t.x; H[1] += s.x * t.y; H[2] += s.x * t.z;
-        H[3] += s.y * t.x; H[4] += s.y * t.y; H[5] += s.y * t.z;
-        H[6] += s.z * t.x; H[7] += s.z * t.y; H[8] += s.z * t.z;
+    const Correspondences& correspondences, float max_distance, Workspace& ws,
+    Vec3f& translation, float rotation[9], PairSums& inliers) const {
+
+    // Coordinate, cross-product and squared distance sums over the
+    // inliers, in parallel
+    PairSums sums = parallelReduce(ws.sums, PairSums{}, source.size(), REDUCE_MIN_CHUNK,
+        [&](size_t begin, size_t end, PairSums& acc) {
+            for (size_t i = begin; i < end; i++) {
+                const float d = correspondences[i].second;
+                if (d > max_distance) continue;
+                Vec3f s = source.getPoint(i);
+                Vec3f t = target.getPoint(correspondences[i].first);
+                const double sv[3] = {s.x, s.y, s.z}, tv[3] = {t.x, t.y, t.z};
+                for (int r = 0; r < 3; r++) {
+                    acc.source[r] += sv[r];
+                    acc.target[r] += tv[r];
+                    for (int c = 0; c < 3; c++) acc.cross[r * 3 + c] += sv[r] * tv[c];
+                }
+                acc.distance_sq += static_cast<double>(d) * d;
+                acc.count++;
+            }
+        },
+        [](PairSums& total, const PairSums& o) {
+            for (int k = 0; k < 3; k++) total.source[k] += o.source[k];
+            for (int k = 0; k < 3; k++) total.target[k] += o.target[k];
+            for (int k = 0; k < 9; k++) total.cross[k] += o.cross[k];
+            total.distance_sq += o.distance_sq;
+            total.count += o.count;
+        });
+    inliers.distance_sq = sums.distance_sq;
+    inliers.count = sums.count;
+
+    // Centroids
+    const double inv_n = 1.0 / static_cast<double>(std::max<size_t>(1, sums.count));
+    Vec3f src_centroid(static_cast<float>(sums.source[0] * inv_n),
+                       static_cast<float>(sums.source[1] * inv_n),
+                       static_cast<float>(sums.source[2] * inv_n));
+    Vec3f tgt_centroid(static_cast<float>(sums.target[0] * inv_n),
+                       static_cast<float>(sums.target[1] * inv_n),
+                       static_cast<float>(sums.target[2] * inv_n));
+
+    // Cross-covariance matrix H = sum((src - src_centroid) * (tgt - tgt_centroid)^T)
+    //                           = sum(src * tgt^T) - n * src_centroid * tgt_centroid^T
+    float H[9];
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            H[r * 3 + c] = static_cast<float>(sums.cross[r * 3 + c] -
+                                              sums.source[r] * sums.target[c] * inv_n);
+        }
     }
 
     // SVD: H = U * S * V^T
@@ -193,94 +254,129 @@ void ICPRegistration::computeOptimalTransform(
     translation.z = tgt_centroid.z - (rotation[6] * src_centroid.x + rotation[7] * src_centroid.y + rotation[8] * src_centroid.z);
 }
 
-Vec3f ICPRegistration::transformPoint(const Vec3f& p, const float R[9], const Vec3f& t) const {
-    return Vec3f(
-        R[0] * p.x + R[1] * p.y + R[2] * p.z + t.x,
-        R[3] * p.x + R[4] * p.y + R[5] * p.z + t.y,
-        R[6] * p.x + R[7] * p.y + R[8] * p.z + t.z
-    );
+bool ICPRegistration::computePointToPlaneTransform(
+    const PointCloud& source, const PointCloud& target,
+    const Correspondences& correspondences, float max_distance, Workspace& ws,
+    Vec3f& translation, float rotation[9], PairSums& inliers) const {
+
+    const std::vector<Vec3f>& normals = target.normals();
+    PlaneSums total = parallelReduce(ws.planes, PlaneSums{}, source.size(), REDUCE_MIN_CHUNK,
+        [&](size_t begin, size_t end, PlaneSums& acc) {
+            for (size_t i = begin; i < end; i++) {
+                const float d = correspondences[i].second;
+                if (d > max_distance) continue;
+                acc.distance_sq += static_cast<double>(d) * d;
+                acc.count++;
+                const Vec3f& normal = normals[correspondences[i].first];
+                if (normal.x == 0.0f && normal.y == 0.0f && normal.z == 0.0f) continue;
+                Vec3f p = source.getPoint(i);
+                acc.equations.addPointToPlane(
+                    p, normal, normal.dot(p - target.getPoint(correspondences[i].first)));
+            }
+        },
+        [](PlaneSums& sum, const PlaneSums& o) {
+            sum.equations.merge(o.equations);
+            sum.distance_sq += o.distance_sq;
+            sum.count += o.count;
+        });
+    inliers.distance_sq = total.distance_sq;
+    inliers.count = total.count;
+
+    double x[6];
+    if (total.equations.count < 6 || !total.equations.solve(x)) return false;
+
+    // Step = exp(x) applied to the identity
+    float R[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+    Vec3f t(0, 0, 0);
+    applyTwist(x, R, t);
+    for (int i = 0; i < 9; i++) rotation[i] = R[i];
+    translation = t;
+    return true;
 }
 
-ICPResult ICPRegistration::align(
-    const PointCloud& source, const PointCloud& target) const {
-
-    ICPResult result;
-    // Initialize as identity matrix (column-major)
-    result.transformation.fill(0);
-    result.transformation[0] = result.transformation[5] =
-        result.transformation[10] = result.transformation[15] = 1.0f;
-    result.fitness = 0;
-    result.rmse = std::numeric_limits<float>::max();
-    result.iterations = 0;
-
-    if (source.empty() || target.empty()) return result;
-
-    // Build KD-tree for target
-    KDTree target_tree;
-    target_tree.build(target);
-
-    // Working copy of source points
-    PointCloud current_source;
-    for (size_t i = 0; i < source.size(); i++) {
-        current_source.addPoint(source.getPoint(i));
-    }
-
-    // Accumulated transformation
-    float accum_R[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1}; // identity
-    Vec3f accum_t(0, 0, 0);
-
+int ICPRegistration::iterate(
+    const PointCloud& source, const PointCloud& target, const KDTree& target_tree,
+    bool point_to_plane, float accum_R[9], Vec3f& accum_t, Workspace& ws,
+    PointCloud& current_source, float& rmse) const {
+
+    const size_t n = source.size();
+
+    // Working copy of source points in Morton order, moved by the motion
+    // so far. Only sums over the points are needed, so their order is
+    // free; consecutive queries then descend to the same KD-tree leaves
+    // and stay in cache, which nearly halves the search time.
+    current_source.resize(n);
+    std::copy(source.xs(), source.xs() + n, current_source.xs());
+    std::copy(source.ys(), source.ys() + n, current_source.ys());
+    std::copy(source.zs(), source.zs() + n, current_source.zs());
+    MortonOrder::sortPoints(current_source);
+
+    // Motion the points still have to make: the accumulated one at the
+    // start, then each step. The next search applies it, so moving the
+    // points costs no pass of its own.
+    float move_R[9];
+    for (int i = 0; i < 9; i++) move_R[i] = accum_R[i];
+    Vec3f move_t = accum_t;
+    bool move_pending = true;
+
+    int iterations = 0;
     float prev_rmse = std::numeric_limits<float>::max();
+    float epsilon = initial_epsilon_ >= MIN_EPSILON ? initial_epsilon_ : 0.0f;
+    Correspondences& correspondences = ws.correspondences;
 
     for (int iter = 0; iter < max_iterations_; iter++) {
         // Find correspondences using KD-tree
-        auto correspondences = findCorrespondences(current_source, target_tree, target);
-
-        // Filter outlier correspondences (reject pairs with distance > 3 * median)
-        std::vector<float> dists;
-        dists.reserve(correspondences.size());
-        for (const auto& c : correspondences) {
-            dists.push_back(c.second);
-        }
-        std::sort(dists.begin(), dists.end());
-        float median_dist = dists[dists.size() / 2];
-        float max_corr_dist = std::max(median_dist * 3.0f, 0.01f);
-
-        // Build filtered source/target for this iteration
-        PointCloud filtered_src, filtered_tgt;
-        std::vector<std::pair<int, float>> filtered_corr;
-        for (size_t i = 0; i < current_source.size(); i++) {
-            if (correspondences[i].second <= max_corr_dist) {
-                int new_idx = static_cast<int>(filtered_src.size());
-                filtered_src.addPoint(current_source.getPoint(i));
-                filtered_corr.push_back(correspondences[i]);
-            }
+        findCorrespondences(current_source, move_pending ? move_R : nullptr, move_t,
+                            target_tree, target, epsilon, correspondences);
+        move_pending = false;
+
+        // Filter outlier correspondences (reject pairs with distance > 3 * median);
+        // the median is selected, not sorted for
+        ws.distances.resize(n);
+        for (size_t i = 0; i < n; i++) ws.distances[i] = correspondences[i].second;
+        auto median = ws.distances.begin() + n / 2;
+        std::nth_element(ws.distances.begin(), median, ws.distances.end());
+        float max_corr_dist = std::max(*median * 3.0f, 0.01f);
+
+        // Point-to-plane Gauss-Newton step, or the optimal rigid
+        // motion for point-to-point via SVD. The same pass sums the
+        // inlier RMSE; the step is dropped if that says to stop.
+        Vec3f step_t;
+        float step_R[9];
+        PairSums inliers{};
+        if (!point_to_plane ||
+            !computePointToPlaneTransform(current_source, target, correspondences,
+                                          max_corr_dist, ws, step_t, step_R, inliers)) {
+            computeOptimalTransform(current_source, target, correspondences, max_corr_dist, ws,
+                                    step_t, step_R, inliers);
         }
 
-        if (filtered_src.size() < 3) break;
-
-        // Compute RMSE
-        float rmse_sum = 0;
-        for (size_t i = 0; i < filtered_src.size(); i++) {
-            float d = filtered_corr[i].second;
-            rmse_sum += d * d;
-        }
-        float current_rmse = std::sqrt(rmse_sum / static_cast<float>(filtered_src.size()));
+        if (inliers.count < 3) break;
+        float current_rmse = static_cast<float>(
+            std::sqrt(inliers.distance_sq / static_cast<double>(inliers.count)));
 
         // Check convergence
         if (std::abs(prev_rmse - current_rmse) < tolerance_) {
-            result.rmse = current_rmse;
-            result.iterations = iter;
+            if (epsilon > 0) {
+                // Converged on approximate matches: refine with exact ones
+                epsilon = 0;
+                prev_rmse = std::numeric_limits<float>::max();
+                continue;
+            }
+            rmse = current_rmse;
+            iterations = iter;
             break;
         }
 
-        prev_rmse = current_rmse;
-        result.rmse = current_rmse;
-        result.iterations = iter + 1;
+        // Tighten the approximation as the RMSE levels off
+        if (epsilon > 0 && prev_rmse - current_rmse < EPSILON_TIGHTEN_RATE * prev_rmse) {
+            epsilon *= 0.5f;
+            if (epsilon < MIN_EPSILON) epsilon = 0;
+        }
 
-        // Compute optimal rotation + translation via SVD
-        Vec3f step_t;
-        float step_R[9];
-        computeOptimalTransform(filtered_src, target, filtered_corr, step_t, step_R);
+        prev_rmse = current_rmse;
+        rmse = current_rmse;
+        iterations = iter + 1;
 
         // Accumulate: R_total = R_step * R_accum, t_total = R_step * t_accum + t_step
         float new_R[9];
@@ -301,14 +397,84 @@ ICPResult ICPRegistration::align(
         for (int i = 0; i < 9; i++) accum_R[i] = new_R[i];
         accum_t = new_t;
 
-        // Apply step transformation to current source
-        PointCloud new_source;
-        for (size_t i = 0; i < current_source.size(); i++) {
-            new_source.addPoint(transformPoint(current_source.getPoint(i), step_R, step_t));
+        // The points follow in the next search
+        for (int i = 0; i < 9; i++) move_R[i] = step_R[i];
+        move_t = step_t;
+        move_pending = true;
+    }
+
+    // Last step (or the start motion, without iterations) not yet applied
+    if (move_pending) {
+        parallelFor(0, n, [&](size_t begin, size_t end, int) {
+            transformPointsInPlace(current_source.xs() + begin, current_source.ys() + begin,
+                                   current_source.zs() + begin, end - begin, move_R,
+                                   move_t.x, move_t.y, move_t.z);
+        }, REDUCE_MIN_CHUNK);
+    }
+    return iterations;
+}
+
+ICPResult ICPRegistration::align(
+    const PointCloud& source, const PointCloud& target) const {
+
+    ICPResult result;
+    // Initialize as identity matrix (column-major)
+    result.transformation.fill(0);
+    result.transformation[0] = result.transformation[5] =
+        result.transformation[10] = result.transformation[15] = 1.0f;
+    result.fitness = 0;
+    result.rmse = std::numeric_limits<float>::max();
+    result.iterations = 0;
+
+    if (source.empty() || target.empty()) return result;
+
+    const bool point_to_plane = point_to_plane_ && target.hasNormals();
+    if (point_to_plane_ && !point_to_plane) {
+        LOGI("ICP: target has no normals, using point-to-point");
+    }
+
+    // Accumulated transformation
+    float accum_R[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1}; // identity
+    Vec3f accum_t(0, 0, 0);
+
+    // Buffers for the largest level (the full source); pyramid levels
+    // are smaller and reuse them
+    Workspace ws;
+    ws.correspondences.reserve(source.size());
+    ws.distances.reserve(source.size());
+    const int max_chunks = parallelThreadCount(source.size(),
+                                               std::min(SEARCH_MIN_CHUNK, REDUCE_MIN_CHUNK));
+    ws.planes.resize(max_chunks);
+    ws.sums.resize(max_chunks);
+    PointCloud current_source;
+    current_source.reserve(source.size());
+
+    // Coarse-to-fine: converge on the downsampled levels first, coarsest
+    // first; each gets its own KD-tree and starts from the motion so far
+    for (int level = pyramid_levels_ - 1; level >= 1 && pyramid_voxel_size_ > 0; level--) {
+        VoxelGridFilter filter(pyramid_voxel_size_ * static_cast<float>(1 << (level - 1)));
+        PointCloud level_source = filter.apply(source);
+        PointCloud level_target = filter.apply(target);
+        if (level_source.size() < MIN_PYRAMID_POINTS || level_target.size() < MIN_PYRAMID_POINTS) {
+            continue;
         }
-        current_source = new_source;
+
+        KDTree level_tree;
+        level_tree.build(level_target);
+        float level_rmse = result.rmse;
+        int level_iterations = iterate(level_source, level_target, level_tree, point_to_plane,
+                                       accum_R, accum_t, ws, current_source, level_rmse);
+        result.iterations += level_iterations;
+        LOGI("ICP level %d: %zu -> %zu points, iter=%d, rmse=%.6f", level,
+             level_source.size(), level_target.size(), level_iterations, level_rmse);
     }
 
+    // Build KD-tree for target
+    KDTree target_tree;
+    target_tree.build(target);
+    result.iterations += iterate(source, target, target_tree, point_to_plane,
+                                 accum_R, accum_t, ws, current_source, result.rmse);
+
     // Build 4x4 column-major transformation matrix
     // Column-major: [R00, R10, R20, 0, R01, R11, R21, 0, R02, R12, R22, 0, tx, ty, tz, 1]
     result.transformation[0]  = accum_R[0]; // col 0
@@ -329,17 +495,23 @@ ICPResult ICPRegistration::align(
     result.transformation[15] = 1.0f;
 
     // Compute final fitness (fraction of inliers within threshold)
-    float inlier_threshold = 0.01f; // 1cm
-    int inlier_count = 0;
-    auto final_corr = findCorrespondences(current_source, target_tree, target);
-    for (size_t i = 0; i < current_source.size(); i++) {
-        if (final_corr[i].second < inlier_threshold) inlier_count++;
-    }
-    result.fitness = static_cast<float>(inlier_count) /
+    const float inlier_threshold = 0.01f; // 1cm
+    findCorrespondences(current_source, nullptr, accum_t, target_tree, target, 0.0f,
+                        ws.correspondences);
+    const Correspondences& final_corr = ws.correspondences;
+    PairSums inliers = parallelReduce(ws.sums, PairSums{}, current_source.size(),
+        REDUCE_MIN_CHUNK,
+        [&](size_t begin, size_t end, PairSums& acc) {
+            for (size_t i = begin; i < end; i++) {
+                if (final_corr[i].second < inlier_threshold) acc.count++;
+            }
+        },
+        [](PairSums& total, const PairSums& o) { total.count += o.count; });
+    result.fitness = static_cast<float>(inliers.count) /
         static_cast<float>(current_source.size());
 
-    LOGI("ICP converged: iter=%d, fitness=%.4f, rmse=%.6f",
-         result.iterations, result.fitness, result.rmse);
+    LOGI("ICP converged (%s): iter=%d, fitness=%.4f, rmse=%.6f",
+         point_to_plane ? "point-to-plane" : "point-to-point", result.iterations, result.fitness, result.rmse);
 
     return result;
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include "point_cloud.h"
 #include "../util/kdtree.h"
+#include "../util/normal_equations6.h"
 #include <array>
 
 namespace scanforge {
@@ -17,29 +18,136 @@ public:
     ICPRegistration(int max_iterations, float tolerance)
         : max_iterations_(max_iterations), tolerance_(tolerance) {}
 
+    /**
+     * Use approximate nearest neighbors for correspondences (off by
+     * default). Iterations start at initial_epsilon with at most
+     * max_leaf_visits leaves per query; epsilon is halved whenever an
+     * iteration improves the RMSE by less than 1%, and once ICP has
+     * converged on approximate matches it continues with exact search,
+     * so the reported RMSE and fitness always come from exact matches.
+     */
+    void setApproximateSearch(float initial_epsilon, int max_leaf_visits) {
+        initial_epsilon_ = initial_epsilon;
+        max_leaf_visits_ = max_leaf_visits;
+    }
+
+    /**
+     * Point-to-plane ICP (off by default): minimizes the distance of the
+     * source points to the tangent planes of their matches, using the
+     * target's normal channel. Rotation is linearized per iteration and
+     * the 6x6 normal equations are accumulated in parallel and solved by
+     * Cholesky. On scanned surfaces this converges in far fewer
+     * iterations than point-to-point. Falls back to point-to-point when
+     * the target has no normals or the system is singular.
+     */
+    void setPointToPlane(bool enabled) { point_to_plane_ = enabled; }
+
+    /**
+     * Coarse-to-fine registration (off by default). Both clouds are
+     * voxel-downsampled to levels - 1 coarser copies, with voxel_size at
+     * the finest of them and doubling per level, each with its own
+     * KD-tree. ICP runs to convergence on the coarsest level first and
+     * the transform is carried down level by level to the full clouds,
+     * where only a few iterations remain. Levels left with too few
+     * points are skipped. levels <= 1 disables it.
+     */
+    void setPyramid(int levels, float voxel_size) {
+        pyramid_levels_ = levels;
+        pyramid_voxel_size_ = voxel_size;
+    }
+
     ICPResult align(const PointCloud& source, const PointCloud& target) const;
 
 private:
     int max_iterations_;
     float tolerance_;
+    float initial_epsilon_ = 0.0f;
+    int max_leaf_visits_ = 0;
+    bool point_to_plane_ = false;
+    int pyramid_levels_ = 0;
+    float pyramid_voxel_size_ = 0.0f;
+
+    // Below this epsilon the schedule switches to exact search
+    static constexpr float MIN_EPSILON = 0.05f;
+    // Relative RMSE improvement under which epsilon is halved
+    static constexpr float EPSILON_TIGHTEN_RATE = 0.01f;
+    // Pyramid levels with fewer source or target points are skipped
+    static constexpr size_t MIN_PYRAMID_POINTS = 100;
+    // Minimum points per thread for the correspondence search and for
+    // the reductions
+    static constexpr size_t SEARCH_MIN_CHUNK = 1024;
+    static constexpr size_t REDUCE_MIN_CHUNK = 8192;
+
+    // Matches are (target index, distance) per source point
+    using Correspondences = std::vector<std::pair<int, float>>;
+
+    // Sums over the inlier pairs: coordinates, cross products
+    // (source x target, row-major) and squared distances
+    struct PairSums {
+        double source[3];
+        double target[3];
+        double cross[9];
+        double distance_sq;
+        size_t count;
+    };
 
-    // Find closest point in target for each source point using KD-tree
-    std::vector<std::pair<int, float>> findCorrespondences(
-        const PointCloud& source, const KDTree& target_tree,
-        const PointCloud& target) const;
+    // Point-to-plane equations plus the squared distances of the same
+    // inlier pairs (the equations skip pairs without a normal)
+    struct PlaneSums {
+        NormalEquations6 equations;
+        double distance_sq;
+        size_t count;
+    };
 
-    // Compute optimal rotation via SVD of cross-covariance matrix
-    // Uses Eigen-free 3x3 SVD via Jacobi rotations
+    // Scratch for one align(), sized once for the full source so the
+    // iterations (on every pyramid level) allocate nothing; the parallel
+    // passes run on the shared ThreadPool, which starts no threads.
+    struct Workspace {
+        Correspondences correspondences;
+        std::vector<float> distances;  // reordered by the median selection
+        // Per-thread partial sums
+        std::vector<PlaneSums> planes;
+        std::vector<PairSums> sums;
+    };
+
+    // ICP iterations of source against target (indexed by target_tree),
+    // starting from and updating the accumulated motion (R, t).
+    // current_source receives the source moved by the result, rmse the
+    // error of the last iteration. Returns the number of iterations.
+    // Each iteration is two parallel passes: the search, which first
+    // applies the previous step to the points, and the step's reduction,
+    // which also sums the inlier RMSE.
+    int iterate(const PointCloud& source, const PointCloud& target, const KDTree& target_tree,
+                bool point_to_plane, float R[9], Vec3f& t, Workspace& ws,
+                PointCloud& current_source, float& rmse) const;
+
+    // Find closest point in target for each source point using KD-tree,
+    // in parallel. epsilon > 0 uses the approximate search with the leaf
+    // budget. With move_R set, each chunk of source is first moved in
+    // place by (move_R, move_t).
+    void findCorrespondences(
+        PointCloud& source, const float* move_R, const Vec3f& move_t,
+        const KDTree& target_tree, const PointCloud& target, float epsilon,
+        Correspondences& correspondences) const;
+
+    // Compute optimal rotation via SVD of cross-covariance matrix over the
+    // pairs within max_distance. Uses Eigen-free 3x3 SVD via Jacobi rotations.
+    // inliers receives the count and squared distances of those pairs.
     void computeOptimalTransform(
         const PointCloud& source, const PointCloud& target,
-        const std::vector<std::pair<int, float>>& correspondences,
-        Vec3f& translation, float rotation[9]) const;
+        const Correspondences& correspondences, float max_distance, Workspace& ws,
+        Vec3f& translation, float rotation[9], PairSums& inliers) const;
+
+    // Gauss-Newton point-to-plane step over the pairs within
+    // max_distance; false if they do not constrain all six degrees of
+    // freedom. inliers as for computeOptimalTransform, either way.
+    bool computePointToPlaneTransform(
+        const PointCloud& source, const PointCloud& target,
+        const Correspondences& correspondences, float max_distance, Workspace& ws,
+        Vec3f& translation, float rotation[9], PairSums& inliers) const;
 
     // 3x3 SVD via iterative Jacobi rotations (no Eigen dependency)
     void svd3x3(const float H[9], float U[9], float S[3], float V[9]) const;
-
-    // Apply 3x3 rotation + translation to a point
-    Vec3f transformPoint(const Vec3f& p, const float R[9], const Vec3f& t) const;
 };
 
 } // namespace scanforge
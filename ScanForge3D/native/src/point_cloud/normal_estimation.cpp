@@ -1,5 +1,7 @@
 #include "normal_estimation.h"
 #include "../util/kdtree.h"
+#include "../util/parallel.h"
+#include "../util/symmetric_eigen3.h"
 #include <android/log.h>
 #include <cmath>
 #include <algorithm>
@@ -11,101 +13,22 @@
 
 namespace scanforge {
 
-void NormalEstimation::eigenDecomposition3x3(const float A[9],
-                                              float eigenvalues[3],
-                                              float eigenvectors[9]) {
-    // Jacobi eigenvalue algorithm for 3x3 symmetric matrix
-    // A is stored row-major: A[row*3 + col]
-    // eigenvectors stored column-major: V[row*3 + col] = col-th eigenvector's row component
-
-    // Work on a copy
-    float S[9];
-    for (int i = 0; i < 9; i++) S[i] = A[i];
-
-    // Initialize V to identity
-    for (int i = 0; i < 9; i++) eigenvectors[i] = 0;
-    eigenvectors[0] = eigenvectors[4] = eigenvectors[8] = 1.0f;
-
-    const int max_iter = 50;
-
-    for (int iter = 0; iter < max_iter; iter++) {
-        // Find largest off-diagonal element
-        int p = 0, q = 1;
-        float max_val = std::abs(S[1]);
-        if (std::abs(S[2]) > max_val) { p = 0; q = 2; max_val = std::abs(S[2]); }
-        if (std::abs(S[5]) > max_val) { p = 1; q = 2; max_val = std::abs(S[5]); }
-
-        if (max_val < 1e-10f) break; // Converged
-
-        // Compute rotation angle
-        float app = S[p * 3 + p];
-        float aqq = S[q * 3 + q];
-        float apq = S[p * 3 + q];
-
-        float theta;
-        if (std::abs(app - aqq) < 1e-12f) {
-            theta = 3.14159265f / 4.0f;
-        } else {
-            theta = 0.5f * std::atan2(2.0f * apq, app - aqq);
-        }
+std::vector<Vec3f> NormalEstimation::estimate(const PointCloud& cloud) const {
+    if (cloud.size() < 3) return std::vector<Vec3f>(cloud.size(), {0, 1, 0});
 
-        float c = std::cos(theta);
-        float s = std::sin(theta);
-
-        // Apply Jacobi rotation: S' = G^T * S * G
-        // Only update affected rows/columns
-        float new_S[9];
-        for (int i = 0; i < 9; i++) new_S[i] = S[i];
-
-        new_S[p * 3 + p] = c * c * app + 2 * c * s * apq + s * s * aqq;
-        new_S[q * 3 + q] = s * s * app - 2 * c * s * apq + c * c * aqq;
-        new_S[p * 3 + q] = 0;
-        new_S[q * 3 + p] = 0;
-
-        // Update the third row/column (r != p, r != q)
-        int r = 3 - p - q; // the remaining index
-        float srp = S[r * 3 + p];
-        float srq = S[r * 3 + q];
-        new_S[r * 3 + p] = c * srp + s * srq;
-        new_S[p * 3 + r] = new_S[r * 3 + p];
-        new_S[r * 3 + q] = -s * srp + c * srq;
-        new_S[q * 3 + r] = new_S[r * 3 + q];
-
-        for (int i = 0; i < 9; i++) S[i] = new_S[i];
-
-        // Update eigenvectors: V' = V * G
-        for (int i = 0; i < 3; i++) {
-            float vip = eigenvectors[i * 3 + p];
-            float viq = eigenvectors[i * 3 + q];
-            eigenvectors[i * 3 + p] = c * vip + s * viq;
-            eigenvectors[i * 3 + q] = -s * vip + c * viq;
-        }
-    }
+    // Build KD-tree and the k-NN graph for all points in one batch
+    KDTree tree;
+    tree.build(cloud);
+    KNNGraph graph = tree.knnAll(k_neighbors_);
+    return estimate(cloud, graph);
+}
 
-    // Extract eigenvalues from diagonal
-    float evals[3] = { S[0], S[4], S[8] };
-    // Sort by ascending eigenvalue
-    int order[3] = {0, 1, 2};
-    if (evals[order[0]] > evals[order[1]]) std::swap(order[0], order[1]);
-    if (evals[order[1]] > evals[order[2]]) std::swap(order[1], order[2]);
-    if (evals[order[0]] > evals[order[1]]) std::swap(order[0], order[1]);
-
-    eigenvalues[0] = evals[order[0]];
-    eigenvalues[1] = evals[order[1]];
-    eigenvalues[2] = evals[order[2]];
-
-    // Reorder eigenvectors (stored as columns)
-    float sorted_V[9];
-    for (int i = 0; i < 3; i++) {
-        // Column j of sorted_V = column order[j] of eigenvectors
-        for (int row = 0; row < 3; row++) {
-            sorted_V[row * 3 + i] = eigenvectors[row * 3 + order[i]];
-        }
-    }
-    for (int i = 0; i < 9; i++) eigenvectors[i] = sorted_V[i];
+std::vector<Vec3f> NormalEstimation::estimate(const NeighborhoodIndex& index) const {
+    return estimate(index.cloud(), index.graph());
 }
 
-std::vector<Vec3f> NormalEstimation::estimate(const PointCloud& cloud) const {
+std::vector<Vec3f> NormalEstimation::estimate(const PointCloud& cloud,
+                                              const KNNGraph& graph) const {
     int n = static_cast<int>(cloud.size());
     std::vector<Vec3f> normals(n, {0, 1, 0});
 
@@ -113,60 +36,183 @@ std::vector<Vec3f> NormalEstimation::estimate(const PointCloud& cloud) const {
 
     LOGI("Normal estimation: %d points, k=%d", n, k_neighbors_);
 
-    // Build KD-tree
-    KDTree tree;
-    tree.build(cloud);
-
-    int k = std::min(k_neighbors_, n);
+    if (keep_existing_ && cloud.hasNormals()) {
+        estimateMissing(cloud, graph, normals);
+        return normals;
+    }
 
-    for (int i = 0; i < n; i++) {
-        const Vec3f& p = cloud.getPoint(i);
-        std::vector<int> neighbors = tree.findKNearest(p, k);
+    estimateUnoriented(cloud, graph, normals.data());
 
-        if (static_cast<int>(neighbors.size()) < 3) {
-            normals[i] = Vec3f(0, 1, 0);
-            continue;
+    if (!viewpoints_.empty() && cloud.hasFrameIds()) {
+        size_t unoriented = orientTowardViewpoints(cloud, viewpoints_, normals.data());
+        if (unoriented > 0) {
+            LOGI("Viewpoint orientation: %zu points without a frame origin", unoriented);
         }
+    } else {
+        // Orient normals consistently, reusing the same neighborhoods
+        orientNormals(cloud, graph, normals);
+    }
+
+    LOGI("Normal estimation complete: %d normals computed", n);
+    return normals;
+}
 
-        // Compute centroid of neighborhood
-        Vec3f centroid(0, 0, 0);
-        for (int ni : neighbors) {
-            centroid = centroid + cloud.getPoint(ni);
+void NormalEstimation::estimateUnoriented(const PointCloud& cloud,
+                                          const KNNGraph& graph,
+                                          Vec3f* normals,
+                                          const uint8_t* skip) const {
+    size_t n = cloud.size();
+    // Rows are sorted closest first, so a wider graph serves any smaller k
+    int k = std::min(k_neighbors_, graph.k);
+    if (k < 3) {
+        for (size_t i = 0; i < n; i++) {
+            if (!skip || !skip[i]) normals[i] = Vec3f(0, 1, 0);
         }
-        centroid = centroid / static_cast<float>(neighbors.size());
-
-        // Build 3x3 covariance matrix (symmetric)
-        float cov[9] = {0};
-        for (int ni : neighbors) {
-            Vec3f d = cloud.getPoint(ni) - centroid;
-            cov[0] += d.x * d.x; cov[1] += d.x * d.y; cov[2] += d.x * d.z;
-            cov[3] += d.y * d.x; cov[4] += d.y * d.y; cov[5] += d.y * d.z;
-            cov[6] += d.z * d.x; cov[7] += d.z * d.y; cov[8] += d.z * d.z;
+        return;
+    }
+
+    const float* xs = cloud.xs();
+    const float* ys = cloud.ys();
+    const float* zs = cloud.zs();
+
+    parallelFor(0, n, [&](size_t begin, size_t end, int) {
+        // Per-thread scratch: neighbor offsets from the query point, and
+        // a block of covariances in SoA layout for the batch eigensolver
+        std::vector<float> dx(k), dy(k), dz(k);
+        std::vector<float> cov(6 * EIGEN_BLOCK), axis(3 * EIGEN_BLOCK);
+        std::vector<size_t> index(EIGEN_BLOCK);
+        float* cxx = cov.data();
+        float* cxy = cxx + EIGEN_BLOCK;
+        float* cxz = cxy + EIGEN_BLOCK;
+        float* cyy = cxz + EIGEN_BLOCK;
+        float* cyz = cyy + EIGEN_BLOCK;
+        float* czz = cyz + EIGEN_BLOCK;
+        const SymMat3Arrays block{cxx, cxy, cxz, cyy, cyz, czz};
+        size_t count = 0;
+        const float inv_k = 1.0f / static_cast<float>(k);
+
+        // Normal = eigenvector of the smallest eigenvalue
+        auto solveBlock = [&] {
+            float* ax = axis.data();
+            float* ay = ax + EIGEN_BLOCK;
+            float* az = ay + EIGEN_BLOCK;
+            smallestEigenvectors(block, count, ax, ay, az);
+            for (size_t b = 0; b < count; b++) normals[index[b]] = Vec3f(ax[b], ay[b], az[b]);
+            count = 0;
+        };
+
+        for (size_t i = begin; i < end; i++) {
+            if (skip && skip[i]) continue;
+            const int* neighbors = graph.neighbors(i);
+            for (int j = 0; j < k; j++) {
+                int nj = neighbors[j];
+                dx[j] = xs[nj] - xs[i];
+                dy[j] = ys[nj] - ys[i];
+                dz[j] = zs[nj] - zs[i];
+            }
+
+            // Single pass: sums and sums of products, relative to the
+            // query point so they stay small; cov = S2 - S1 S1^T / k
+            float sx = 0, sy = 0, sz = 0;
+            float xx = 0, xy = 0, xz = 0, yy = 0, yz = 0, zz = 0;
+            for (int j = 0; j < k; j++) {
+                float x = dx[j], y = dy[j], z = dz[j];
+                sx += x; sy += y; sz += z;
+                xx += x * x; xy += x * y; xz += x * z;
+                yy += y * y; yz += y * z; zz += z * z;
+            }
+            cxx[count] = xx - sx * sx * inv_k;
+            cxy[count] = xy - sx * sy * inv_k;
+            cxz[count] = xz - sx * sz * inv_k;
+            cyy[count] = yy - sy * sy * inv_k;
+            cyz[count] = yz - sy * sz * inv_k;
+            czz[count] = zz - sz * sz * inv_k;
+            index[count++] = i;
+            if (count == EIGEN_BLOCK) solveBlock();
         }
+        if (count > 0) solveBlock();
+    }, 2048);
+}
 
-        // Eigendecomposition
-        float eigenvalues[3];
-        float eigenvectors[9];
-        eigenDecomposition3x3(cov, eigenvalues, eigenvectors);
-
-        // Normal = eigenvector with smallest eigenvalue (column 0 after sorting)
-        Vec3f normal(eigenvectors[0], eigenvectors[3], eigenvectors[6]);
-        float len = normal.length();
-        if (len > 1e-8f) {
-            normals[i] = normal / len;
-        } else {
-            normals[i] = Vec3f(0, 1, 0);
+void NormalEstimation::estimateMissing(const PointCloud& cloud, const KNNGraph& graph,
+                                       std::vector<Vec3f>& normals) const {
+    size_t n = cloud.size();
+    const std::vector<Vec3f>& existing = cloud.normals();
+    std::vector<uint8_t> has(n);
+    parallelFor(0, n, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; i++) {
+            const Vec3f& e = existing[i];
+            has[i] = e.x != 0.0f || e.y != 0.0f || e.z != 0.0f;
+            if (has[i]) normals[i] = e;
         }
+    }, 16384);
+
+    estimateUnoriented(cloud, graph, normals.data(), has.data());
+
+    if (!viewpoints_.empty() && cloud.hasFrameIds()) {
+        orientTowardViewpoints(cloud, viewpoints_, normals.data());
+        // The pass may flip a kept normal seen at a grazing angle
+        parallelFor(0, n, [&](size_t begin, size_t end, int) {
+            for (size_t i = begin; i < end; i++) {
+                if (has[i]) normals[i] = existing[i];
+            }
+        }, 16384);
+        return;
     }
 
-    // Orient normals consistently
-    orientNormals(cloud, normals);
+    // Agree with the sum of the kept normals in the neighborhood
+    int k = std::min(k_neighbors_, graph.k);
+    parallelFor(0, n, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; i++) {
+            if (has[i]) continue;
+            const int* neighbors = graph.neighbors(i);
+            Vec3f sum(0, 0, 0);
+            for (int j = 0; j < k; j++) {
+                if (has[neighbors[j]]) sum = sum + existing[neighbors[j]];
+            }
+            if (normals[i].dot(sum) < 0) normals[i] = normals[i] * (-1.0f);
+        }
+    }, 4096);
+}
+
+size_t NormalEstimation::orientTowardViewpoints(const PointCloud& cloud,
+                                               const std::vector<Vec3f>& origins,
+                                               Vec3f* normals) {
+    size_t n = cloud.size();
+    if (!cloud.hasFrameIds() || n == 0) return n;
+
+    const float* xs = cloud.xs();
+    const float* ys = cloud.ys();
+    const float* zs = cloud.zs();
+    const int32_t* frame_ids = cloud.frameIds().data();
+    const int32_t num_origins = static_cast<int32_t>(origins.size());
+
+    const size_t min_chunk = 16384;
+    std::vector<size_t> missing(parallelThreadCount(n, min_chunk), 0);
+    parallelFor(0, n, [&](size_t begin, size_t end, int chunk) {
+        size_t local_missing = 0;
+        for (size_t i = begin; i < end; i++) {
+            int32_t f = frame_ids[i];
+            if (f < 0 || f >= num_origins) {
+                local_missing++;
+                continue;
+            }
+            const Vec3f& o = origins[f];
+            Vec3f& nrm = normals[i];
+            float facing = nrm.x * (o.x - xs[i]) + nrm.y * (o.y - ys[i])
+                         + nrm.z * (o.z - zs[i]);
+            if (facing < 0) nrm = nrm * (-1.0f);
+        }
+        missing[chunk] = local_missing;
+    }, min_chunk);
 
-    LOGI("Normal estimation complete: %d normals computed", n);
-    return normals;
+    size_t total = 0;
+    for (size_t m : missing) total += m;
+    return total;
 }
 
 void NormalEstimation::orientNormals(const PointCloud& cloud,
+                                     const KNNGraph& graph,
                                      std::vector<Vec3f>& normals) const {
     int n = static_cast<int>(cloud.size());
     if (n == 0) return;
@@ -187,10 +233,7 @@ void NormalEstimation::orientNormals(const PointCloud& cloud,
     }
 
     // BFS propagation for local consistency using k-NN graph
-    KDTree tree;
-    tree.build(cloud);
-
-    int k = std::min(k_neighbors_, n);
+    int k = std::min(k_neighbors_, graph.k);
     std::vector<bool> visited(n, false);
     std::queue<int> queue;
 
@@ -212,8 +255,9 @@ void NormalEstimation::orientNormals(const PointCloud& cloud,
         int idx = queue.front();
         queue.pop();
 
-        std::vector<int> neighbors = tree.findKNearest(cloud.getPoint(idx), k);
-        for (int ni : neighbors) {
+        const int* neighbors = graph.neighbors(idx);
+        for (int j = 0; j < k; j++) {
+            int ni = neighbors[j];
             if (visited[ni]) continue;
             visited[ni] = true;
 
@@ -1,5 +1,7 @@
 #pragma once
 #include "point_cloud.h"
+#include "../util/kdtree.h"
+#include "../util/neighborhood_index.h"
 #include <vector>
 
 namespace scanforge {
@@ -10,43 +12,91 @@ namespace scanforge {
  * For each point, finds k nearest neighbors via KD-tree,
  * computes the 3x3 covariance matrix of the local neighborhood,
  * and extracts the eigenvector corresponding to the smallest
- * eigenvalue as the surface normal.
+ * eigenvalue as the surface normal, using the closed-form solver in
+ * symmetric_eigen3.h.
  *
- * Normal orientation is propagated via a minimum spanning tree
- * of the k-NN graph to ensure global consistency.
+ * By default normal orientation is propagated via a minimum spanning
+ * tree of the k-NN graph to ensure global consistency. When the sensor
+ * origins of the capture frames are known (setViewpoints) and the cloud
+ * carries frame ids, each normal is instead flipped to face the camera
+ * that captured its point.
  */
 class NormalEstimation {
 public:
     explicit NormalEstimation(int k_neighbors = 15)
         : k_neighbors_(k_neighbors) {}
 
+    /**
+     * Camera position of every capture frame, indexed by frame id.
+     * A surface is only seen from its outer side, so a normal that
+     * faces its camera is correct on concave parts too, where the
+     * propagation can flip whole regions. Used when the cloud has a
+     * frame id channel; empty = propagation.
+     */
+    void setViewpoints(std::vector<Vec3f> origins) { viewpoints_ = std::move(origins); }
+
+    /**
+     * Keep the normals a cloud already carries (non-zero entries of its
+     * normal channel, e.g. accumulated depth-image normals) and run PCA
+     * only for the points without one. Those are oriented toward their
+     * camera if viewpoints are set, otherwise to agree with the kept
+     * normals among their neighbors.
+     */
+    void setKeepExisting(bool enabled) { keep_existing_ = enabled; }
+
     /**
      * Estimate normals for all points in the cloud.
      * Returns a vector of unit normals, one per point.
      */
     std::vector<Vec3f> estimate(const PointCloud& cloud) const;
 
-private:
-    int k_neighbors_;
+    /**
+     * Estimate normals from the cached neighborhoods of a shared index.
+     * The index should hold at least k_neighbors per point.
+     */
+    std::vector<Vec3f> estimate(const NeighborhoodIndex& index) const;
 
     /**
-     * Jacobi eigenvalue decomposition for a 3x3 symmetric matrix.
-     * Returns eigenvalues in ascending order and corresponding eigenvectors
-     * as columns of V.
-     *
-     * @param A  Input symmetric matrix (row-major, 9 floats)
-     * @param eigenvalues  Output eigenvalues [3]
-     * @param eigenvectors Output eigenvectors (column-major, 9 floats)
+     * PCA normals without orientation (sign arbitrary), written to
+     * normals[0 .. cloud.size()). Multi-threaded: each thread gathers a
+     * neighborhood into its own scratch buffer and builds the covariance
+     * in one pass from sums and sums of products, with no allocation
+     * per point. Points with fewer than 3 neighbors get (0, 1, 0).
+     * Points with skip[i] != 0 (if skip is given) are left untouched.
      */
-    static void eigenDecomposition3x3(const float A[9],
-                                       float eigenvalues[3],
-                                       float eigenvectors[9]);
+    void estimateUnoriented(const PointCloud& cloud, const KNNGraph& graph,
+                            Vec3f* normals, const uint8_t* skip = nullptr) const;
+
+    /**
+     * Flip every normal i that points away from origins[frame_id[i]].
+     * One independent test per point, multi-threaded, no neighborhood
+     * queries. Points whose frame id has no origin keep their sign and
+     * are counted in the return value.
+     */
+    static size_t orientTowardViewpoints(const PointCloud& cloud,
+                                         const std::vector<Vec3f>& origins,
+                                         Vec3f* normals);
+
+private:
+    // Covariances per smallestEigenvectors call in estimateUnoriented
+    static constexpr size_t EIGEN_BLOCK = 256;
+
+    int k_neighbors_;
+    std::vector<Vec3f> viewpoints_;
+    bool keep_existing_ = false;
+
+    std::vector<Vec3f> estimate(const PointCloud& cloud, const KNNGraph& graph) const;
+
+    // setKeepExisting path: PCA and orientation for the points without
+    // a normal in the cloud, the others copied
+    void estimateMissing(const PointCloud& cloud, const KNNGraph& graph,
+                         std::vector<Vec3f>& normals) const;
 
     /**
      * Orient normals consistently using a propagation approach.
      * Uses k-NN graph and BFS to propagate orientation from a seed point.
      */
-    void orientNormals(const PointCloud& cloud,
+    void orientNormals(const PointCloud& cloud, const KNNGraph& graph,
                        std::vector<Vec3f>& normals) const;
 };
 
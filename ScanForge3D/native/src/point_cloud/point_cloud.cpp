@@ -1,9 +1,125 @@
 #include "point_cloud.h"
+#include "../util/parallel.h"
 #include <unordered_map>
 #include <unordered_set>
+#include <type_traits>
 
 namespace scanforge {
 
+void PointCloud::reserve(size_t n) {
+    forEachArray([n](auto& v) { v.reserve(n); });
+}
+
+void PointCloud::addPoint(const Vec3f& p) {
+    xs_.push_back(p.x);
+    ys_.push_back(p.y);
+    zs_.push_back(p.z);
+    if (has_normals_) normals_.emplace_back(0, 0, 0);
+    if (has_confidence_) confidence_.push_back(1.0f);
+    if (has_colors_) colors_.push_back(0xFFFFFFFFu);
+    if (has_frame_ids_) frame_ids_.push_back(0);
+}
+
+void PointCloud::clear() {
+    forEachArray([](auto& v) { v.clear(); });
+}
+
+void PointCloud::resize(size_t n) {
+    xs_.resize(n); ys_.resize(n); zs_.resize(n);
+    if (has_normals_) normals_.resize(n, Vec3f(0, 0, 0));
+    if (has_confidence_) confidence_.resize(n, 1.0f);
+    if (has_colors_) colors_.resize(n, 0xFFFFFFFFu);
+    if (has_frame_ids_) frame_ids_.resize(n, 0);
+}
+
+std::vector<Vec3f> PointCloud::getPoints() const {
+    std::vector<Vec3f> points(size());
+    for (size_t i = 0; i < points.size(); i++) points[i] = getPoint(i);
+    return points;
+}
+
+PointCloud PointCloud::emptyCopy() const {
+    PointCloud out;
+    out.has_normals_ = has_normals_;
+    out.has_confidence_ = has_confidence_;
+    out.has_colors_ = has_colors_;
+    out.has_frame_ids_ = has_frame_ids_;
+    return out;
+}
+
+PointCloud PointCloud::select(const std::vector<int>& indices) const {
+    PointCloud out = emptyCopy();
+    out.reserve(indices.size());
+    for (int i : indices) out.addPointFrom(*this, i);
+    return out;
+}
+
+void PointCloud::addPointFrom(const PointCloud& other, size_t i) {
+    xs_.push_back(other.xs_[i]);
+    ys_.push_back(other.ys_[i]);
+    zs_.push_back(other.zs_[i]);
+    if (has_normals_) {
+        normals_.push_back(other.has_normals_ ? other.normals_[i] : Vec3f(0, 0, 0));
+    }
+    if (has_confidence_) {
+        confidence_.push_back(other.has_confidence_ ? other.confidence_[i] : 1.0f);
+    }
+    if (has_colors_) {
+        colors_.push_back(other.has_colors_ ? other.colors_[i] : 0xFFFFFFFFu);
+    }
+    if (has_frame_ids_) {
+        frame_ids_.push_back(other.has_frame_ids_ ? other.frame_ids_[i] : 0);
+    }
+}
+
+// Parallel compaction: every chunk writes its survivors from its prefix
+// offset on, so the order is preserved. Out of place, since in place a
+// chunk could overwrite items the chunk before it has not read yet.
+static constexpr size_t COMPACT_MIN_CHUNK = 65536;
+
+template <typename T>
+static void compactInto(const std::vector<T>& src, std::vector<T>& dst,
+                        const std::vector<uint8_t>& keep,
+                        const std::vector<size_t>& offset) {
+    dst.resize(offset.back());
+    parallelFor(0, src.size(), [&](size_t begin, size_t end, int chunk) {
+        size_t out = offset[chunk];
+        for (size_t i = begin; i < end; i++) {
+            if (keep[i]) dst[out++] = src[i];
+        }
+    }, COMPACT_MIN_CHUNK);
+}
+
+void PointCloud::retain(const std::vector<uint8_t>& keep) {
+    if (keep.size() != size()) return;
+    std::vector<size_t> offset = parallelCompactOffsets(keep, COMPACT_MIN_CHUNK);
+    if (offset.back() == size()) return;
+    forEachArray([&](auto& v) {
+        typename std::remove_reference<decltype(v)>::type out;
+        compactInto(v, out, keep, offset);
+        v.swap(out);
+    });
+}
+
+PointCloud PointCloud::retained(const std::vector<uint8_t>& keep) const {
+    PointCloud out = emptyCopy();
+    if (keep.size() != size()) return out;
+    std::vector<size_t> offset = parallelCompactOffsets(keep, COMPACT_MIN_CHUNK);
+    out.forEachArrayPair(*this, [&](auto& dst, const auto& src) {
+        compactInto(src, dst, keep, offset);
+    });
+    return out;
+}
+
+void PointCloud::permute(const std::vector<int>& order) {
+    if (order.size() != size()) return;
+    forEachArray([&order](auto& v) {
+        typename std::remove_reference<decltype(v)>::type sorted(v.size());
+        for (size_t i = 0; i < order.size(); i++) sorted[i] = v[order[i]];
+        v.swap(sorted);
+    });
+}
+
 bool TriangleMesh::isManifold() const {
     // An edge is manifold if it's shared by exactly 1 or 2 triangles
     struct EdgeKey {
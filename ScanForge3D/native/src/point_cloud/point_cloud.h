@@ -4,6 +4,7 @@
 #include <cmath>
 #include <algorithm>
 #include <array>
+#include <cstdint>
 
 namespace scanforge {
 
@@ -36,32 +37,146 @@ struct Triangle {
     Triangle(int a, int b, int c) : a(a), b(b), c(c) {}
 };
 
+/**
+ * Point cloud in structure-of-arrays layout.
+ *
+ * Coordinates live in separate x / y / z arrays so SIMD kernels can
+ * stream them directly. Optional attribute channels (normals,
+ * confidence, color, source frame id) are enabled per cloud and kept
+ * aligned with the points by every operation here, so filters that go
+ * through select() / permute() / retain() carry them automatically.
+ * addPoint() fills enabled channels with defaults.
+ */
 class PointCloud {
 public:
-    void reserve(size_t n) { points_.reserve(n); }
-    void addPoint(const Vec3f& p) { points_.push_back(p); }
-    const Vec3f& getPoint(size_t i) const { return points_[i]; }
-    size_t size() const { return points_.size(); }
-    bool empty() const { return points_.empty(); }
-
-    void clear() { points_.clear(); }
-    const std::vector<Vec3f>& getPoints() const { return points_; }
+    void reserve(size_t n);
+    void addPoint(const Vec3f& p);
+    Vec3f getPoint(size_t i) const { return {xs_[i], ys_[i], zs_[i]}; }
+    void setPoint(size_t i, const Vec3f& p) { xs_[i] = p.x; ys_[i] = p.y; zs_[i] = p.z; }
+    size_t size() const { return xs_.size(); }
+    bool empty() const { return xs_.empty(); }
+
+    // Removes all points; enabled channels stay enabled (and empty)
+    void clear();
+    void resize(size_t n);
+
+    // Per-axis coordinate arrays
+    const float* xs() const { return xs_.data(); }
+    const float* ys() const { return ys_.data(); }
+    const float* zs() const { return zs_.data(); }
+    float* xs() { return xs_.data(); }
+    float* ys() { return ys_.data(); }
+    float* zs() { return zs_.data(); }
+
+    // AoS copy of the coordinates
+    std::vector<Vec3f> getPoints() const;
 
     void computeBounds(Vec3f& min_bound, Vec3f& max_bound) const {
-        if (points_.empty()) return;
-        min_bound = max_bound = points_[0];
-        for (const auto& p : points_) {
-            min_bound.x = std::min(min_bound.x, p.x);
-            min_bound.y = std::min(min_bound.y, p.y);
-            min_bound.z = std::min(min_bound.z, p.z);
-            max_bound.x = std::max(max_bound.x, p.x);
-            max_bound.y = std::max(max_bound.y, p.y);
-            max_bound.z = std::max(max_bound.z, p.z);
+        if (empty()) return;
+        min_bound = max_bound = getPoint(0);
+        for (size_t i = 1; i < size(); i++) {
+            min_bound.x = std::min(min_bound.x, xs_[i]);
+            min_bound.y = std::min(min_bound.y, ys_[i]);
+            min_bound.z = std::min(min_bound.z, zs_[i]);
+            max_bound.x = std::max(max_bound.x, xs_[i]);
+            max_bound.y = std::max(max_bound.y, ys_[i]);
+            max_bound.z = std::max(max_bound.z, zs_[i]);
         }
     }
 
+    // Attribute channels. enable*() allocates a channel filled with the
+    // default; set*() replaces it and is ignored on a size mismatch.
+    bool hasNormals() const { return has_normals_; }
+    bool hasConfidence() const { return has_confidence_; }
+    bool hasColors() const { return has_colors_; }
+    bool hasFrameIds() const { return has_frame_ids_; }
+
+    void enableNormals() { enable(has_normals_, normals_, Vec3f(0, 0, 0)); }
+    void enableConfidence() { enable(has_confidence_, confidence_, 1.0f); }
+    void enableColors() { enable(has_colors_, colors_, 0xFFFFFFFFu); }
+    void enableFrameIds() { enable(has_frame_ids_, frame_ids_, 0); }
+
+    void setNormals(std::vector<Vec3f> v) { set(has_normals_, normals_, std::move(v)); }
+    void setConfidence(std::vector<float> v) { set(has_confidence_, confidence_, std::move(v)); }
+    void setColors(std::vector<uint32_t> v) { set(has_colors_, colors_, std::move(v)); }
+    void setFrameIds(std::vector<int32_t> v) { set(has_frame_ids_, frame_ids_, std::move(v)); }
+
+    // Unit normal per point
+    const std::vector<Vec3f>& normals() const { return normals_; }
+    std::vector<Vec3f>& normals() { return normals_; }
+    // Sensor confidence in [0, 1]
+    const std::vector<float>& confidence() const { return confidence_; }
+    std::vector<float>& confidence() { return confidence_; }
+    // Packed 0xAARRGGBB
+    const std::vector<uint32_t>& colors() const { return colors_; }
+    std::vector<uint32_t>& colors() { return colors_; }
+    // Index of the depth frame the point came from
+    const std::vector<int32_t>& frameIds() const { return frame_ids_; }
+    std::vector<int32_t>& frameIds() { return frame_ids_; }
+
+    // Same channel layout, no points
+    PointCloud emptyCopy() const;
+
+    // New cloud with the points (and attributes) at the given indices
+    PointCloud select(const std::vector<int>& indices) const;
+    // Keeps points with keep[i] != 0 (multi-threaded, order preserved)
+    void retain(const std::vector<uint8_t>& keep);
+    // New cloud with the points where keep[i] != 0; empty copy on a size
+    // mismatch
+    PointCloud retained(const std::vector<uint8_t>& keep) const;
+    // Reorders in place so that new point i is old point order[i]
+    void permute(const std::vector<int>& order);
+
+    // Appends point i of other (same channel layout expected; channels
+    // missing in other get defaults)
+    void addPointFrom(const PointCloud& other, size_t i);
+
 private:
-    std::vector<Vec3f> points_;
+    std::vector<float> xs_, ys_, zs_;
+
+    bool has_normals_ = false;
+    bool has_confidence_ = false;
+    bool has_colors_ = false;
+    bool has_frame_ids_ = false;
+    std::vector<Vec3f> normals_;
+    std::vector<float> confidence_;
+    std::vector<uint32_t> colors_;
+    std::vector<int32_t> frame_ids_;
+
+    template <typename T>
+    void enable(bool& flag, std::vector<T>& channel, const T& value) {
+        if (flag) return;
+        flag = true;
+        channel.assign(size(), value);
+    }
+
+    template <typename T>
+    void set(bool& flag, std::vector<T>& channel, std::vector<T>&& values) {
+        if (values.size() != size()) return;
+        flag = true;
+        channel = std::move(values);
+    }
+
+    // Calls fn(vector) for the coordinate arrays and every enabled channel
+    template <typename Fn>
+    void forEachArray(Fn&& fn) {
+        fn(xs_); fn(ys_); fn(zs_);
+        if (has_normals_) fn(normals_);
+        if (has_confidence_) fn(confidence_);
+        if (has_colors_) fn(colors_);
+        if (has_frame_ids_) fn(frame_ids_);
+    }
+
+    // Same, pairing each array with its counterpart in other (which must
+    // have the same channel layout)
+    template <typename Fn>
+    void forEachArrayPair(const PointCloud& other, Fn&& fn) {
+        fn(xs_, other.xs_); fn(ys_, other.ys_); fn(zs_, other.zs_);
+        if (has_normals_) fn(normals_, other.normals_);
+        if (has_confidence_) fn(confidence_, other.confidence_);
+        if (has_colors_) fn(colors_, other.colors_);
+        if (has_frame_ids_) fn(frame_ids_, other.frame_ids_);
+    }
 };
 
 class TriangleMesh {
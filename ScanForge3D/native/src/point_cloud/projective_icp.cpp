@@ -0,0 +1,184 @@
+#include "projective_icp.h"
+#include "../util/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace scanforge {
+
+namespace {
+
+const float IDENTITY[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+} // namespace
+
+void ProjectiveICP::resizeModel(const DepthIntrinsics& intrinsics, int width, int height,
+                                const float* pose) {
+    const size_t pixels = static_cast<size_t>(std::max(0, width)) * std::max(0, height);
+    model_points_.resize(pixels);
+    model_normals_.resize(pixels);
+    model_intrinsics_ = intrinsics;
+    model_width_ = width;
+    model_height_ = height;
+    std::memcpy(model_pose_, pose ? pose : IDENTITY, sizeof(model_pose_));
+}
+
+size_t ProjectiveICP::renderModel(const SparseTSDFVolume& volume, const DepthIntrinsics& intrinsics,
+                                  int width, int height, const float* pose) {
+    resizeModel(intrinsics, width, height, pose);
+    if (model_points_.empty()) return 0;
+    return volume.raycast(intrinsics, width, height, model_pose_, model_points_.data(),
+                          model_normals_.data());
+}
+
+size_t ProjectiveICP::renderModel(const float* xyz, const float* normals, size_t count,
+                                  const DepthIntrinsics& intrinsics, int width, int height,
+                                  const float* pose) {
+    resizeModel(intrinsics, width, height, pose);
+    std::fill(model_normals_.begin(), model_normals_.end(), Vec3f(0, 0, 0));
+    model_depth_.assign(model_points_.size(), std::numeric_limits<float>::max());
+    if (model_points_.empty()) return 0;
+
+    const float* m = model_pose_;
+    const Vec3f eye(m[12], m[13], m[14]);
+
+    // Calls fn(pixel, depth) for the 2x2 pixels around the projection of
+    // each front-facing point with a normal, so surfaces sampled about
+    // as densely as the pixels leave no holes for farther ones to show
+    // through
+    auto splat = [&](auto&& fn) {
+        for (size_t i = 0; i < count; i++) {
+            Vec3f n(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]);
+            Vec3f d(xyz[i * 3] - eye.x, xyz[i * 3 + 1] - eye.y, xyz[i * 3 + 2] - eye.z);
+            if (n.dot(n) == 0.0f || n.dot(d) >= 0.0f) continue;
+
+            // World to camera: R^T (w - t); rows of R^T are the columns of R
+            float cx = m[0] * d.x + m[1] * d.y + m[2] * d.z;
+            float cy = m[4] * d.x + m[5] * d.y + m[6] * d.z;
+            float z = -(m[8] * d.x + m[9] * d.y + m[10] * d.z);
+            if (z <= 1e-6f) continue;
+            float fu = intrinsics.fx * cx / z + intrinsics.cx - 0.5f;
+            float fv = intrinsics.fy * cy / z + intrinsics.cy - 0.5f;
+            int u0 = static_cast<int>(std::floor(fu)), v0 = static_cast<int>(std::floor(fv));
+            for (int v = std::max(0, v0); v <= std::min(height - 1, v0 + 1); v++) {
+                for (int u = std::max(0, u0); u <= std::min(width - 1, u0 + 1); u++) {
+                    fn(i, static_cast<size_t>(v) * width + u, z);
+                }
+            }
+        }
+    };
+
+    // Nearest depth per pixel, then the mean of the points within
+    // SPLAT_DEPTH_BAND of it: taking the nearest point alone would pick
+    // the front of the noisy shell and bias the model toward the camera
+    splat([&](size_t, size_t p, float z) { model_depth_[p] = std::min(model_depth_[p], z); });
+    model_count_.assign(model_points_.size(), 0);
+    std::fill(model_points_.begin(), model_points_.end(), Vec3f(0, 0, 0));
+    splat([&](size_t i, size_t p, float z) {
+        if (z > model_depth_[p] + SPLAT_DEPTH_BAND) return;
+        model_points_[p] = model_points_[p] + Vec3f(xyz[i * 3], xyz[i * 3 + 1], xyz[i * 3 + 2]);
+        model_normals_[p] = model_normals_[p] +
+                            Vec3f(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]);
+        model_count_[p]++;
+    });
+
+    size_t filled = 0;
+    for (size_t p = 0; p < model_points_.size(); p++) {
+        if (model_count_[p] == 0) continue;
+        float len = model_normals_[p].length();
+        if (!(len > 1e-6f)) {
+            model_normals_[p] = Vec3f(0, 0, 0);
+            continue;
+        }
+        model_points_[p] = model_points_[p] * (1.0f / model_count_[p]);
+        model_normals_[p] = model_normals_[p] * (1.0f / len);
+        filled++;
+    }
+    return filled;
+}
+
+ICPResult ProjectiveICP::align(const DepthImage& frame, const float* initial_pose, int stride) {
+    const float* start = initial_pose ? initial_pose : IDENTITY;
+
+    ICPResult result;
+    std::copy(start, start + 16, result.transformation.begin());
+    result.fitness = 0;
+    result.rmse = std::numeric_limits<float>::max();
+    result.iterations = 0;
+
+    // Camera-space frame points
+    const size_t n = unprojection_.unproject(frame, nullptr, stride);
+    if (n < MIN_CORRESPONDENCES || model_points_.empty()) return result;
+    const float* xyz = unprojection_.points();
+
+    // Current estimate as row-major R and t
+    float R[9] = {start[0], start[4], start[8], start[1], start[5], start[9],
+                  start[2], start[6], start[10]};
+    Vec3f t(start[12], start[13], start[14]);
+
+    const float* ref = model_pose_;
+    const Vec3f ref_eye(ref[12], ref[13], ref[14]);
+    const DepthIntrinsics& in = model_intrinsics_;
+    const float max_distance_sq = max_distance_ * max_distance_;
+    const size_t min_chunk = 1024;
+    partial_.resize(parallelThreadCount(n, min_chunk));
+
+    for (int iter = 0; iter < max_iterations_; iter++) {
+        for (auto& eq : partial_) eq = NormalEquations6();
+
+        parallelFor(0, n, [&](size_t begin, size_t end, int chunk) {
+            NormalEquations6& eq = partial_[chunk];
+            for (size_t i = begin; i < end; i++) {
+                const float px = xyz[i * 3], py = xyz[i * 3 + 1], pz = xyz[i * 3 + 2];
+                Vec3f w(R[0] * px + R[1] * py + R[2] * pz + t.x,
+                        R[3] * px + R[4] * py + R[5] * pz + t.y,
+                        R[6] * px + R[7] * py + R[8] * pz + t.z);
+
+                // Into the reference camera, then to its pixel
+                Vec3f d = w - ref_eye;
+                float cx = ref[0] * d.x + ref[1] * d.y + ref[2] * d.z;
+                float cy = ref[4] * d.x + ref[5] * d.y + ref[6] * d.z;
+                float z = -(ref[8] * d.x + ref[9] * d.y + ref[10] * d.z);
+                if (z <= 1e-6f) continue;
+                float inv_z = 1.0f / z;
+                int u = static_cast<int>(std::lround(in.fx * cx * inv_z + in.cx));
+                int v = static_cast<int>(std::lround(in.fy * cy * inv_z + in.cy));
+                if (u < 0 || u >= model_width_ || v < 0 || v >= model_height_) continue;
+
+                size_t p = static_cast<size_t>(v) * model_width_ + u;
+                const Vec3f& normal = model_normals_[p];
+                if (normal.x == 0.0f && normal.y == 0.0f && normal.z == 0.0f) continue;
+                Vec3f diff = w - model_points_[p];
+                if (diff.dot(diff) > max_distance_sq) continue;
+                eq.addPointToPlane(w, normal, normal.dot(diff));
+            }
+        }, min_chunk);
+
+        NormalEquations6 total;
+        for (const auto& eq : partial_) total.merge(eq);
+        if (total.count < MIN_CORRESPONDENCES) break;
+
+        double x[6];
+        if (!total.solve(x)) break;
+        result.fitness = static_cast<float>(total.count) / static_cast<float>(n);
+        result.rmse = static_cast<float>(std::sqrt(total.residual_sq / total.count));
+        result.iterations = iter + 1;
+        applyTwist(x, R, t);
+
+        double rotation = std::sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+        double translation = std::sqrt(x[3] * x[3] + x[4] * x[4] + x[5] * x[5]);
+        if (rotation < tolerance_ && translation < tolerance_) break;
+    }
+
+    if (result.iterations > 0) {
+        auto& m = result.transformation;
+        m[0] = R[0]; m[1] = R[3]; m[2] = R[6]; m[3] = 0;
+        m[4] = R[1]; m[5] = R[4]; m[6] = R[7]; m[7] = 0;
+        m[8] = R[2]; m[9] = R[5]; m[10] = R[8]; m[11] = 0;
+        m[12] = t.x; m[13] = t.y; m[14] = t.z; m[15] = 1;
+    }
+    return result;
+}
+
+} // namespace scanforge
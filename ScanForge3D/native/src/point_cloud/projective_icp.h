@@ -0,0 +1,97 @@
+#pragma once
+#include "depth_image.h"
+#include "depth_unprojection.h"
+#include "icp_registration.h"
+#include "point_cloud.h"
+#include "../mesh/sparse_tsdf_volume.h"
+#include "../util/normal_equations6.h"
+#include <vector>
+
+namespace scanforge {
+
+/**
+ * Frame-to-model tracking with projective data association.
+ *
+ * The model (TSDF volume or accumulated points with normals) is first
+ * rendered into depth and normal maps of a reference camera, normally
+ * the predicted pose of the frame. Each frame point, moved by the
+ * current pose estimate, is projected into that camera and matched to
+ * the model point in its pixel, so finding correspondences is O(1) per
+ * point and needs no spatial index. Pairs farther apart than the
+ * correspondence distance are rejected. The point-to-plane normal
+ * equations are accumulated in parallel and solved with Cholesky; the
+ * pose is updated from the left until the step falls below tolerance.
+ *
+ * Buffers are kept between frames, so after the first frame of a given
+ * size tracking allocates nothing. The parallel passes here and in the
+ * volume's raycast and integrate run on the shared ThreadPool, so no
+ * threads are started per frame either.
+ */
+class ProjectiveICP {
+public:
+    explicit ProjectiveICP(int max_iterations = 10, float tolerance = 1e-4f)
+        : max_iterations_(max_iterations), tolerance_(tolerance) {}
+
+    // Frame depth outside [min_m, max_m] is ignored
+    void setDepthRange(float min_m, float max_m) { unprojection_.setDepthRange(min_m, max_m); }
+    // Frame pixels with lower confidence are ignored
+    void setMinConfidence(uint8_t min_confidence) { unprojection_.setMinConfidence(min_confidence); }
+    // Matched points farther apart than this (meters) are rejected
+    void setMaxCorrespondenceDistance(float max_m) { max_distance_ = max_m; }
+
+    /**
+     * Renders the model for the reference camera pose (column-major
+     * camera-to-world) by raycasting the volume. Returns the number of
+     * model pixels.
+     */
+    size_t renderModel(const SparseTSDFVolume& volume, const DepthIntrinsics& intrinsics,
+                       int width, int height, const float* pose);
+    /**
+     * The same from count world-space points with interleaved normals
+     * (e.g. a VoxelMap), splatted over 2x2 pixels each; a pixel gets the
+     * mean of the points near its nearest depth. Points without a
+     * normal or facing away are skipped.
+     */
+    size_t renderModel(const float* xyz, const float* normals, size_t count,
+                       const DepthIntrinsics& intrinsics, int width, int height,
+                       const float* pose);
+
+    /**
+     * Aligns the frame's points (pixels on a stride grid) to the
+     * rendered model, starting from initial_pose (column-major
+     * camera-to-world, usually the pose the model was rendered at).
+     * transformation is the refined camera-to-world pose, fitness the
+     * fraction of frame points with a correspondence and rmse the
+     * point-to-plane error of those, both from the last iteration. If
+     * no step could be solved the initial pose is returned with fitness 0.
+     */
+    ICPResult align(const DepthImage& frame, const float* initial_pose, int stride);
+
+private:
+    int max_iterations_;
+    float tolerance_;
+    float max_distance_ = 0.05f;
+
+    // Fewer correspondences than this do not constrain a pose reliably
+    static constexpr size_t MIN_CORRESPONDENCES = 64;
+    // Points this far (meters) behind a pixel's nearest splat are
+    // averaged into it
+    static constexpr float SPLAT_DEPTH_BAND = 0.006f;
+
+    // Model maps: world-space points and normals per pixel of the
+    // reference camera, (0, 0, 0) normal = empty
+    std::vector<Vec3f> model_points_;
+    std::vector<Vec3f> model_normals_;
+    std::vector<float> model_depth_;  // nearest depth while splatting
+    std::vector<uint32_t> model_count_;
+    DepthIntrinsics model_intrinsics_{0, 0, 0, 0};
+    int model_width_ = 0, model_height_ = 0;
+    float model_pose_[16];
+
+    DepthUnprojection unprojection_;
+    std::vector<NormalEquations6> partial_;
+
+    void resizeModel(const DepthIntrinsics& intrinsics, int width, int height, const float* pose);
+};
+
+} // namespace scanforge
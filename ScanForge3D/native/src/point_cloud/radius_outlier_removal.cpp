@@ -0,0 +1,23 @@
+#include "radius_outlier_removal.h"
+#include "../util/spatial_hash_grid.h"
+
+namespace scanforge {
+
+std::vector<uint8_t> RadiusOutlierRemoval::inlierMask(const PointCloud& input) const {
+    size_t n = input.size();
+    std::vector<uint8_t> keep(n, 1);
+    if (n == 0 || radius_ <= 0 || min_neighbors_ <= 0) return keep;
+
+    SpatialHashGrid grid(radius_);
+    grid.build(input);
+
+    // The count includes the point itself, hence min_neighbors + 1
+    int needed = min_neighbors_ + 1;
+    std::vector<int> counts = grid.countAllWithinRadius(radius_, needed);
+    for (size_t i = 0; i < n; i++) {
+        keep[i] = counts[i] >= needed ? 1 : 0;
+    }
+    return keep;
+}
+
+} // namespace scanforge
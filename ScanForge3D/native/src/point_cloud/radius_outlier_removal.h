@@ -0,0 +1,40 @@
+#pragma once
+#include "point_cloud.h"
+#include "../util/neighborhood_index.h"
+#include <vector>
+#include <cstdint>
+
+namespace scanforge {
+
+/**
+ * Radius outlier removal: drops points with fewer than min_neighbors
+ * other points within radius.
+ *
+ * Intended for voxel-filtered clouds, whose density is known and nearly
+ * uniform. Uses a SpatialHashGrid with cell size = radius, so build is
+ * O(n) and every query checks at most 27 cells and stops counting at
+ * min_neighbors.
+ */
+class RadiusOutlierRemoval {
+public:
+    RadiusOutlierRemoval(float radius, int min_neighbors)
+        : radius_(radius), min_neighbors_(min_neighbors) {}
+
+    PointCloud apply(const PointCloud& input) const {
+        return input.retained(inlierMask(input));
+    }
+
+    // Filter a shared index in place (its k-NN graph is compacted)
+    void apply(NeighborhoodIndex& index) const {
+        index.retain(inlierMask(index.cloud()));
+    }
+
+    // keep[i] = 1 if point i has at least min_neighbors within radius
+    std::vector<uint8_t> inlierMask(const PointCloud& input) const;
+
+private:
+    float radius_;
+    int min_neighbors_;
+};
+
+} // namespace scanforge
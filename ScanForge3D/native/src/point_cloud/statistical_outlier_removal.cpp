@@ -1 +1,77 @@
 #include "statistical_outlier_removal.h"
+#include "../util/parallel.h"
+
+namespace scanforge {
+
+namespace {
+
+// Running count / mean / sum of squared deviations (Welford)
+struct RunningStats {
+    double count = 0;
+    double mean = 0;
+    double m2 = 0;
+
+    void add(double x) {
+        count += 1;
+        double delta = x - mean;
+        mean += delta / count;
+        m2 += delta * (x - mean);
+    }
+
+    // Chan et al. pairwise combination
+    void merge(const RunningStats& o) {
+        if (o.count == 0) return;
+        double total = count + o.count;
+        double delta = o.mean - mean;
+        mean += delta * o.count / total;
+        m2 += o.m2 + delta * delta * count * o.count / total;
+        count = total;
+    }
+};
+
+} // namespace
+
+std::vector<uint8_t> StatisticalOutlierRemoval::inlierMask(const KNNGraph& graph) const {
+    size_t n = graph.size();
+    std::vector<uint8_t> keep(n, 1);
+    if (n == 0) return keep;
+
+    // Mean distance to the k nearest neighbors of each point, with
+    // per-thread statistics over its range
+    const size_t min_chunk = 16384;
+    std::vector<float> mean_distances(n);
+    std::vector<RunningStats> chunk_stats(parallelThreadCount(n, min_chunk));
+    parallelFor(0, n, [&](size_t begin, size_t end, int chunk) {
+        RunningStats stats;
+        for (size_t i = begin; i < end; i++) {
+            const int* neighbors = graph.neighbors(i);
+            const float* sq_dists = graph.distances(i);
+
+            float sum = 0;
+            int count = 0;
+            for (int j = 0; j < graph.k && count < k_neighbors_; j++) {
+                if (neighbors[j] == static_cast<int>(i)) continue;
+                sum += std::sqrt(sq_dists[j]);
+                count++;
+            }
+            mean_distances[i] = (count > 0) ? sum / count : 0;
+            stats.add(mean_distances[i]);
+        }
+        chunk_stats[chunk] = stats;
+    }, min_chunk);
+
+    // Global mean and (population) standard deviation
+    RunningStats global;
+    for (const RunningStats& s : chunk_stats) global.merge(s);
+    float std_dev = static_cast<float>(std::sqrt(global.m2 / global.count));
+    float threshold = static_cast<float>(global.mean) + std_ratio_ * std_dev;
+
+    parallelFor(0, n, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; i++) {
+            keep[i] = mean_distances[i] <= threshold ? 1 : 0;
+        }
+    }, min_chunk);
+    return keep;
+}
+
+} // namespace scanforge
@@ -1,71 +1,62 @@
 #pragma once
 #include "point_cloud.h"
 #include "../util/kdtree.h"
+#include "../util/neighborhood_index.h"
 #include <vector>
 #include <cmath>
+#include <cstdint>
 #include <algorithm>
 
 namespace scanforge {
 
+/**
+ * Statistical outlier removal: drops points whose mean distance to their
+ * k nearest neighbors exceeds the global mean by more than std_ratio
+ * standard deviations.
+ *
+ * Every phase is multi-threaded over disjoint index ranges: the batched
+ * k-NN, the per-point mean distances (with per-thread Welford statistics
+ * merged pairwise), the threshold mask and the compaction.
+ */
 class StatisticalOutlierRemoval {
 public:
     StatisticalOutlierRemoval(int k_neighbors, float std_ratio)
         : k_neighbors_(k_neighbors), std_ratio_(std_ratio) {}
 
     PointCloud apply(const PointCloud& input) const {
-        if (input.size() < static_cast<size_t>(k_neighbors_ + 1)) return input;
+        std::vector<uint8_t> keep;
+        return apply(input, keep);
+    }
 
-        size_t n = input.size();
-        std::vector<float> mean_distances(n);
+    // Same, and writes the survivor mask (keep[i] = 1 if input point i is
+    // in the result) so callers can filter their own per-point data
+    PointCloud apply(const PointCloud& input, std::vector<uint8_t>& keep) const {
+        if (input.size() < static_cast<size_t>(k_neighbors_ + 1)) {
+            keep.assign(input.size(), 1);
+            return input;
+        }
 
-        // Build KD-tree for O(n log n) k-NN queries
+        // Build KD-tree and answer all k-NN queries in one batched call.
+        // Each row includes the query point itself, so request k+1.
         KDTree tree;
         tree.build(input);
+        KNNGraph graph = tree.knnAll(k_neighbors_ + 1);
 
-        // Compute mean distance to k nearest neighbors for each point
-        for (size_t i = 0; i < n; i++) {
-            const Vec3f& p = input.getPoint(i);
-            // findKNearest returns k points including the query point itself
-            // so we request k+1 and skip the first (distance 0)
-            std::vector<int> neighbors = tree.findKNearest(p, k_neighbors_ + 1);
-
-            float sum = 0;
-            int count = 0;
-            for (int ni : neighbors) {
-                if (ni == static_cast<int>(i)) continue;
-                sum += p.distanceTo(input.getPoint(ni));
-                count++;
-                if (count >= k_neighbors_) break;
-            }
-            mean_distances[i] = (count > 0) ? sum / count : 0;
-        }
-
-        // Compute global mean and standard deviation
-        float global_mean = 0;
-        for (float d : mean_distances) global_mean += d;
-        global_mean /= n;
-
-        float variance = 0;
-        for (float d : mean_distances) {
-            float diff = d - global_mean;
-            variance += diff * diff;
-        }
-        variance /= n;
-        float std_dev = std::sqrt(variance);
-
-        float threshold = global_mean + std_ratio_ * std_dev;
-
-        // Filter points
-        PointCloud result;
-        for (size_t i = 0; i < n; i++) {
-            if (mean_distances[i] <= threshold) {
-                result.addPoint(input.getPoint(i));
-            }
-        }
+        // Filter points (attributes follow)
+        keep = inlierMask(graph);
+        return input.retained(keep);
+    }
 
-        return result;
+    // Filter a shared index in place, reusing its cached neighborhoods.
+    // The index should hold at least k+1 neighbors per point.
+    void apply(NeighborhoodIndex& index) const {
+        if (index.size() < static_cast<size_t>(k_neighbors_ + 1)) return;
+        index.retain(inlierMask(index.graph()));
     }
 
+    // keep[i] = 1 if point i passes the mean-distance threshold
+    std::vector<uint8_t> inlierMask(const KNNGraph& graph) const;
+
 private:
     int k_neighbors_;
     float std_ratio_;
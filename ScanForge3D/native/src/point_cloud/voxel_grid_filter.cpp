@@ -1,3 +1,258 @@
-// Implementation is header-only in voxel_grid_filter.h
-// This file exists for CMake glob compatibility
 #include "voxel_grid_filter.h"
+#include "../util/morton_order.h"
+#include "../util/parallel.h"
+#include "../util/radix_sort.h"
+
+namespace scanforge {
+
+static inline int fastFloor(float v) {
+    int i = static_cast<int>(v);
+    return i - (v < static_cast<float>(i) ? 1 : 0);
+}
+
+static inline int bitWidth(uint64_t v) {
+    int bits = 0;
+    while (v > 0) { bits++; v >>= 1; }
+    return bits;
+}
+
+// Calls fn(run_begin, run_end, chunk) for every run of equal key(i) in
+// sorted order, split across threads. A run belongs to the chunk it
+// starts in and is read past the chunk end, so the chunks of two calls
+// with the same n and min_chunk line up.
+template <typename KeyAt, typename Fn>
+static void parallelForRuns(size_t n, KeyAt&& key, Fn&& fn, size_t min_chunk) {
+    parallelFor(0, n, [&](size_t begin, size_t end, int chunk) {
+        size_t i = begin;
+        while (i < end && i > 0 && key(i) == key(i - 1)) i++;
+        while (i < end) {
+            uint64_t run_key = key(i);
+            size_t j = i + 1;
+            while (j < n && key(j) == run_key) j++;
+            fn(i, j, chunk);
+            i = j;
+        }
+    }, min_chunk);
+}
+
+// Reduces each run of equal keys in sorted order to one point. key(i)
+// and source(i) give the voxel key and input index of sorted item i;
+// weight(src) is the averaging weight of input point src.
+template <typename KeyAt, typename SourceAt, typename WeightOf>
+static PointCloud reduceRuns(const PointCloud& input, size_t n,
+                             KeyAt&& key, SourceAt&& source, WeightOf&& weight) {
+    const float* xs = input.xs();
+    const float* ys = input.ys();
+    const float* zs = input.zs();
+
+    // Pass 1: runs starting in each chunk
+    const size_t min_chunk = 16384;
+    int chunks = parallelThreadCount(n, min_chunk);
+    std::vector<size_t> chunk_offset(chunks + 1, 0);
+    parallelForRuns(n, key, [&](size_t, size_t, int chunk) {
+        chunk_offset[chunk + 1]++;
+    }, min_chunk);
+    for (int c = 0; c < chunks; c++) chunk_offset[c + 1] += chunk_offset[c];
+
+    PointCloud result = input.emptyCopy();
+    result.resize(chunk_offset[chunks]);
+    float* rx = result.xs();
+    float* ry = result.ys();
+    float* rz = result.zs();
+
+    // Pass 2: each chunk reduces the runs that start in it
+    std::vector<size_t> chunk_out(chunk_offset.begin(), chunk_offset.end() - 1);
+    parallelForRuns(n, key, [&](size_t i, size_t j, int chunk) {
+        size_t out = chunk_out[chunk]++;
+        float sx = 0, sy = 0, sz = 0, sw = 0;
+        Vec3f normal;
+        float confidence = 0;
+        float color[4] = {0, 0, 0, 0};
+        int32_t frame_id = 0;
+        for (size_t r = i; r < j; r++) {
+            size_t src = source(r);
+            float w = weight(src);
+            sx += w * xs[src]; sy += w * ys[src]; sz += w * zs[src];
+            sw += w;
+            if (input.hasNormals()) normal = normal + input.normals()[src] * w;
+            if (input.hasConfidence()) confidence += input.confidence()[src];
+            if (input.hasColors()) {
+                uint32_t c = input.colors()[src];
+                for (int ch = 0; ch < 4; ch++) color[ch] += w * ((c >> (8 * ch)) & 0xFF);
+            }
+            if (input.hasFrameIds()) {
+                frame_id = r == i ? input.frameIds()[src]
+                                  : std::max(frame_id, input.frameIds()[src]);
+            }
+        }
+
+        float inv_weight = 1.0f / sw;
+        rx[out] = sx * inv_weight;
+        ry[out] = sy * inv_weight;
+        rz[out] = sz * inv_weight;
+        if (result.hasNormals()) result.normals()[out] = normal.normalized();
+        if (result.hasConfidence()) {
+            result.confidence()[out] = confidence / static_cast<float>(j - i);
+        }
+        if (result.hasColors()) {
+            uint32_t c = 0;
+            for (int ch = 0; ch < 4; ch++) {
+                uint32_t v = static_cast<uint32_t>(color[ch] * inv_weight + 0.5f);
+                c |= std::min(v, 255u) << (8 * ch);
+            }
+            result.colors()[out] = c;
+        }
+        if (result.hasFrameIds()) result.frameIds()[out] = frame_id;
+    }, min_chunk);
+
+    return result;
+}
+
+// Merges flat cells for the density-adaptive mode. For level L the cell
+// of item i is key(i) >> 3L (Morton prefix), so its points are one run
+// in sorted order. A cell that spans several voxels and whose points lie
+// within max_deviation of a plane gets all its keys set to the cell's
+// first key, which keeps the order sorted and makes reduceRuns emit one
+// point for it. Levels go coarsest first; a merged cell is a single key
+// at every finer level and is skipped there.
+template <typename KeyAt, typename SetKey, typename SourceAt, typename WeightOf>
+static void mergeFlatCells(const PointCloud& input, size_t n, int levels,
+                           float max_deviation, int min_points,
+                           KeyAt&& key, SetKey&& set_key,
+                           SourceAt&& source, WeightOf&& weight) {
+    const float* xs = input.xs();
+    const float* ys = input.ys();
+    const float* zs = input.zs();
+    const double max_variance = static_cast<double>(max_deviation) * max_deviation;
+    const size_t min_chunk = 16384;
+
+    std::vector<std::vector<std::pair<size_t, size_t>>> merged(
+        parallelThreadCount(n, min_chunk));
+
+    for (int level = levels; level >= 1; level--) {
+        int shift = 3 * level;
+        auto cellKey = [&](size_t i) { return key(i) >> shift; };
+
+        parallelForRuns(n, cellKey, [&](size_t i, size_t j, int chunk) {
+            if (j - i < static_cast<size_t>(min_points) || key(i) == key(j - 1)) return;
+
+            // Weighted covariance about the first point (keeps the sums
+            // small), in double: flat cells are nearly singular
+            size_t first = source(i);
+            double sw = 0, m[3] = {0, 0, 0}, c[6] = {0, 0, 0, 0, 0, 0};
+            for (size_t r = i; r < j; r++) {
+                size_t src = source(r);
+                double w = weight(src);
+                double d[3] = {xs[src] - xs[first], ys[src] - ys[first], zs[src] - zs[first]};
+                sw += w;
+                m[0] += w * d[0]; m[1] += w * d[1]; m[2] += w * d[2];
+                c[0] += w * d[0] * d[0]; c[1] += w * d[0] * d[1]; c[2] += w * d[0] * d[2];
+                c[3] += w * d[1] * d[1]; c[4] += w * d[1] * d[2]; c[5] += w * d[2] * d[2];
+            }
+            for (int a = 0; a < 3; a++) m[a] /= sw;
+            double xx = c[0] / sw - m[0] * m[0], xy = c[1] / sw - m[0] * m[1];
+            double xz = c[2] / sw - m[0] * m[2], yy = c[3] / sw - m[1] * m[1];
+            double yz = c[4] / sw - m[1] * m[2], zz = c[5] / sw - m[2] * m[2];
+
+            // Smallest eigenvalue bound without an eigensolver: with
+            // l0 <= l1 <= l2, det / c2 = l0 l1 l2 / (l0 l1 + l0 l2 + l1 l2)
+            // lies in [l0 / 3, l0], so 3 det / c2 bounds l0 from above.
+            // Cells without two spread-out axes (c2 ~ 0) are left alone.
+            double c2 = xx * yy - xy * xy + xx * zz - xz * xz + yy * zz - yz * yz;
+            double det = xx * (yy * zz - yz * yz) - xy * (xy * zz - yz * xz)
+                       + xz * (xy * yz - yy * xz);
+            if (c2 <= 0 || 3.0 * det > max_variance * c2) return;
+            merged[chunk].push_back({i, j});
+        }, min_chunk);
+
+        // Applied after the pass so no thread reads a key being rewritten
+        parallelFor(0, merged.size(), [&](size_t begin, size_t end, int) {
+            for (size_t c = begin; c < end; c++) {
+                for (const auto& [i, j] : merged[c]) {
+                    uint64_t cell_first = key(i);
+                    for (size_t r = i + 1; r < j; r++) set_key(r, cell_first);
+                }
+                merged[c].clear();
+            }
+        }, 1);
+    }
+}
+
+PointCloud VoxelGridFilter::apply(const PointCloud& input) const {
+    size_t n = input.size();
+    if (n == 0 || voxel_size_ <= 0) return input;
+
+    const float* xs = input.xs();
+    const float* ys = input.ys();
+    const float* zs = input.zs();
+    float inv_size = 1.0f / voxel_size_;
+
+    // Voxel coordinates relative to the lowest voxel, up to 21 bits per
+    // axis; Morton interleaving gives keys that sort along the Z-curve
+    Vec3f min_b, max_b;
+    input.computeBounds(min_b, max_b);
+    const int cell_max = (1 << 21) - 1;
+    int ox = fastFloor(min_b.x * inv_size);
+    int oy = fastFloor(min_b.y * inv_size);
+    int oz = fastFloor(min_b.z * inv_size);
+    int span = std::max(fastFloor(max_b.x * inv_size) - ox,
+               std::max(fastFloor(max_b.y * inv_size) - oy,
+                        fastFloor(max_b.z * inv_size) - oz));
+    int key_bits = 3 * bitWidth(static_cast<uint64_t>(std::min(span, cell_max)));
+    int index_bits = bitWidth(n - 1);
+
+    auto voxelKey = [&](size_t i) {
+        int vx = std::min(std::max(fastFloor(xs[i] * inv_size) - ox, 0), cell_max);
+        int vy = std::min(std::max(fastFloor(ys[i] * inv_size) - oy, 0), cell_max);
+        int vz = std::min(std::max(fastFloor(zs[i] * inv_size) - oz, 0), cell_max);
+        return MortonOrder::encode(vx, vy, vz);
+    };
+
+    const float* confidence = input.hasConfidence() ? input.confidence().data() : nullptr;
+    bool weighted = confidence_weighting_ && confidence != nullptr;
+    auto weight = [&](size_t i) {
+        return weighted ? std::max(confidence[i], MIN_WEIGHT) : 1.0f;
+    };
+    int levels = std::min(adaptive_levels_, 20);
+
+    if (key_bits + index_bits <= 64) {
+        // Common case: key and point index packed into one word, sorted
+        // by the key bits only
+        std::vector<uint64_t> items(n);
+        parallelFor(0, n, [&](size_t begin, size_t end, int) {
+            for (size_t i = begin; i < end; i++) {
+                items[i] = (voxelKey(i) << index_bits) | i;
+            }
+        });
+        radixSortBits(items, index_bits, index_bits + key_bits);
+
+        const uint64_t index_mask = (uint64_t(1) << index_bits) - 1;
+        auto key = [&](size_t i) { return items[i] >> index_bits; };
+        auto source = [&](size_t i) { return static_cast<size_t>(items[i] & index_mask); };
+        if (levels > 0) {
+            mergeFlatCells(input, n, levels, max_plane_deviation_, MIN_ADAPTIVE_POINTS,
+                key, [&](size_t i, uint64_t k) {
+                    items[i] = (k << index_bits) | (items[i] & index_mask);
+                }, source, weight);
+        }
+        return reduceRuns(input, n, key, source, weight);
+    }
+
+    // Very large extents: separate key and permutation arrays
+    std::vector<uint64_t> keys(n);
+    parallelFor(0, n, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; i++) keys[i] = voxelKey(i);
+    });
+    std::vector<int> order;
+    MortonOrder::sortWithPermutation(keys, order);
+
+    auto key = [&](size_t i) { return keys[i]; };
+    auto source = [&](size_t i) { return static_cast<size_t>(order[i]); };
+    if (levels > 0) {
+        mergeFlatCells(input, n, levels, max_plane_deviation_, MIN_ADAPTIVE_POINTS,
+            key, [&](size_t i, uint64_t k) { keys[i] = k; }, source, weight);
+    }
+    return reduceRuns(input, n, key, source, weight);
+}
+
+} // namespace scanforge
@@ -1,65 +1,57 @@
 #pragma once
 #include "point_cloud.h"
-#include <unordered_map>
 
 namespace scanforge {
 
+/**
+ * Replaces all points in each voxel by their centroid.
+ *
+ * Sort-based: every point gets a 64-bit Morton key of its voxel
+ * coordinates, keys are radix-sorted, and each run of equal keys is
+ * reduced to one point, with runs split across threads. The output is
+ * deterministic and comes out in Z-curve order, so it is spatially
+ * coherent for later neighborhood passes.
+ *
+ * Attribute channels of the input are carried through per voxel:
+ * normals are summed and renormalized, confidence and color are
+ * averaged, and the frame id is the latest (largest) one.
+ */
 class VoxelGridFilter {
 public:
     explicit VoxelGridFilter(float voxel_size) : voxel_size_(voxel_size) {}
 
-    PointCloud apply(const PointCloud& input) const {
-        struct VoxelKey {
-            int x, y, z;
-            bool operator==(const VoxelKey& o) const {
-                return x == o.x && y == o.y && z == o.z;
-            }
-        };
-
-        struct VoxelKeyHash {
-            size_t operator()(const VoxelKey& k) const {
-                size_t h = 0;
-                h ^= std::hash<int>{}(k.x) + 0x9e3779b9 + (h << 6) + (h >> 2);
-                h ^= std::hash<int>{}(k.y) + 0x9e3779b9 + (h << 6) + (h >> 2);
-                h ^= std::hash<int>{}(k.z) + 0x9e3779b9 + (h << 6) + (h >> 2);
-                return h;
-            }
-        };
-
-        struct VoxelAccum {
-            float sx = 0, sy = 0, sz = 0;
-            int count = 0;
-        };
-
-        float inv_size = 1.0f / voxel_size_;
-        std::unordered_map<VoxelKey, VoxelAccum, VoxelKeyHash> voxels;
-
-        for (size_t i = 0; i < input.size(); i++) {
-            const auto& p = input.getPoint(i);
-            VoxelKey key {
-                static_cast<int>(std::floor(p.x * inv_size)),
-                static_cast<int>(std::floor(p.y * inv_size)),
-                static_cast<int>(std::floor(p.z * inv_size))
-            };
-            auto& acc = voxels[key];
-            acc.sx += p.x; acc.sy += p.y; acc.sz += p.z;
-            acc.count++;
-        }
-
-        PointCloud result;
-        result.reserve(voxels.size());
-        for (const auto& [key, acc] : voxels) {
-            result.addPoint({
-                acc.sx / acc.count,
-                acc.sy / acc.count,
-                acc.sz / acc.count
-            });
-        }
-        return result;
+    /**
+     * Weight every point by its confidence channel (if the input has
+     * one) when averaging positions, normals and colors, so low
+     * confidence depth samples pull the centroid less. The output
+     * confidence stays the plain mean.
+     */
+    void setConfidenceWeighting(bool enabled) { confidence_weighting_ = enabled; }
+
+    /**
+     * Density-adaptive cell size. Cells up to 2^levels voxels wide
+     * (aligned on the Morton grid) are tested coarsest first; a cell
+     * whose points all lie within max_plane_deviation (RMS) of a plane
+     * is reduced to a single point. Detailed regions keep the base voxel
+     * size. levels = 0 disables it.
+     */
+    void setAdaptive(int levels, float max_plane_deviation) {
+        adaptive_levels_ = levels;
+        max_plane_deviation_ = max_plane_deviation;
     }
 
+    PointCloud apply(const PointCloud& input) const;
+
 private:
     float voxel_size_;
+    bool confidence_weighting_ = false;
+    int adaptive_levels_ = 0;
+    float max_plane_deviation_ = 0.0f;
+
+    // Cells with fewer points are never merged
+    static constexpr int MIN_ADAPTIVE_POINTS = 8;
+    // Floor for confidence weights, so all-zero voxels still average
+    static constexpr float MIN_WEIGHT = 1e-3f;
 };
 
 } // namespace scanforge
@@ -0,0 +1,171 @@
+#include "voxel_map.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace scanforge {
+
+VoxelMap::VoxelMap(float voxel_size, size_t max_voxels)
+    : voxel_size_(voxel_size), inv_voxel_size_(1.0f / voxel_size),
+      max_voxels_(max_voxels) {
+    clear();
+}
+
+void VoxelMap::clear() {
+    table_keys_.assign(1024, EMPTY_KEY);
+    table_slots_.assign(1024, 0);
+    table_mask_ = 1023;
+    xs_.clear(); ys_.clear(); zs_.clear();
+    weights_.clear();
+    counts_.clear();
+    confidence_.clear();
+    frame_ids_.clear();
+    nxs_.clear(); nys_.clear(); nzs_.clear();
+    keys_.clear();
+    point_count_ = 0;
+    has_frame_ids_ = false;
+    has_normals_ = false;
+}
+
+void VoxelMap::grow() {
+    size_t new_size = table_keys_.size() * 2;
+    table_keys_.assign(new_size, EMPTY_KEY);
+    table_slots_.assign(new_size, 0);
+    table_mask_ = new_size - 1;
+
+    // Reinsert from the per-voxel keys; no duplicates, so no compares
+    for (size_t v = 0; v < keys_.size(); v++) {
+        size_t pos = hashKey(keys_[v]) & table_mask_;
+        while (table_keys_[pos] != EMPTY_KEY) pos = (pos + 1) & table_mask_;
+        table_keys_[pos] = keys_[v];
+        table_slots_[pos] = static_cast<uint32_t>(v);
+    }
+}
+
+inline void VoxelMap::addPoint(float x, float y, float z, float confidence,
+                               int32_t frame_id, const float* normal,
+                               size_t& created) {
+    if (!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(z)) return;
+
+    uint64_t key = packCell(static_cast<int>(std::floor(x * inv_voxel_size_)),
+                            static_cast<int>(std::floor(y * inv_voxel_size_)),
+                            static_cast<int>(std::floor(z * inv_voxel_size_)));
+    point_count_++;
+    float w = std::max(confidence, MIN_WEIGHT);
+    float nx = normal ? normal[0] * w : 0.0f;
+    float ny = normal ? normal[1] * w : 0.0f;
+    float nz = normal ? normal[2] * w : 0.0f;
+
+    size_t pos = hashKey(key) & table_mask_;
+    while (true) {
+        uint64_t k = table_keys_[pos];
+        if (k == key) {
+            // Weighted running mean: m += (p - m) * w / W
+            uint32_t v = table_slots_[pos];
+            weights_[v] += w;
+            float step = w / weights_[v];
+            xs_[v] += (x - xs_[v]) * step;
+            ys_[v] += (y - ys_[v]) * step;
+            zs_[v] += (z - zs_[v]) * step;
+            uint32_t n = ++counts_[v];
+            confidence_[v] += (confidence - confidence_[v]) / static_cast<float>(n);
+            frame_ids_[v] = std::max(frame_ids_[v], frame_id);
+            nxs_[v] += nx; nys_[v] += ny; nzs_[v] += nz;
+            return;
+        }
+        if (k == EMPTY_KEY) break;
+        pos = (pos + 1) & table_mask_;
+    }
+
+    if (max_voxels_ > 0 && keys_.size() >= max_voxels_) return;
+
+    uint32_t v = static_cast<uint32_t>(keys_.size());
+    table_keys_[pos] = key;
+    table_slots_[pos] = v;
+    keys_.push_back(key);
+    xs_.push_back(x); ys_.push_back(y); zs_.push_back(z);
+    weights_.push_back(w);
+    counts_.push_back(1);
+    confidence_.push_back(confidence);
+    frame_ids_.push_back(frame_id);
+    nxs_.push_back(nx); nys_.push_back(ny); nzs_.push_back(nz);
+    created++;
+
+    if (keys_.size() * 2 > table_keys_.size()) grow();
+}
+
+size_t VoxelMap::addPoints(const float* xyz, const float* confidence, size_t count,
+                           int32_t frame_id, const float* normals) {
+    if (frame_id >= 0) has_frame_ids_ = true;
+    if (normals) has_normals_ = true;
+    size_t created = 0;
+    for (size_t i = 0; i < count; i++) {
+        addPoint(xyz[3 * i], xyz[3 * i + 1], xyz[3 * i + 2],
+                 confidence ? confidence[i] : 1.0f, frame_id,
+                 normals ? normals + 3 * i : nullptr, created);
+    }
+    return created;
+}
+
+size_t VoxelMap::addPoints(const PointCloud& cloud) {
+    const float* xs = cloud.xs();
+    const float* ys = cloud.ys();
+    const float* zs = cloud.zs();
+    const float* confidence = cloud.hasConfidence() ? cloud.confidence().data() : nullptr;
+    const int32_t* frame_ids = cloud.hasFrameIds() ? cloud.frameIds().data() : nullptr;
+    const Vec3f* normals = cloud.hasNormals() ? cloud.normals().data() : nullptr;
+    if (frame_ids) has_frame_ids_ = true;
+    if (normals) has_normals_ = true;
+    size_t created = 0;
+    for (size_t i = 0; i < cloud.size(); i++) {
+        float normal[3] = {0, 0, 0};
+        if (normals) {
+            normal[0] = normals[i].x; normal[1] = normals[i].y; normal[2] = normals[i].z;
+        }
+        addPoint(xs[i], ys[i], zs[i], confidence ? confidence[i] : 1.0f,
+                 frame_ids ? frame_ids[i] : -1, normals ? normal : nullptr, created);
+    }
+    return created;
+}
+
+PointCloud VoxelMap::toPointCloud() const {
+    PointCloud cloud;
+    cloud.resize(size());
+    cloud.setConfidence(confidence_);
+    if (has_frame_ids_) cloud.setFrameIds(frame_ids_);
+    if (has_normals_) {
+        std::vector<Vec3f> normals(size());
+        for (size_t v = 0; v < size(); v++) normals[v] = normal(v);
+        cloud.setNormals(std::move(normals));
+    }
+    if (size() == 0) return cloud;
+    std::memcpy(cloud.xs(), xs_.data(), size() * sizeof(float));
+    std::memcpy(cloud.ys(), ys_.data(), size() * sizeof(float));
+    std::memcpy(cloud.zs(), zs_.data(), size() * sizeof(float));
+    return cloud;
+}
+
+void VoxelMap::copyPoints(float* xyz) const {
+    for (size_t v = 0; v < size(); v++) {
+        xyz[3 * v] = xs_[v];
+        xyz[3 * v + 1] = ys_[v];
+        xyz[3 * v + 2] = zs_[v];
+    }
+}
+
+void VoxelMap::copyNormals(float* xyz) const {
+    for (size_t v = 0; v < size(); v++) {
+        Vec3f n = normal(v);
+        xyz[3 * v] = n.x;
+        xyz[3 * v + 1] = n.y;
+        xyz[3 * v + 2] = n.z;
+    }
+}
+
+Vec3f VoxelMap::normal(size_t v) const {
+    Vec3f n(nxs_[v], nys_[v], nzs_[v]);
+    float len2 = n.dot(n);
+    return len2 > 1e-20f ? n * (1.0f / std::sqrt(len2)) : Vec3f(0, 0, 0);
+}
+
+} // namespace scanforge
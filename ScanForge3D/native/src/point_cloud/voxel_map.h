@@ -0,0 +1,120 @@
+#pragma once
+#include "point_cloud.h"
+#include <cstdint>
+#include <vector>
+
+namespace scanforge {
+
+/**
+ * Persistent voxel map for streaming accumulation during a scan.
+ *
+ * Each occupied voxel keeps the running mean of the points that fell
+ * into it and their count. Frames are merged in as they arrive, so the
+ * cost of a frame depends only on its own size: every point is one
+ * hash lookup plus a mean update, and the table grows by doubling
+ * (amortized O(1) per new voxel). The accumulated cloud is the voxel
+ * means as stored, with no reprocessing of earlier frames.
+ *
+ * With per-point confidence the means are weighted by it, so
+ * low-confidence depth samples pull a voxel less; each voxel also keeps
+ * the mean confidence of its points.
+ *
+ * Frames can be tagged with a frame id; each voxel keeps the latest one
+ * that touched it, matching VoxelGridFilter, so the capturing camera of
+ * every voxel is known for normal orientation. Per-point normals (e.g.
+ * from DepthNormalEstimation) are summed per voxel with the same
+ * confidence weights and renormalized on export.
+ *
+ * Voxels are keyed by their absolute grid cell, so results match
+ * VoxelGridFilter up to the grid origin. Voxels are stored in the order
+ * they were first seen.
+ *
+ * With max_voxels > 0 the map stops creating voxels once that many
+ * exist; points that land in existing voxels are still merged.
+ */
+class VoxelMap {
+public:
+    explicit VoxelMap(float voxel_size, size_t max_voxels = 0);
+
+    // Merges count interleaved xyz points with optional per-point
+    // confidence in [0, 1] (nullptr = all 1), all from frame frame_id
+    // (-1 = untagged), and optional interleaved normals ((0, 0, 0) =
+    // none); returns the number of new voxels
+    size_t addPoints(const float* xyz, const float* confidence, size_t count,
+                     int32_t frame_id = -1, const float* normals = nullptr);
+    // Uses the cloud's confidence, frame id and normal channels if it
+    // has them
+    size_t addPoints(const PointCloud& cloud);
+
+    // Voxel means as a cloud with a confidence channel (plus frame id
+    // and normal channels once such points were added) / as interleaved
+    // xyz (3 * size() floats)
+    PointCloud toPointCloud() const;
+    void copyPoints(float* xyz) const;
+    // Unit mean normal per voxel as interleaved xyz, (0, 0, 0) where no
+    // point had one
+    void copyNormals(float* xyz) const;
+    bool hasNormals() const { return has_normals_; }
+    // Mean confidence of the points in each voxel
+    const std::vector<float>& confidence() const { return confidence_; }
+    // Latest frame id per voxel, -1 where no tagged frame touched it
+    const std::vector<int32_t>& frameIds() const { return frame_ids_; }
+    bool hasFrameIds() const { return has_frame_ids_; }
+
+    size_t size() const { return xs_.size(); }
+    // Points merged so far, including those dropped at the voxel limit
+    size_t pointCount() const { return point_count_; }
+    const std::vector<uint32_t>& counts() const { return counts_; }
+    float voxelSize() const { return voxel_size_; }
+
+    void clear();
+
+private:
+    static constexpr uint64_t EMPTY_KEY = ~uint64_t(0);
+    // Floor for confidence weights, so all-zero voxels still average
+    static constexpr float MIN_WEIGHT = 1e-3f;
+
+    float voxel_size_;
+    float inv_voxel_size_;
+    size_t max_voxels_;
+    size_t point_count_ = 0;
+    bool has_frame_ids_ = false;
+    bool has_normals_ = false;
+
+    // Open addressing, linear probing, load factor <= 1/2
+    std::vector<uint64_t> table_keys_;
+    std::vector<uint32_t> table_slots_;
+    size_t table_mask_ = 0;
+
+    // Per-voxel running mean, weight, count, mean confidence, latest
+    // frame id and weighted normal sum, in insertion order
+    std::vector<float> xs_, ys_, zs_;
+    std::vector<float> weights_;
+    std::vector<uint32_t> counts_;
+    std::vector<float> confidence_;
+    std::vector<int32_t> frame_ids_;
+    std::vector<float> nxs_, nys_, nzs_;
+    std::vector<uint64_t> keys_;
+
+    void addPoint(float x, float y, float z, float confidence, int32_t frame_id,
+                  const float* normal, size_t& created);
+    Vec3f normal(size_t v) const;
+    void grow();
+
+    static uint64_t packCell(int cx, int cy, int cz) {
+        // 21 bits per axis: +-1M cells
+        const int bias = 1 << 20;
+        return (static_cast<uint64_t>((cx + bias) & 0x1FFFFF) << 42)
+             | (static_cast<uint64_t>((cy + bias) & 0x1FFFFF) << 21)
+             |  static_cast<uint64_t>((cz + bias) & 0x1FFFFF);
+    }
+
+    static uint64_t hashKey(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key;
+    }
+};
+
+} // namespace scanforge
@@ -0,0 +1,351 @@
+#include "incremental_kdtree.h"
+#include <algorithm>
+
+namespace scanforge {
+
+static inline float axisValue(const Vec3f& p, int axis) {
+    return (axis == 0) ? p.x : (axis == 1) ? p.y : p.z;
+}
+
+static inline float squaredDistance(const Vec3f& a, const Vec3f& b) {
+    float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+    return (dx * dx + dy * dy) + dz * dz;
+}
+
+// Squared distance from p to an axis-aligned box (0 inside)
+static inline float boxDistance(const Vec3f& p, const Vec3f& min_b, const Vec3f& max_b) {
+    float dx = std::max(0.0f, std::max(min_b.x - p.x, p.x - max_b.x));
+    float dy = std::max(0.0f, std::max(min_b.y - p.y, p.y - max_b.y));
+    float dz = std::max(0.0f, std::max(min_b.z - p.z, p.z - max_b.z));
+    return (dx * dx + dy * dy) + dz * dz;
+}
+
+static inline void expandBox(Vec3f& min_b, Vec3f& max_b, const Vec3f& p) {
+    min_b.x = std::min(min_b.x, p.x); max_b.x = std::max(max_b.x, p.x);
+    min_b.y = std::min(min_b.y, p.y); max_b.y = std::max(max_b.y, p.y);
+    min_b.z = std::min(min_b.z, p.z); max_b.z = std::max(max_b.z, p.z);
+}
+
+// Sorted insertion into a bounded candidate list (k is small)
+static inline void insertCandidate(float d, int id, int k,
+                                   float* dist, int* idx, int& count) {
+    if (count == k && d >= dist[k - 1]) return;
+    int pos = count < k ? count++ : k - 1;
+    while (pos > 0 && dist[pos - 1] > d) {
+        dist[pos] = dist[pos - 1];
+        idx[pos] = idx[pos - 1];
+        pos--;
+    }
+    dist[pos] = d;
+    idx[pos] = id;
+}
+
+void IncrementalKDTree::clear() {
+    nodes_.clear();
+    root_ = -1;
+    rebuild_count_ = 0;
+    rebuilt_points_ = 0;
+}
+
+int IncrementalKDTree::insert(const Vec3f& point) {
+    int id = static_cast<int>(nodes_.size());
+    nodes_.emplace_back();
+    nodes_[id].point = point;
+    nodes_[id].min_b = nodes_[id].max_b = point;
+    insertNode(id);
+    return id;
+}
+
+int IncrementalKDTree::insert(const std::vector<Vec3f>& points) {
+    int first = static_cast<int>(nodes_.size());
+    if (points.empty()) return first;
+
+    nodes_.resize(nodes_.size() + points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        Node& n = nodes_[first + i];
+        n.point = n.min_b = n.max_b = points[i];
+    }
+
+    if (root_ < 0) {
+        // First batch: build balanced in one go
+        scratch_.resize(points.size());
+        for (size_t i = 0; i < points.size(); i++) scratch_[i] = first + static_cast<int>(i);
+        root_ = buildBalanced(scratch_.data(), static_cast<int>(scratch_.size()), -1);
+        return first;
+    }
+
+    for (size_t i = 0; i < points.size(); i++) {
+        insertNode(first + static_cast<int>(i));
+    }
+    return first;
+}
+
+bool IncrementalKDTree::needsRebuild(int node) const {
+    const Node& n = nodes_[node];
+    if (n.size < MIN_REBUILD_SIZE) return false;
+    int left = n.left < 0 ? 0 : nodes_[n.left].size;
+    int right = n.right < 0 ? 0 : nodes_[n.right].size;
+    return std::max(left, right) > BALANCE_ALPHA * n.size ||
+           n.invalid > DELETE_ALPHA * n.size;
+}
+
+void IncrementalKDTree::insertNode(int id) {
+    Node& leaf = nodes_[id];
+    if (root_ < 0) {
+        root_ = id;
+        return;
+    }
+
+    // Walk down, growing every subtree on the path, and remember the
+    // topmost node that will be out of balance once the leaf is linked
+    int scapegoat = -1;
+    int node = root_;
+    while (true) {
+        Node& n = nodes_[node];
+        n.size++;
+        expandBox(n.min_b, n.max_b, leaf.point);
+        bool go_left = axisValue(leaf.point, n.axis) < axisValue(n.point, n.axis);
+        int child = go_left ? n.left : n.right;
+
+        if (scapegoat < 0 && n.size >= MIN_REBUILD_SIZE) {
+            int left = (n.left < 0 ? 0 : nodes_[n.left].size) + (go_left ? 1 : 0);
+            int right = (n.right < 0 ? 0 : nodes_[n.right].size) + (go_left ? 0 : 1);
+            if (std::max(left, right) > BALANCE_ALPHA * n.size ||
+                n.invalid > DELETE_ALPHA * n.size) {
+                scapegoat = node;
+            }
+        }
+
+        if (child < 0) {
+            if (go_left) n.left = id; else n.right = id;
+            leaf.parent = node;
+            leaf.axis = static_cast<uint8_t>((n.axis + 1) % 3);
+            break;
+        }
+        node = child;
+    }
+
+    if (scapegoat >= 0) rebuild(scapegoat);
+}
+
+void IncrementalKDTree::rebuild(int node) {
+    Node& old_root = nodes_[node];
+    int parent = old_root.parent;
+    int dropped = old_root.invalid;
+
+    // Collect the live points of the subtree; removed ones are dropped
+    scratch_.clear();
+    scratch_.reserve(old_root.size - old_root.invalid);
+    stack_.clear();
+    stack_.push_back(node);
+    while (!stack_.empty()) {
+        int cur = stack_.back();
+        stack_.pop_back();
+        Node& n = nodes_[cur];
+        if (n.left >= 0) stack_.push_back(n.left);
+        if (n.right >= 0) stack_.push_back(n.right);
+        if (n.removed) {
+            n.left = n.right = n.parent = -1;
+            n.size = 0;
+            n.invalid = 0;
+        } else {
+            scratch_.push_back(cur);
+        }
+    }
+
+    int new_root = buildBalanced(scratch_.data(), static_cast<int>(scratch_.size()), parent);
+    if (parent < 0) {
+        root_ = new_root;
+    } else {
+        Node& p = nodes_[parent];
+        if (p.left == node) p.left = new_root; else p.right = new_root;
+    }
+
+    // Ancestors no longer hold the dropped nodes
+    for (int a = parent; a >= 0 && dropped > 0; a = nodes_[a].parent) {
+        nodes_[a].size -= dropped;
+        nodes_[a].invalid -= dropped;
+    }
+
+    rebuild_count_++;
+    rebuilt_points_ += scratch_.size();
+}
+
+int IncrementalKDTree::buildBalanced(int* ids, int count, int parent) {
+    if (count <= 0) return -1;
+
+    // Split along the axis with the largest extent of this range
+    Vec3f min_b = nodes_[ids[0]].point, max_b = min_b;
+    for (int i = 1; i < count; i++) {
+        expandBox(min_b, max_b, nodes_[ids[i]].point);
+    }
+    Vec3f extent = max_b - min_b;
+    int axis = 0;
+    if (extent.y > extent.x) axis = 1;
+    if (extent.z > axisValue(extent, axis)) axis = 2;
+
+    int mid = count / 2;
+    std::nth_element(ids, ids + mid, ids + count, [this, axis](int a, int b) {
+        return axisValue(nodes_[a].point, axis) < axisValue(nodes_[b].point, axis);
+    });
+
+    int id = ids[mid];
+    Node& n = nodes_[id];
+    n.axis = static_cast<uint8_t>(axis);
+    n.parent = parent;
+    n.size = count;
+    n.invalid = 0;
+    n.min_b = min_b;
+    n.max_b = max_b;
+    n.left = buildBalanced(ids, mid, id);
+    n.right = buildBalanced(ids + mid + 1, count - mid - 1, id);
+    return id;
+}
+
+bool IncrementalKDTree::remove(int id) {
+    if (id < 0 || id >= static_cast<int>(nodes_.size()) || nodes_[id].removed) {
+        return false;
+    }
+    Node& n = nodes_[id];
+    n.removed = 1;
+
+    // Count the removal up to the root and rebuild the topmost subtree
+    // that is now mostly garbage
+    int scapegoat = -1;
+    for (int a = id; a >= 0; a = nodes_[a].parent) {
+        nodes_[a].invalid++;
+        if (needsRebuild(a)) scapegoat = a;
+    }
+    if (scapegoat >= 0) rebuild(scapegoat);
+    return true;
+}
+
+int IncrementalKDTree::removeBox(const Vec3f& min_bound, const Vec3f& max_bound) {
+    int removed = 0;
+    removeBoxNode(root_, min_bound, max_bound, removed);
+    if (removed > 0) rebuildInBox(root_, min_bound, max_bound);
+    return removed;
+}
+
+void IncrementalKDTree::removeBoxNode(int node, const Vec3f& min_bound,
+                                      const Vec3f& max_bound, int& removed) {
+    if (node < 0 || liveCount(node) == 0) return;
+    Node& n = nodes_[node];
+    if (n.max_b.x < min_bound.x || n.min_b.x > max_bound.x ||
+        n.max_b.y < min_bound.y || n.min_b.y > max_bound.y ||
+        n.max_b.z < min_bound.z || n.min_b.z > max_bound.z) {
+        return;
+    }
+    int before = removed;
+
+    const Vec3f& p = n.point;
+    if (!n.removed &&
+        p.x >= min_bound.x && p.x <= max_bound.x &&
+        p.y >= min_bound.y && p.y <= max_bound.y &&
+        p.z >= min_bound.z && p.z <= max_bound.z) {
+        n.removed = 1;
+        removed++;
+    }
+
+    // Left holds values <= split, right values >= split
+    float split = axisValue(p, n.axis);
+    if (axisValue(min_bound, n.axis) <= split) {
+        removeBoxNode(n.left, min_bound, max_bound, removed);
+    }
+    if (axisValue(max_bound, n.axis) >= split) {
+        removeBoxNode(n.right, min_bound, max_bound, removed);
+    }
+    nodes_[node].invalid += removed - before;
+}
+
+void IncrementalKDTree::rebuildInBox(int node, const Vec3f& min_bound,
+                                     const Vec3f& max_bound) {
+    if (node < 0) return;
+    if (needsRebuild(node)) {
+        rebuild(node);
+        return;
+    }
+    const Node& n = nodes_[node];
+    float split = axisValue(n.point, n.axis);
+    int left = n.left, right = n.right;
+    if (axisValue(min_bound, n.axis) <= split) rebuildInBox(left, min_bound, max_bound);
+    if (axisValue(max_bound, n.axis) >= split) rebuildInBox(right, min_bound, max_bound);
+}
+
+int IncrementalKDTree::findNearest(const Vec3f& query) const {
+    int idx = -1;
+    float dist = 0;
+    return findKNearest(query, 1, &idx, &dist) > 0 ? idx : -1;
+}
+
+int IncrementalKDTree::findKNearest(const Vec3f& query, int k,
+                                    int* indices, float* sq_distances) const {
+    if (root_ < 0 || k <= 0) return 0;
+    int count = 0;
+    searchKNearest(root_, query, k, sq_distances, indices, count);
+    return count;
+}
+
+std::vector<int> IncrementalKDTree::findKNearest(const Vec3f& query, int k) const {
+    k = std::min(k, static_cast<int>(size()));
+    if (k <= 0) return {};
+
+    std::vector<float> dist(k);
+    std::vector<int> result(k);
+    int count = findKNearest(query, k, result.data(), dist.data());
+    result.resize(count);
+    return result;
+}
+
+int IncrementalKDTree::radiusSearch(const Vec3f& query, float radius,
+                                    std::vector<int>& out) const {
+    if (root_ < 0 || radius <= 0) return 0;
+    size_t before = out.size();
+    searchRadius(root_, query, radius * radius, out);
+    return static_cast<int>(out.size() - before);
+}
+
+void IncrementalKDTree::searchKNearest(int node, const Vec3f& query, int k,
+                                       float* dist, int* idx, int& count) const {
+    if (node < 0 || liveCount(node) == 0) return;
+    const Node& n = nodes_[node];
+
+    if (!n.removed) {
+        insertCandidate(squaredDistance(n.point, query), node, k, dist, idx, count);
+    }
+
+    float diff = axisValue(query, n.axis) - axisValue(n.point, n.axis);
+    int near_node = diff < 0 ? n.left : n.right;
+    int far_node = diff < 0 ? n.right : n.left;
+
+    // Children are skipped when their bounding box is beyond the kth best
+    if (near_node >= 0 && (count < k || boxDistance(query, nodes_[near_node].min_b,
+                                                    nodes_[near_node].max_b) < dist[k - 1])) {
+        searchKNearest(near_node, query, k, dist, idx, count);
+    }
+    if (far_node >= 0 && (count < k || boxDistance(query, nodes_[far_node].min_b,
+                                                   nodes_[far_node].max_b) < dist[k - 1])) {
+        searchKNearest(far_node, query, k, dist, idx, count);
+    }
+}
+
+void IncrementalKDTree::searchRadius(int node, const Vec3f& query, float radius_sq,
+                                     std::vector<int>& out) const {
+    if (node < 0 || liveCount(node) == 0) return;
+    const Node& n = nodes_[node];
+
+    if (!n.removed && squaredDistance(n.point, query) <= radius_sq) {
+        out.push_back(node);
+    }
+
+    if (n.left >= 0 &&
+        boxDistance(query, nodes_[n.left].min_b, nodes_[n.left].max_b) <= radius_sq) {
+        searchRadius(n.left, query, radius_sq, out);
+    }
+    if (n.right >= 0 &&
+        boxDistance(query, nodes_[n.right].min_b, nodes_[n.right].max_b) <= radius_sq) {
+        searchRadius(n.right, query, radius_sq, out);
+    }
+}
+
+} // namespace scanforge
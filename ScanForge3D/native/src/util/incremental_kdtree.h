@@ -0,0 +1,100 @@
+#pragma once
+#include "../point_cloud/point_cloud.h"
+#include <cstdint>
+#include <vector>
+
+namespace scanforge {
+
+/**
+ * Dynamic KD-tree for maps that grow while scanning (ikd-tree style).
+ *
+ * Every point is one node; new points are appended as leaves, removed
+ * points are only flagged (lazy delete) and dropped at the next rebuild
+ * of their subtree. A subtree is rebuilt into a balanced one when it gets
+ * too lopsided (one child holds more than BALANCE_ALPHA of its points) or
+ * too many of its points are deleted (more than DELETE_ALPHA). Only the
+ * topmost offending subtree on the touched path is rebuilt, which keeps
+ * inserts at amortized O(log n).
+ *
+ * Point ids are assigned in insertion order and stay valid for the
+ * lifetime of the tree; rebuilds only relink nodes. Each node keeps the
+ * bounding box of its subtree, which searches use to skip subtrees that
+ * cannot hold a closer point.
+ */
+class IncrementalKDTree {
+public:
+    static constexpr float BALANCE_ALPHA = 0.7f;
+    static constexpr float DELETE_ALPHA = 0.5f;
+    // Subtrees smaller than this are never rebuilt for balance
+    static constexpr int MIN_REBUILD_SIZE = 16;
+
+    // Insert a batch; returns the id of the first inserted point, the
+    // rest follow consecutively. An empty tree is bulk-built balanced.
+    int insert(const std::vector<Vec3f>& points);
+    int insert(const Vec3f& point);
+
+    // Lazy deletes. remove() returns false for unknown or already removed
+    // ids; removeBox() returns the number of points removed.
+    bool remove(int id);
+    int removeBox(const Vec3f& min_bound, const Vec3f& max_bound);
+
+    int findNearest(const Vec3f& query) const;
+    // Writes up to k results (closest first), returns how many were found
+    int findKNearest(const Vec3f& query, int k,
+                     int* indices, float* sq_distances) const;
+    std::vector<int> findKNearest(const Vec3f& query, int k) const;
+    // Appends ids within radius of query (unordered), returns the count
+    int radiusSearch(const Vec3f& query, float radius, std::vector<int>& out) const;
+
+    const Vec3f& point(int id) const { return nodes_[id].point; }
+    bool isRemoved(int id) const { return nodes_[id].removed != 0; }
+
+    // Live (not removed) points
+    size_t size() const { return root_ < 0 ? 0 : nodes_[root_].size - nodes_[root_].invalid; }
+    // Ids handed out so far, including removed ones
+    size_t capacity() const { return nodes_.size(); }
+    size_t rebuildCount() const { return rebuild_count_; }
+    size_t rebuiltPoints() const { return rebuilt_points_; }
+
+    void clear();
+    void reserve(size_t n) { nodes_.reserve(n); }
+
+private:
+    struct Node {
+        Vec3f point;
+        Vec3f min_b, max_b;  // bounds of the subtree, stale-but-safe after removes
+        int left = -1, right = -1, parent = -1;
+        int size = 1;        // nodes in this subtree, removed ones included
+        int invalid = 0;     // removed nodes in this subtree
+        uint8_t axis = 0;
+        uint8_t removed = 0;
+    };
+
+    std::vector<Node> nodes_;
+    int root_ = -1;
+    size_t rebuild_count_ = 0;
+    size_t rebuilt_points_ = 0;
+
+    // Scratch for rebuilds, kept to avoid reallocating
+    std::vector<int> scratch_;
+    std::vector<int> stack_;
+
+    int liveCount(int node) const {
+        return node < 0 ? 0 : nodes_[node].size - nodes_[node].invalid;
+    }
+    bool needsRebuild(int node) const;
+
+    void insertNode(int id);
+    void rebuild(int node);
+    int buildBalanced(int* ids, int count, int parent);
+    void removeBoxNode(int node, const Vec3f& min_bound, const Vec3f& max_bound,
+                       int& removed);
+    void rebuildInBox(int node, const Vec3f& min_bound, const Vec3f& max_bound);
+
+    void searchKNearest(int node, const Vec3f& query, int k,
+                        float* dist, int* idx, int& count) const;
+    void searchRadius(int node, const Vec3f& query, float radius_sq,
+                      std::vector<int>& out) const;
+};
+
+} // namespace scanforge
@@ -1,143 +1,294 @@
 #include "kdtree.h"
+#include "parallel.h"
+#include "simd_distance.h"
 #include <limits>
-#include <queue>
 
 namespace scanforge {
 
-void KDTree::build(const PointCloud& cloud) {
-    cloud_ = &cloud;
-    nodes_.clear();
-
-    if (cloud.empty()) return;
+static inline float axisValue(const Vec3f& p, int axis) {
+    return (axis == 0) ? p.x : (axis == 1) ? p.y : p.z;
+}
 
-    std::vector<int> indices(cloud.size());
-    for (size_t i = 0; i < cloud.size(); i++) {
-        indices[i] = static_cast<int>(i);
+// Sorted insertion into a bounded candidate list (k is small)
+static inline void insertCandidate(float d, int id, int k,
+                                   float* dist, int* idx, int& count) {
+    if (count == k && d >= dist[k - 1]) return;
+    int pos = count < k ? count++ : k - 1;
+    while (pos > 0 && dist[pos - 1] > d) {
+        dist[pos] = dist[pos - 1];
+        idx[pos] = idx[pos - 1];
+        pos--;
     }
-
-    buildRecursive(indices, 0);
+    dist[pos] = d;
+    idx[pos] = id;
 }
 
-int KDTree::buildRecursive(std::vector<int>& indices, int depth) {
-    if (indices.empty()) return -1;
+void KDTree::build(const PointCloud& cloud) {
+    cloud_ = &cloud;
+    xs_.clear(); ys_.clear(); zs_.clear(); ids_.clear();
+    split_value_.clear();
+    split_axis_.clear();
 
-    int axis = depth % 3;
+    if (cloud.empty()) return;
 
-    // Sort by current axis
-    std::sort(indices.begin(), indices.end(),
-        [this, axis](int a, int b) {
-            const auto& pa = cloud_->getPoint(a);
-            const auto& pb = cloud_->getPoint(b);
-            float va = (axis == 0) ? pa.x : (axis == 1) ? pa.y : pa.z;
-            float vb = (axis == 0) ? pb.x : (axis == 1) ? pb.y : pb.z;
-            return va < vb;
-        });
+    int n = static_cast<int>(cloud.size());
+    std::vector<BuildItem> items(n);
+    for (int i = 0; i < n; i++) {
+        items[i].point = cloud.getPoint(i);
+        items[i].index = i;
+    }
 
-    int mid = static_cast<int>(indices.size()) / 2;
+    // Midpoint splits leave ranges of at most ceil(n / 2^d) at depth d;
+    // interior node ids stay below 2^depth of the first all-leaf level.
+    size_t node_count = 1;
+    for (size_t range = n; range > static_cast<size_t>(leaf_size_); range = (range + 1) / 2) {
+        node_count *= 2;
+    }
+    split_value_.assign(node_count, 0.0f);
+    split_axis_.assign(node_count, 0);
 
-    Node node;
-    node.point_index = indices[mid];
-    node.split_axis = axis;
+    buildNode(items, 1, 0, n);
 
-    int node_idx = static_cast<int>(nodes_.size());
-    nodes_.push_back(node);
+    xs_.resize(n); ys_.resize(n); zs_.resize(n); ids_.resize(n);
+    for (int i = 0; i < n; i++) {
+        xs_[i] = items[i].point.x;
+        ys_[i] = items[i].point.y;
+        zs_[i] = items[i].point.z;
+        ids_[i] = items[i].index;
+    }
+}
 
-    // Build left subtree
-    std::vector<int> left_indices(indices.begin(), indices.begin() + mid);
-    nodes_[node_idx].left = left_indices.empty() ? -1 : buildRecursive(left_indices, depth + 1);
+void KDTree::buildNode(std::vector<BuildItem>& items, int node, int lo, int hi) {
+    if (hi - lo <= leaf_size_) return;
 
-    // Build right subtree
-    std::vector<int> right_indices(indices.begin() + mid + 1, indices.end());
-    nodes_[node_idx].right = right_indices.empty() ? -1 : buildRecursive(right_indices, depth + 1);
+    // Split along the axis with the largest extent of this range
+    Vec3f min_b = items[lo].point, max_b = items[lo].point;
+    for (int i = lo + 1; i < hi; i++) {
+        const Vec3f& p = items[i].point;
+        min_b.x = std::min(min_b.x, p.x); max_b.x = std::max(max_b.x, p.x);
+        min_b.y = std::min(min_b.y, p.y); max_b.y = std::max(max_b.y, p.y);
+        min_b.z = std::min(min_b.z, p.z); max_b.z = std::max(max_b.z, p.z);
+    }
+    Vec3f extent = max_b - min_b;
+    int axis = 0;
+    if (extent.y > extent.x) axis = 1;
+    if (extent.z > axisValue(extent, axis)) axis = 2;
+
+    // Median selection: O(n) partition instead of a full sort
+    int mid = lo + (hi - lo) / 2;
+    std::nth_element(items.begin() + lo, items.begin() + mid, items.begin() + hi,
+        [axis](const BuildItem& a, const BuildItem& b) {
+            return axisValue(a.point, axis) < axisValue(b.point, axis);
+        });
+    split_axis_[node] = static_cast<uint8_t>(axis);
+    split_value_[node] = axisValue(items[mid].point, axis);
 
-    return node_idx;
+    buildNode(items, 2 * node, lo, mid);
+    buildNode(items, 2 * node + 1, mid, hi);
 }
 
 int KDTree::findNearest(const Vec3f& query) const {
-    if (nodes_.empty()) return -1;
+    if (ids_.empty()) return -1;
 
     int best_idx = -1;
-    float best_dist = std::numeric_limits<float>::max();
-    searchNearest(0, query, best_idx, best_dist);
+    float best_dist_sq = std::numeric_limits<float>::max();
+    searchNearest(1, 0, static_cast<int>(ids_.size()), query, best_idx, best_dist_sq);
     return best_idx;
 }
 
-void KDTree::searchNearest(int node_idx, const Vec3f& query,
-                           int& best_idx, float& best_dist) const {
-    if (node_idx < 0 || node_idx >= static_cast<int>(nodes_.size())) return;
-
-    const auto& node = nodes_[node_idx];
-    const auto& point = cloud_->getPoint(node.point_index);
+void KDTree::searchNearest(int node, int lo, int hi, const Vec3f& query,
+                           int& best_idx, float& best_dist_sq) const {
+    if (hi - lo <= leaf_size_) {
+        float dist[MAX_LEAF_SIZE];
+        int count = hi - lo;
+        squaredDistances(xs_.data() + lo, ys_.data() + lo, zs_.data() + lo,
+                         count, query.x, query.y, query.z, dist);
+        for (int i = 0; i < count; i++) {
+            if (dist[i] < best_dist_sq) {
+                best_dist_sq = dist[i];
+                best_idx = ids_[lo + i];
+            }
+        }
+        return;
+    }
 
-    float dist = query.distanceTo(point);
-    if (dist < best_dist) {
-        best_dist = dist;
-        best_idx = node.point_index;
+    int mid = lo + (hi - lo) / 2;
+    float diff = axisValue(query, split_axis_[node]) - split_value_[node];
+
+    if (diff < 0) {
+        searchNearest(2 * node, lo, mid, query, best_idx, best_dist_sq);
+        if (diff * diff < best_dist_sq) {
+            searchNearest(2 * node + 1, mid, hi, query, best_idx, best_dist_sq);
+        }
+    } else {
+        searchNearest(2 * node + 1, mid, hi, query, best_idx, best_dist_sq);
+        if (diff * diff < best_dist_sq) {
+            searchNearest(2 * node, lo, mid, query, best_idx, best_dist_sq);
+        }
     }
+}
 
-    int axis = node.split_axis;
-    float query_val = (axis == 0) ? query.x : (axis == 1) ? query.y : query.z;
-    float split_val = (axis == 0) ? point.x : (axis == 1) ? point.y : point.z;
-    float diff = query_val - split_val;
+int KDTree::findNearestApprox(const Vec3f& query, float epsilon,
+                              int max_leaf_visits) const {
+    if (ids_.empty()) return -1;
 
-    int near_child = diff < 0 ? node.left : node.right;
-    int far_child = diff < 0 ? node.right : node.left;
+    float scale = 1.0f / ((1.0f + std::max(0.0f, epsilon)) * (1.0f + std::max(0.0f, epsilon)));
+    int leaves_left = max_leaf_visits > 0 ? max_leaf_visits
+                                          : std::numeric_limits<int>::max();
+    int best_idx = -1;
+    float best_dist_sq = std::numeric_limits<float>::max();
+    searchNearestApprox(1, 0, static_cast<int>(ids_.size()), query, scale,
+                        leaves_left, best_idx, best_dist_sq);
+    return best_idx;
+}
 
-    searchNearest(near_child, query, best_idx, best_dist);
+void KDTree::searchNearestApprox(int node, int lo, int hi, const Vec3f& query,
+                                 float prune_scale, int& leaves_left,
+                                 int& best_idx, float& best_dist_sq) const {
+    if (hi - lo <= leaf_size_) {
+        leaves_left--;
+        float dist[MAX_LEAF_SIZE];
+        int count = hi - lo;
+        squaredDistances(xs_.data() + lo, ys_.data() + lo, zs_.data() + lo,
+                         count, query.x, query.y, query.z, dist);
+        for (int i = 0; i < count; i++) {
+            if (dist[i] < best_dist_sq) {
+                best_dist_sq = dist[i];
+                best_idx = ids_[lo + i];
+            }
+        }
+        return;
+    }
 
-    if (diff * diff < best_dist * best_dist) {
-        searchNearest(far_child, query, best_idx, best_dist);
+    int mid = lo + (hi - lo) / 2;
+    float diff = axisValue(query, split_axis_[node]) - split_value_[node];
+    int near_node = diff < 0 ? 2 * node : 2 * node + 1;
+    int far_node = diff < 0 ? 2 * node + 1 : 2 * node;
+    int near_lo = diff < 0 ? lo : mid;
+    int near_hi = diff < 0 ? mid : hi;
+    int far_lo = diff < 0 ? mid : lo;
+    int far_hi = diff < 0 ? hi : mid;
+
+    searchNearestApprox(near_node, near_lo, near_hi, query, prune_scale,
+                        leaves_left, best_idx, best_dist_sq);
+
+    // The far side can only improve on best by more than (1 + epsilon)
+    // if the plane is within best / (1 + epsilon)
+    if (leaves_left > 0 && diff * diff < best_dist_sq * prune_scale) {
+        searchNearestApprox(far_node, far_lo, far_hi, query, prune_scale,
+                            leaves_left, best_idx, best_dist_sq);
     }
 }
 
 std::vector<int> KDTree::findKNearest(const Vec3f& query, int k) const {
-    if (nodes_.empty() || k <= 0) return {};
+    if (ids_.empty() || k <= 0) return {};
+    k = std::min(k, static_cast<int>(ids_.size()));
+
+    std::vector<float> dist(k);
+    std::vector<int> result(k);
+    int count = 0;
+    searchKNearest(1, 0, static_cast<int>(ids_.size()), query, k,
+                   dist.data(), result.data(), count);
+    result.resize(count);
+    return result;
+}
 
-    // Max-heap: largest distance on top for efficient pruning
-    std::priority_queue<std::pair<float, int>> heap;
-    searchKNearest(0, query, k, heap);
+int KDTree::findKNearest(const Vec3f& query, int k,
+                         int* indices, float* sq_distances) const {
+    if (ids_.empty() || k <= 0) return 0;
+    k = std::min(k, static_cast<int>(ids_.size()));
 
-    std::vector<int> result;
-    result.reserve(heap.size());
-    while (!heap.empty()) {
-        result.push_back(heap.top().second);
-        heap.pop();
-    }
-    // Reverse to get closest first
-    std::reverse(result.begin(), result.end());
-    return result;
+    int count = 0;
+    searchKNearest(1, 0, static_cast<int>(ids_.size()), query, k,
+                   sq_distances, indices, count);
+    return count;
 }
 
-void KDTree::searchKNearest(int node_idx, const Vec3f& query, int k,
-                            std::priority_queue<std::pair<float, int>>& heap) const {
-    if (node_idx < 0 || node_idx >= static_cast<int>(nodes_.size())) return;
+int KDTree::radiusSearch(const Vec3f& query, float radius,
+                         std::vector<int>& out) const {
+    if (ids_.empty() || radius <= 0) return 0;
 
-    const auto& node = nodes_[node_idx];
-    const auto& point = cloud_->getPoint(node.point_index);
+    size_t before = out.size();
+    searchRadius(1, 0, static_cast<int>(ids_.size()), query, radius * radius, out);
+    return static_cast<int>(out.size() - before);
+}
 
-    float dist = query.distanceTo(point);
+void KDTree::searchRadius(int node, int lo, int hi, const Vec3f& query,
+                          float radius_sq, std::vector<int>& out) const {
+    if (hi - lo <= leaf_size_) {
+        float dist[MAX_LEAF_SIZE];
+        int n = hi - lo;
+        squaredDistances(xs_.data() + lo, ys_.data() + lo, zs_.data() + lo,
+                         n, query.x, query.y, query.z, dist);
+        for (int i = 0; i < n; i++) {
+            if (dist[i] <= radius_sq) out.push_back(ids_[lo + i]);
+        }
+        return;
+    }
 
-    if (static_cast<int>(heap.size()) < k) {
-        heap.push({dist, node.point_index});
-    } else if (dist < heap.top().first) {
-        heap.pop();
-        heap.push({dist, node.point_index});
+    int mid = lo + (hi - lo) / 2;
+    float diff = axisValue(query, split_axis_[node]) - split_value_[node];
+    // Left holds values <= split, right values >= split
+    if (diff <= 0 || diff * diff <= radius_sq) {
+        searchRadius(2 * node, lo, mid, query, radius_sq, out);
+    }
+    if (diff >= 0 || diff * diff <= radius_sq) {
+        searchRadius(2 * node + 1, mid, hi, query, radius_sq, out);
     }
+}
+
+KNNGraph KDTree::knnAll(int k) const {
+    KNNGraph graph;
+    if (ids_.empty() || k <= 0) return graph;
+
+    int n = static_cast<int>(ids_.size());
+    k = std::min(k, n);
+    graph.k = k;
+    graph.indices.resize(static_cast<size_t>(n) * k);
+    graph.sq_distances.resize(static_cast<size_t>(n) * k);
+
+    // Queries run in tree order so consecutive queries touch the same
+    // leaves; each result row goes to its point's slot in the graph.
+    parallelFor(0, n, [&](size_t begin, size_t end, int) {
+        for (size_t j = begin; j < end; j++) {
+            size_t row = static_cast<size_t>(ids_[j]) * k;
+            int count = 0;
+            searchKNearest(1, 0, n, Vec3f(xs_[j], ys_[j], zs_[j]), k,
+                           graph.sq_distances.data() + row,
+                           graph.indices.data() + row, count);
+        }
+    }, 1024);
+
+    return graph;
+}
 
-    int axis = node.split_axis;
-    float query_val = (axis == 0) ? query.x : (axis == 1) ? query.y : query.z;
-    float split_val = (axis == 0) ? point.x : (axis == 1) ? point.y : point.z;
-    float diff = query_val - split_val;
+void KDTree::searchKNearest(int node, int lo, int hi, const Vec3f& query, int k,
+                            float* dist, int* idx, int& count) const {
+    if (hi - lo <= leaf_size_) {
+        float leaf_dist[MAX_LEAF_SIZE];
+        int n = hi - lo;
+        squaredDistances(xs_.data() + lo, ys_.data() + lo, zs_.data() + lo,
+                         n, query.x, query.y, query.z, leaf_dist);
+        for (int i = 0; i < n; i++) {
+            insertCandidate(leaf_dist[i], ids_[lo + i], k, dist, idx, count);
+        }
+        return;
+    }
 
-    int near_child = diff < 0 ? node.left : node.right;
-    int far_child = diff < 0 ? node.right : node.left;
+    int mid = lo + (hi - lo) / 2;
+    float diff = axisValue(query, split_axis_[node]) - split_value_[node];
+    int near_node = diff < 0 ? 2 * node : 2 * node + 1;
+    int far_node = diff < 0 ? 2 * node + 1 : 2 * node;
+    int near_lo = diff < 0 ? lo : mid;
+    int near_hi = diff < 0 ? mid : hi;
+    int far_lo = diff < 0 ? mid : lo;
+    int far_hi = diff < 0 ? hi : mid;
 
-    searchKNearest(near_child, query, k, heap);
+    searchKNearest(near_node, near_lo, near_hi, query, k, dist, idx, count);
 
-    // Only visit far child if the splitting plane is closer than the kth best
-    float plane_dist = std::abs(diff);
-    if (static_cast<int>(heap.size()) < k || plane_dist < heap.top().first) {
-        searchKNearest(far_child, query, k, heap);
+    // Only visit far side if the splitting plane is closer than the kth best
+    if (count < k || diff * diff < dist[k - 1]) {
+        searchKNearest(far_node, far_lo, far_hi, query, k, dist, idx, count);
     }
 }
 
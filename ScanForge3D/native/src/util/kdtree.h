@@ -2,36 +2,98 @@
 #include "../point_cloud/point_cloud.h"
 #include <vector>
 #include <algorithm>
-#include <queue>
+#include <cstdint>
 
 namespace scanforge {
 
+// Flat k-NN graph over all points of a cloud. Row i holds the k nearest
+// neighbors of point i, closest first and including i itself, at
+// [i * k, (i + 1) * k) of indices / sq_distances.
+struct KNNGraph {
+    int k = 0;
+    std::vector<int> indices;
+    std::vector<float> sq_distances;
+
+    size_t size() const { return k > 0 ? indices.size() / k : 0; }
+    const int* neighbors(size_t i) const { return indices.data() + i * k; }
+    const float* distances(size_t i) const { return sq_distances.data() + i * k; }
+};
+
 // Simple KD-Tree for nearest-neighbor queries
 // For production, use nanoflann third_party library instead
+//
+// Points are copied into structure-of-arrays storage (x / y / z arrays)
+// in tree order, and each leaf is a contiguous bucket of up to
+// leaf_size points that is scanned with a SIMD distance kernel.
+// Interior nodes are pointer-free: node i covers some range [lo, hi),
+// splits it at mid = lo + (hi - lo) / 2 and has children 2i and 2i + 1.
+// The build partitions one array in place with median selection.
 class KDTree {
 public:
-    struct Node {
-        int point_index;
-        int left = -1;
-        int right = -1;
-        int split_axis;
-    };
+    static constexpr int DEFAULT_LEAF_SIZE = 24;
+    static constexpr int MAX_LEAF_SIZE = 64;
+
+    // leaf_size = 1 gives a classic one-point-per-leaf tree
+    explicit KDTree(int leaf_size = DEFAULT_LEAF_SIZE)
+        : leaf_size_(std::max(1, std::min(leaf_size, MAX_LEAF_SIZE))) {}
 
     void build(const PointCloud& cloud);
     int findNearest(const Vec3f& query) const;
+
+    // Approximate nearest neighbor: the result is at most (1 + epsilon)
+    // times farther than the true nearest. max_leaf_visits > 0 caps the
+    // number of leaf buckets scanned, trading the bound for a fixed cost.
+    // epsilon = 0 and no budget is an exact search.
+    int findNearestApprox(const Vec3f& query, float epsilon,
+                          int max_leaf_visits = 0) const;
     std::vector<int> findKNearest(const Vec3f& query, int k) const;
 
+    // Allocation-free variant: writes up to k results (closest first) into
+    // the caller's buffers and returns how many were found.
+    int findKNearest(const Vec3f& query, int k,
+                     int* indices, float* sq_distances) const;
+
+    // Appends indices of all points within radius of query (unordered)
+    // to out and returns how many were added.
+    int radiusSearch(const Vec3f& query, float radius, std::vector<int>& out) const;
+
+    // k-NN for every point of the indexed cloud in one call, multi-threaded.
+    // k is clamped to the cloud size.
+    KNNGraph knnAll(int k) const;
+
     const PointCloud* getCloud() const { return cloud_; }
+    size_t size() const { return ids_.size(); }
+    int leafSize() const { return leaf_size_; }
 
 private:
-    std::vector<Node> nodes_;
+    int leaf_size_;
     const PointCloud* cloud_ = nullptr;
 
-    int buildRecursive(std::vector<int>& indices, int depth);
-    void searchNearest(int node_idx, const Vec3f& query,
-                       int& best_idx, float& best_dist) const;
-    void searchKNearest(int node_idx, const Vec3f& query, int k,
-                        std::priority_queue<std::pair<float, int>>& heap) const;
+    // Point data in tree order (SoA), ids_ maps back to the source cloud
+    std::vector<float> xs_, ys_, zs_;
+    std::vector<int> ids_;
+
+    // Interior nodes, indexed from 1 (heap order)
+    std::vector<float> split_value_;
+    std::vector<uint8_t> split_axis_;
+
+    struct BuildItem {
+        Vec3f point;
+        int index;
+    };
+
+    void buildNode(std::vector<BuildItem>& items, int node, int lo, int hi);
+    void searchNearest(int node, int lo, int hi, const Vec3f& query,
+                       int& best_idx, float& best_dist_sq) const;
+    // prune_scale = 1 / (1 + epsilon)^2 shrinks the far-side test
+    void searchNearestApprox(int node, int lo, int hi, const Vec3f& query,
+                             float prune_scale, int& leaves_left,
+                             int& best_idx, float& best_dist_sq) const;
+    // Keeps the best k candidates sorted ascending in dist / idx
+    void searchKNearest(int node, int lo, int hi, const Vec3f& query, int k,
+                        float* dist, int* idx, int& count) const;
+    void searchRadius(int node, int lo, int hi, const Vec3f& query,
+                      float radius_sq, std::vector<int>& out) const;
 };
 
 } // namespace scanforge
@@ -15,6 +15,31 @@ inline Mat4f identity4x4() {
     return m;
 }
 
+// a * b, both column-major
+inline Mat4f multiply4x4(const float* a, const float* b) {
+    Mat4f m = {};
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            m[c * 4 + r] = a[r] * b[c * 4] + a[4 + r] * b[c * 4 + 1] +
+                           a[8 + r] * b[c * 4 + 2] + a[12 + r] * b[c * 4 + 3];
+        }
+    }
+    return m;
+}
+
+// Inverse of a rotation + translation matrix: [R^T, -R^T t]
+inline Mat4f rigidInverse4x4(const float* m) {
+    Mat4f inv = {};
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) inv[c * 4 + r] = m[r * 4 + c];
+    }
+    for (int r = 0; r < 3; r++) {
+        inv[12 + r] = -(inv[r] * m[12] + inv[4 + r] * m[13] + inv[8 + r] * m[14]);
+    }
+    inv[15] = 1.0f;
+    return inv;
+}
+
 inline float clamp(float v, float lo, float hi) {
     return std::max(lo, std::min(hi, v));
 }
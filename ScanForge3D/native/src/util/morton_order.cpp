@@ -0,0 +1,141 @@
+#include "morton_order.h"
+#include <algorithm>
+
+namespace scanforge {
+
+void MortonOrder::quantizationScale(const Vec3f& min_bound, const Vec3f& max_bound,
+                                    float& scale, float& grid_max) {
+    // One uniform scale keeps the curve isotropic
+    Vec3f extent = max_bound - min_bound;
+    float max_extent = std::max(extent.x, std::max(extent.y, extent.z));
+    grid_max = static_cast<float>((1u << 21) - 1);
+    scale = max_extent > 0 ? grid_max / max_extent : 0.0f;
+}
+
+static inline uint32_t quantize(float v, float origin, float scale, float grid_max) {
+    return static_cast<uint32_t>(std::min(std::max((v - origin) * scale, 0.0f), grid_max));
+}
+
+std::vector<uint64_t> MortonOrder::computeCodes(const std::vector<Vec3f>& points,
+                                                const Vec3f& min_bound,
+                                                const Vec3f& max_bound) {
+    float scale, grid_max;
+    quantizationScale(min_bound, max_bound, scale, grid_max);
+
+    std::vector<uint64_t> codes(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        const Vec3f& p = points[i];
+        codes[i] = encode(quantize(p.x, min_bound.x, scale, grid_max),
+                          quantize(p.y, min_bound.y, scale, grid_max),
+                          quantize(p.z, min_bound.z, scale, grid_max));
+    }
+    return codes;
+}
+
+std::vector<uint64_t> MortonOrder::computeCodes(const PointCloud& cloud,
+                                                const Vec3f& min_bound,
+                                                const Vec3f& max_bound) {
+    float scale, grid_max;
+    quantizationScale(min_bound, max_bound, scale, grid_max);
+
+    const float* xs = cloud.xs();
+    const float* ys = cloud.ys();
+    const float* zs = cloud.zs();
+    std::vector<uint64_t> codes(cloud.size());
+    for (size_t i = 0; i < codes.size(); i++) {
+        codes[i] = encode(quantize(xs[i], min_bound.x, scale, grid_max),
+                          quantize(ys[i], min_bound.y, scale, grid_max),
+                          quantize(zs[i], min_bound.z, scale, grid_max));
+    }
+    return codes;
+}
+
+std::vector<int> MortonOrder::sortPermutation(const std::vector<uint64_t>& keys) {
+    std::vector<uint64_t> sorted(keys);
+    std::vector<int> order;
+    sortWithPermutation(sorted, order);
+    return order;
+}
+
+void MortonOrder::sortWithPermutation(std::vector<uint64_t>& keys, std::vector<int>& order) {
+    size_t n = keys.size();
+    order.resize(n);
+    for (size_t i = 0; i < n; i++) order[i] = static_cast<int>(i);
+    if (n < 2) return;
+
+    // All 8 byte histograms in one pass over the keys
+    std::vector<uint32_t> histograms(8 * 256, 0);
+    for (uint64_t key : keys) {
+        for (int b = 0; b < 8; b++) {
+            histograms[b * 256 + ((key >> (8 * b)) & 0xFF)]++;
+        }
+    }
+
+    std::vector<uint64_t> key_tmp(n);
+    std::vector<int> order_tmp(n);
+    for (int b = 0; b < 8; b++) {
+        uint32_t* hist = histograms.data() + b * 256;
+        // Skip bytes that are equal in every key
+        if (hist[(keys[0] >> (8 * b)) & 0xFF] == n) continue;
+
+        uint32_t offset = 0;
+        for (int d = 0; d < 256; d++) {
+            uint32_t count = hist[d];
+            hist[d] = offset;
+            offset += count;
+        }
+        for (size_t i = 0; i < n; i++) {
+            uint32_t slot = hist[(keys[i] >> (8 * b)) & 0xFF]++;
+            key_tmp[slot] = keys[i];
+            order_tmp[slot] = order[i];
+        }
+        keys.swap(key_tmp);
+        order.swap(order_tmp);
+    }
+}
+
+std::vector<int> MortonOrder::sortPoints(PointCloud& cloud) {
+    if (cloud.size() < 2) return std::vector<int>(cloud.size(), 0);
+
+    Vec3f min_b, max_b;
+    cloud.computeBounds(min_b, max_b);
+    std::vector<int> order = sortPermutation(computeCodes(cloud, min_b, max_b));
+    cloud.permute(order);
+    return order;
+}
+
+std::vector<int> MortonOrder::sortMesh(TriangleMesh& mesh) {
+    std::vector<Vec3f>& vertices = mesh.vertices();
+    if (vertices.empty()) return {};
+
+    Vec3f min_b = vertices[0], max_b = vertices[0];
+    for (const Vec3f& v : vertices) {
+        min_b.x = std::min(min_b.x, v.x); max_b.x = std::max(max_b.x, v.x);
+        min_b.y = std::min(min_b.y, v.y); max_b.y = std::max(max_b.y, v.y);
+        min_b.z = std::min(min_b.z, v.z); max_b.z = std::max(max_b.z, v.z);
+    }
+    std::vector<int> order = sortPermutation(computeCodes(vertices, min_b, max_b));
+    applyPermutation(order, vertices);
+
+    std::vector<int> new_index(order.size());
+    for (size_t i = 0; i < order.size(); i++) new_index[order[i]] = static_cast<int>(i);
+
+    // Remap, then counting-sort triangles by their lowest vertex so faces
+    // are visited in the same sweep as their vertices
+    std::vector<Triangle>& triangles = mesh.triangles();
+    std::vector<uint32_t> start(vertices.size() + 1, 0);
+    for (Triangle& t : triangles) {
+        t = Triangle(new_index[t.a], new_index[t.b], new_index[t.c]);
+        start[std::min(t.a, std::min(t.b, t.c)) + 1]++;
+    }
+    for (size_t v = 0; v < vertices.size(); v++) start[v + 1] += start[v];
+
+    std::vector<Triangle> sorted(triangles.size());
+    for (const Triangle& t : triangles) {
+        sorted[start[std::min(t.a, std::min(t.b, t.c))]++] = t;
+    }
+    triangles = std::move(sorted);
+    return order;
+}
+
+} // namespace scanforge
@@ -0,0 +1,82 @@
+#pragma once
+#include "../point_cloud/point_cloud.h"
+#include <cstdint>
+#include <vector>
+
+namespace scanforge {
+
+// Bit b of an 11-bit index moved to bit 3b, for Morton interleaving
+struct MortonSpreadTable {
+    uint64_t bits[2048];
+    constexpr MortonSpreadTable() : bits() {
+        for (uint32_t i = 0; i < 2048; i++) {
+            for (int b = 0; b < 11; b++) {
+                bits[i] |= static_cast<uint64_t>((i >> b) & 1) << (3 * b);
+            }
+        }
+    }
+};
+inline constexpr MortonSpreadTable MORTON_SPREAD{};
+
+/**
+ * Spatial reordering along a Z-order (Morton) curve.
+ *
+ * Points are quantized to a 2^21 grid over the cloud's bounding box and
+ * interleaved into 63-bit Morton codes, which an LSD radix sort orders in
+ * O(n). Points that are close in space end up close in memory, so passes
+ * over neighborhoods (KD-tree builds, k-NN, smoothing) stay in cache.
+ *
+ * Permutations are returned as order[new_index] = old_index so other
+ * per-point arrays can follow with applyPermutation().
+ */
+class MortonOrder {
+public:
+    // Interleave the low 21 bits of x, y and z (x in bit 0)
+    static uint64_t encode(uint32_t x, uint32_t y, uint32_t z) {
+        return spread(x) | (spread(y) << 1) | (spread(z) << 2);
+    }
+
+    // Morton code of every point, quantized over the given bounds
+    static std::vector<uint64_t> computeCodes(const std::vector<Vec3f>& points,
+                                              const Vec3f& min_bound,
+                                              const Vec3f& max_bound);
+    static std::vector<uint64_t> computeCodes(const PointCloud& cloud,
+                                              const Vec3f& min_bound,
+                                              const Vec3f& max_bound);
+
+    // Stable LSD radix sort of keys; returns order[new] = old. Byte
+    // positions where all keys agree are skipped.
+    static std::vector<int> sortPermutation(const std::vector<uint64_t>& keys);
+
+    // Same, but sorts keys in place and writes the permutation to order
+    static void sortWithPermutation(std::vector<uint64_t>& keys, std::vector<int>& order);
+
+    // Reorders cloud in place (attribute channels follow), returns
+    // order[new] = old
+    static std::vector<int> sortPoints(PointCloud& cloud);
+
+    // Reorders mesh vertices along the curve and remaps the triangles,
+    // which are then sorted by their lowest vertex index. Returns the
+    // vertex order (order[new] = old).
+    static std::vector<int> sortMesh(TriangleMesh& mesh);
+
+    template <typename T>
+    static void applyPermutation(const std::vector<int>& order, std::vector<T>& values) {
+        if (values.size() != order.size()) return;
+        std::vector<T> sorted;
+        sorted.reserve(values.size());
+        for (int old_index : order) sorted.push_back(std::move(values[old_index]));
+        values = std::move(sorted);
+    }
+
+private:
+    static void quantizationScale(const Vec3f& min_bound, const Vec3f& max_bound,
+                                  float& scale, float& grid_max);
+
+    static uint64_t spread(uint32_t v) {
+        return MORTON_SPREAD.bits[v & 0x7FF] |
+               (MORTON_SPREAD.bits[(v >> 11) & 0x3FF] << 33);
+    }
+};
+
+} // namespace scanforge
@@ -0,0 +1,69 @@
+#include "neighborhood_index.h"
+#include "morton_order.h"
+#include "parallel.h"
+
+namespace scanforge {
+
+NeighborhoodIndex::NeighborhoodIndex(PointCloud cloud, int k)
+    : cloud_(std::move(cloud)) {
+    MortonOrder::sortPoints(cloud_);
+    tree_.build(cloud_);
+    graph_ = tree_.knnAll(k);
+}
+
+void NeighborhoodIndex::retain(const std::vector<uint8_t>& keep) {
+    size_t n = cloud_.size();
+    if (keep.size() != n) return;
+
+    // New index of every surviving point, from per-chunk offsets
+    std::vector<size_t> offset = parallelCompactOffsets(keep);
+    int kept = static_cast<int>(offset.back());
+    if (kept == static_cast<int>(n)) return;
+    std::vector<int> remap(n);
+    parallelFor(0, n, [&](size_t begin, size_t end, int chunk) {
+        int next = static_cast<int>(offset[chunk]);
+        for (size_t i = begin; i < end; i++) remap[i] = keep[i] ? next++ : -1;
+    });
+
+    cloud_.retain(keep);
+    tree_.build(cloud_);
+
+    int k = std::min(graph_.k, kept);
+    KNNGraph filtered;
+    filtered.k = k;
+    filtered.indices.resize(static_cast<size_t>(kept) * k);
+    filtered.sq_distances.resize(static_cast<size_t>(kept) * k);
+    if (k == 0) {
+        graph_ = std::move(filtered);
+        return;
+    }
+
+    // Compact surviving rows; a row whose neighbors all survived keeps its
+    // first k entries unchanged. Removed points are mostly isolated
+    // outliers, so only a small fraction of rows needs a new query.
+    parallelFor(0, n, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; i++) {
+            if (remap[i] < 0) continue;
+            const int* old_idx = graph_.neighbors(i);
+            const float* old_dist = graph_.distances(i);
+            int* row_idx = filtered.indices.data() + static_cast<size_t>(remap[i]) * k;
+            float* row_dist = filtered.sq_distances.data() + static_cast<size_t>(remap[i]) * k;
+
+            int count = 0;
+            for (int j = 0; j < graph_.k && count < k; j++) {
+                int ni = remap[old_idx[j]];
+                if (ni < 0) break;
+                row_idx[count] = ni;
+                row_dist[count] = old_dist[j];
+                count++;
+            }
+            if (count < k) {
+                tree_.findKNearest(cloud_.getPoint(remap[i]), k, row_idx, row_dist);
+            }
+        }
+    }, 1024);
+
+    graph_ = std::move(filtered);
+}
+
+} // namespace scanforge
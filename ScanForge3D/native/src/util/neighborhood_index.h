@@ -0,0 +1,57 @@
+#pragma once
+#include "../point_cloud/point_cloud.h"
+#include "kdtree.h"
+#include <cstdint>
+#include <vector>
+
+namespace scanforge {
+
+/**
+ * Shared spatial index for the post-scan pipeline.
+ *
+ * Owns the working point cloud, one KD-tree over it and a cached k-NN
+ * graph, so outlier removal, normal estimation/orientation and surface
+ * reconstruction all reuse the same neighborhoods instead of building
+ * their own trees.
+ *
+ * The cloud is put in Morton order on construction so graph rows and
+ * the points they reference are close in memory; point order of the
+ * input is therefore not preserved.
+ *
+ * Stages that remove points call retain(); the graph is compacted in
+ * place and only rows that lost a neighbor are queried again.
+ */
+class NeighborhoodIndex {
+public:
+    // k = neighbors per point including the point itself; consumers may
+    // use any prefix of a row since rows are sorted closest first.
+    NeighborhoodIndex(PointCloud cloud, int k);
+
+    // The KD-tree points into cloud_, so the index must stay in place
+    NeighborhoodIndex(const NeighborhoodIndex&) = delete;
+    NeighborhoodIndex& operator=(const NeighborhoodIndex&) = delete;
+
+    const PointCloud& cloud() const { return cloud_; }
+    const KDTree& tree() const { return tree_; }
+    const KNNGraph& graph() const { return graph_; }
+    size_t size() const { return cloud_.size(); }
+
+    // Per-point normals, stored in the cloud's normal channel
+    void setNormals(std::vector<Vec3f> normals) { cloud_.setNormals(std::move(normals)); }
+    const std::vector<Vec3f>& normals() const { return cloud_.normals(); }
+
+    /**
+     * Drop every point i with keep[i] == 0. Point indices and attribute
+     * channels are compacted, the tree is rebuilt over the remaining
+     * points and graph rows that referenced a removed point are refilled
+     * from the new tree.
+     */
+    void retain(const std::vector<uint8_t>& keep);
+
+private:
+    PointCloud cloud_;
+    KDTree tree_;
+    KNNGraph graph_;
+};
+
+} // namespace scanforge
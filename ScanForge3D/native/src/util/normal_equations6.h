@@ -0,0 +1,121 @@
+#pragma once
+#include "../point_cloud/point_cloud.h"
+#include <cmath>
+
+namespace scanforge {
+
+/**
+ * Gauss-Newton normal equations J^T J x = -J^T r for a rigid motion
+ * increment x = (rotation w, translation t), as used by point-to-plane
+ * ICP: a residual r = n . (p - q) linearized around the current pose
+ * has the Jacobian row (p x n, n).
+ *
+ * Rows are accumulated in double (the upper triangle of J^T J only), so
+ * one instance per thread can be summed with merge(). solve() is a 6x6
+ * Cholesky factorization; it fails when the system is not positive
+ * definite, i.e. when the correspondences leave a motion unconstrained
+ * (a plane or a cylinder).
+ */
+struct NormalEquations6 {
+    double ata[21] = {};  // upper triangle, row by row
+    double atb[6] = {};
+    double residual_sq = 0.0;
+    size_t count = 0;
+
+    // Point-to-plane row: p the moved source point, n the target normal
+    void addPointToPlane(const Vec3f& p, const Vec3f& n, float residual, float weight = 1.0f) {
+        Vec3f c = p.cross(n);
+        const double j[6] = {c.x, c.y, c.z, n.x, n.y, n.z};
+        add(j, residual, weight);
+    }
+
+    void add(const double j[6], double residual, double weight = 1.0) {
+        int k = 0;
+        for (int r = 0; r < 6; r++) {
+            double wj = weight * j[r];
+            for (int c = r; c < 6; c++) ata[k++] += wj * j[c];
+            atb[r] += wj * residual;
+        }
+        residual_sq += weight * residual * residual;
+        count++;
+    }
+
+    void merge(const NormalEquations6& o) {
+        for (int k = 0; k < 21; k++) ata[k] += o.ata[k];
+        for (int k = 0; k < 6; k++) atb[k] += o.atb[k];
+        residual_sq += o.residual_sq;
+        count += o.count;
+    }
+
+    // Gauss-Newton step: x = -(J^T J)^-1 J^T r. False if singular.
+    bool solve(double x[6]) const {
+        double l[6][6] = {};
+        double a[6][6];
+        int k = 0;
+        for (int r = 0; r < 6; r++) {
+            for (int c = r; c < 6; c++) a[r][c] = a[c][r] = ata[k++];
+        }
+        for (int c = 0; c < 6; c++) {
+            double d = a[c][c];
+            for (int m = 0; m < c; m++) d -= l[c][m] * l[c][m];
+            // Relative pivot test, so the scale of the points does not matter
+            if (!(d > 1e-12 * (a[c][c] + 1e-30))) return false;
+            l[c][c] = std::sqrt(d);
+            for (int r = c + 1; r < 6; r++) {
+                double s = a[r][c];
+                for (int m = 0; m < c; m++) s -= l[r][m] * l[c][m];
+                l[r][c] = s / l[c][c];
+            }
+        }
+        // L y = -b, then L^T x = y
+        double y[6];
+        for (int r = 0; r < 6; r++) {
+            double s = -atb[r];
+            for (int m = 0; m < r; m++) s -= l[r][m] * y[m];
+            y[r] = s / l[r][r];
+        }
+        for (int r = 5; r >= 0; r--) {
+            double s = y[r];
+            for (int m = r + 1; m < 6; m++) s -= l[m][r] * x[m];
+            x[r] = s / l[r][r];
+        }
+        return true;
+    }
+};
+
+/**
+ * Applies the increment x = (w, t) from the left to the rigid motion
+ * (R, t0): R' = exp([w]x) R, t' = exp([w]x) t0 + t. R is row-major 3x3.
+ */
+inline void applyTwist(const double x[6], float R[9], Vec3f& translation) {
+    double theta = std::sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+    double e[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+    if (theta > 1e-12) {
+        // Rodrigues: I + sin(theta) K + (1 - cos(theta)) K^2, K = [w / theta]x
+        double kx = x[0] / theta, ky = x[1] / theta, kz = x[2] / theta;
+        double s = std::sin(theta), c = 1.0 - std::cos(theta);
+        e[0] = 1 - c * (ky * ky + kz * kz);
+        e[1] = -s * kz + c * kx * ky;
+        e[2] = s * ky + c * kx * kz;
+        e[3] = s * kz + c * kx * ky;
+        e[4] = 1 - c * (kx * kx + kz * kz);
+        e[5] = -s * kx + c * ky * kz;
+        e[6] = -s * ky + c * kx * kz;
+        e[7] = s * kx + c * ky * kz;
+        e[8] = 1 - c * (kx * kx + ky * ky);
+    }
+    float out[9];
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            out[r * 3 + c] = static_cast<float>(e[r * 3] * R[c] + e[r * 3 + 1] * R[3 + c] +
+                                                e[r * 3 + 2] * R[6 + c]);
+        }
+    }
+    for (int k = 0; k < 9; k++) R[k] = out[k];
+    Vec3f t0 = translation;
+    translation = Vec3f(static_cast<float>(e[0] * t0.x + e[1] * t0.y + e[2] * t0.z + x[3]),
+                        static_cast<float>(e[3] * t0.x + e[4] * t0.y + e[5] * t0.z + x[4]),
+                        static_cast<float>(e[6] * t0.x + e[7] * t0.y + e[8] * t0.z + x[5]));
+}
+
+} // namespace scanforge
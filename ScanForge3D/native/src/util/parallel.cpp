@@ -0,0 +1,81 @@
+#include "parallel.h"
+
+namespace scanforge {
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(hardwareThreads() - 1);
+    return pool;
+}
+
+ThreadPool::ThreadPool(int workers) {
+    threads_.reserve(std::max(0, workers));
+    for (int i = 0; i < workers; i++) threads_.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+
+void ThreadPool::dispatch(int count, Call call, void* context) {
+    std::unique_lock<std::mutex> batch(batch_mutex_, std::try_to_lock);
+    if (!batch.owns_lock() || threads_.empty() || count <= 1) {
+        for (int t = 0; t < count; t++) call(context, t);
+        return;
+    }
+
+    {
+        // A worker that woke late for the last batch may still be
+        // looking at its (finished) counters
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return active_ == 0; });
+        call_ = call;
+        context_ = context;
+        count_ = count;
+        next_.store(0, std::memory_order_relaxed);
+        remaining_ = count;
+        generation_++;
+    }
+    wake_.notify_all();
+    int finished = drain(call, context, count);
+
+    // No worker touches this batch once it is finished and they left it
+    std::unique_lock<std::mutex> lock(mutex_);
+    remaining_ -= finished;
+    done_.wait(lock, [this] { return remaining_ == 0 && active_ == 0; });
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+        if (stopping_) return;
+        seen = generation_;
+        Call call = call_;
+        void* context = context_;
+        int count = count_;
+        active_++;
+        lock.unlock();
+        int finished = drain(call, context, count);
+        lock.lock();
+        active_--;
+        remaining_ -= finished;
+        if (active_ == 0 || remaining_ == 0) done_.notify_all();
+    }
+}
+
+int ThreadPool::drain(Call call, void* context, int count) {
+    int finished = 0;
+    for (int t; (t = next_.fetch_add(1, std::memory_order_relaxed)) < count;) {
+        call(context, t);
+        finished++;
+    }
+    return finished;
+}
+
+} // namespace scanforge
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace scanforge {
+
+inline int hardwareThreads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? static_cast<int>(n) : 1;
+}
+
+/**
+ * Persistent worker threads for parallelFor, started once (on first
+ * use) so per-frame and per-iteration loops do not create threads.
+ *
+ * run() hands out tasks 0..count-1 to the workers and the calling
+ * thread and returns when all are done; nothing is allocated per call.
+ * One batch runs at a time: a call made while the pool is busy (from
+ * another thread, or nested inside a task) runs its tasks inline on
+ * the calling thread, in order, so it neither waits nor deadlocks.
+ */
+class ThreadPool {
+public:
+    // hardwareThreads() - 1 workers; the caller is the remaining thread
+    static ThreadPool& shared();
+
+    explicit ThreadPool(int workers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Calls task(t) for every t in [0, count)
+    template <typename Task>
+    void run(int count, Task& task) {
+        dispatch(count, [](void* context, int t) { (*static_cast<Task*>(context))(t); }, &task);
+    }
+
+private:
+    using Call = void (*)(void* context, int task);
+
+    void dispatch(int count, Call call, void* context);
+    void workerLoop();
+    // Takes tasks of the current batch until none are left; returns how
+    // many this thread ran
+    int drain(Call call, void* context, int count);
+
+    std::vector<std::thread> threads_;
+    std::mutex batch_mutex_;  // held by the caller for the whole batch
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    uint64_t generation_ = 0;  // bumped per batch
+    bool stopping_ = false;
+
+    // Current batch, written under mutex_ while no worker is in it
+    Call call_ = nullptr;
+    void* context_ = nullptr;
+    int count_ = 0;
+    std::atomic<int> next_{0};  // next task to hand out
+    int remaining_ = 0;         // tasks not yet finished
+    int active_ = 0;            // workers inside the batch
+};
+
+/**
+ * Split [begin, end) into contiguous chunks, one per hardware thread, and
+ * call fn(chunk_begin, chunk_end, thread_id) for each on the shared
+ * ThreadPool. The calling thread takes part. Ranges smaller than
+ * min_chunk per thread use fewer chunks, down to running inline. Chunk
+ * boundaries and ids depend only on the range, never on which thread
+ * ran a chunk.
+ */
+template <typename Fn>
+void parallelFor(size_t begin, size_t end, Fn&& fn, size_t min_chunk = 4096) {
+    if (end <= begin) return;
+    size_t total = end - begin;
+    size_t max_threads = std::max<size_t>(1, total / std::max<size_t>(1, min_chunk));
+    int num_threads = static_cast<int>(std::min<size_t>(hardwareThreads(), max_threads));
+
+    if (num_threads <= 1) {
+        fn(begin, end, 0);
+        return;
+    }
+
+    size_t chunk = (total + num_threads - 1) / num_threads;
+    auto task = [&](int t) {
+        size_t b = begin + t * chunk;
+        size_t e = std::min(end, b + chunk);
+        if (b < e) fn(b, e, t);
+    };
+    ThreadPool::shared().run(num_threads, task);
+}
+
+/** Number of thread_id values parallelFor may pass for a range of this size. */
+inline int parallelThreadCount(size_t total, size_t min_chunk = 4096) {
+    size_t max_threads = std::max<size_t>(1, total / std::max<size_t>(1, min_chunk));
+    return static_cast<int>(std::min<size_t>(hardwareThreads(), max_threads));
+}
+
+/**
+ * Output offsets for a parallel stream compaction of the items with
+ * keep[i] != 0: offset[c] is the number of kept items before chunk c of
+ * parallelFor(0, keep.size(), ..., min_chunk), offset.back() the total.
+ * A second parallelFor with the same range and min_chunk can then write
+ * chunk c's survivors from offset[c] on, in order.
+ */
+inline std::vector<size_t> parallelCompactOffsets(const std::vector<uint8_t>& keep,
+                                                  size_t min_chunk = 4096) {
+    int chunks = parallelThreadCount(keep.size(), min_chunk);
+    std::vector<size_t> offset(chunks + 1, 0);
+    parallelFor(0, keep.size(), [&](size_t begin, size_t end, int chunk) {
+        size_t count = 0;
+        for (size_t i = begin; i < end; i++) count += keep[i] != 0;
+        offset[chunk + 1] = count;
+    }, min_chunk);
+    for (int c = 0; c < chunks; c++) offset[c + 1] += offset[c];
+    return offset;
+}
+
+} // namespace scanforge
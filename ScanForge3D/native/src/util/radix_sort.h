@@ -0,0 +1,105 @@
+#pragma once
+#include "parallel.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace scanforge {
+
+/**
+ * Stable radix sort of 64-bit values by their bits [lo_bit, hi_bit).
+ *
+ * Meant for packed (key << index_bits | index) items: sorting by the key
+ * bits only keeps equal keys in index order, so the result is
+ * deterministic and the index comes along for free.
+ *
+ * One MSD pass on the top 11 key bits scatters the values into 2048
+ * buckets (per-thread histograms, parallel scatter). Each bucket is then
+ * small enough to stay in cache and is finished with 8-bit LSD passes,
+ * buckets in parallel. Only the first pass streams the whole array
+ * through memory.
+ */
+inline void radixSortBits(std::vector<uint64_t>& values, int lo_bit, int hi_bit) {
+    constexpr int MSD_BITS = 11;
+    constexpr size_t MSD_RADIX = size_t(1) << MSD_BITS;
+    constexpr int LSD_BITS = 8;
+    constexpr size_t LSD_RADIX = size_t(1) << LSD_BITS;
+    const size_t min_chunk = 65536;
+
+    size_t n = values.size();
+    if (n < 2 || hi_bit <= lo_bit) return;
+
+    // MSD pass on bits [msd_lo, hi_bit)
+    int msd_lo = std::max(lo_bit, hi_bit - MSD_BITS);
+    uint64_t msd_mask = (uint64_t(1) << (hi_bit - msd_lo)) - 1;
+
+    int chunks = parallelThreadCount(n, min_chunk);
+    std::vector<uint32_t> hist(chunks * MSD_RADIX, 0);
+    parallelFor(0, n, [&](size_t begin, size_t end, int chunk) {
+        uint32_t* h = hist.data() + chunk * MSD_RADIX;
+        for (size_t i = begin; i < end; i++) h[(values[i] >> msd_lo) & msd_mask]++;
+    }, min_chunk);
+
+    // Offsets in digit-major, chunk-minor order keep the sort stable
+    std::vector<uint32_t> bucket_start(MSD_RADIX + 1, 0);
+    uint32_t sum = 0;
+    for (size_t d = 0; d < MSD_RADIX; d++) {
+        bucket_start[d] = sum;
+        for (int c = 0; c < chunks; c++) {
+            uint32_t count = hist[c * MSD_RADIX + d];
+            hist[c * MSD_RADIX + d] = sum;
+            sum += count;
+        }
+    }
+    bucket_start[MSD_RADIX] = sum;
+
+    std::vector<uint64_t> sorted(n);
+    parallelFor(0, n, [&](size_t begin, size_t end, int chunk) {
+        uint32_t* h = hist.data() + chunk * MSD_RADIX;
+        for (size_t i = begin; i < end; i++) {
+            uint64_t v = values[i];
+            sorted[h[(v >> msd_lo) & msd_mask]++] = v;
+        }
+    }, min_chunk);
+    values.swap(sorted);
+    if (msd_lo == lo_bit) return;
+
+    // LSD passes on [lo_bit, msd_lo) within each bucket
+    parallelFor(0, MSD_RADIX, [&](size_t bucket_begin, size_t bucket_end, int) {
+        std::vector<uint64_t> tmp;
+        uint32_t counts[LSD_RADIX];
+        for (size_t b = bucket_begin; b < bucket_end; b++) {
+            uint64_t* data = values.data() + bucket_start[b];
+            size_t count = bucket_start[b + 1] - bucket_start[b];
+            if (count < 2) continue;
+
+            if (count <= 32) {
+                std::stable_sort(data, data + count, [&](uint64_t a, uint64_t c) {
+                    return ((a >> lo_bit) & ((uint64_t(1) << (msd_lo - lo_bit)) - 1)) <
+                           ((c >> lo_bit) & ((uint64_t(1) << (msd_lo - lo_bit)) - 1));
+                });
+                continue;
+            }
+
+            tmp.resize(count);
+            uint64_t* src = data;
+            uint64_t* dst = tmp.data();
+            for (int shift = lo_bit; shift < msd_lo; shift += LSD_BITS) {
+                uint64_t mask = (uint64_t(1) << std::min(LSD_BITS, msd_lo - shift)) - 1;
+                std::fill(counts, counts + LSD_RADIX, 0);
+                for (size_t i = 0; i < count; i++) counts[(src[i] >> shift) & mask]++;
+                uint32_t offset = 0;
+                for (size_t d = 0; d < LSD_RADIX; d++) {
+                    uint32_t c = counts[d];
+                    counts[d] = offset;
+                    offset += c;
+                }
+                for (size_t i = 0; i < count; i++) dst[counts[(src[i] >> shift) & mask]++] = src[i];
+                std::swap(src, dst);
+            }
+            if (src != data) std::copy(src, src + count, data);
+        }
+    }, 64);
+}
+
+} // namespace scanforge
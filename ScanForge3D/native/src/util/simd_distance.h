@@ -0,0 +1,64 @@
+#pragma once
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SCANFORGE_SIMD_NEON 1
+#elif defined(__AVX__)
+#include <immintrin.h>
+#define SCANFORGE_SIMD_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCANFORGE_SIMD_SSE 1
+#endif
+
+namespace scanforge {
+
+/**
+ * Squared distances from one query to n points stored as separate
+ * x / y / z arrays: out[i] = |p_i - q|^2.
+ *
+ * NEON on ARM (4 lanes), AVX (8 lanes) or SSE (4 lanes) on x86, with a
+ * scalar tail. Every path adds (dx^2 + dy^2) + dz^2 in the same order as
+ * the scalar tail. Inputs need no particular alignment.
+ */
+inline void squaredDistances(const float* xs, const float* ys, const float* zs,
+                             int n, float qx, float qy, float qz, float* out) {
+    int i = 0;
+#if defined(SCANFORGE_SIMD_NEON)
+    float32x4_t vqx = vdupq_n_f32(qx), vqy = vdupq_n_f32(qy), vqz = vdupq_n_f32(qz);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t dx = vsubq_f32(vld1q_f32(xs + i), vqx);
+        float32x4_t dy = vsubq_f32(vld1q_f32(ys + i), vqy);
+        float32x4_t dz = vsubq_f32(vld1q_f32(zs + i), vqz);
+        float32x4_t d = vaddq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)),
+                                  vmulq_f32(dz, dz));
+        vst1q_f32(out + i, d);
+    }
+#elif defined(SCANFORGE_SIMD_AVX)
+    __m256 vqx = _mm256_set1_ps(qx), vqy = _mm256_set1_ps(qy), vqz = _mm256_set1_ps(qz);
+    for (; i + 8 <= n; i += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(xs + i), vqx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(ys + i), vqy);
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(zs + i), vqz);
+        __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                 _mm256_mul_ps(dz, dz));
+        _mm256_storeu_ps(out + i, d);
+    }
+#elif defined(SCANFORGE_SIMD_SSE)
+    __m128 vqx = _mm_set1_ps(qx), vqy = _mm_set1_ps(qy), vqz = _mm_set1_ps(qz);
+    for (; i + 4 <= n; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i), vqx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i), vqy);
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(zs + i), vqz);
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                              _mm_mul_ps(dz, dz));
+        _mm_storeu_ps(out + i, d);
+    }
+#endif
+    for (; i < n; i++) {
+        float dx = xs[i] - qx, dy = ys[i] - qy, dz = zs[i] - qz;
+        out[i] = dx * dx + dy * dy + dz * dz;
+    }
+}
+
+} // namespace scanforge
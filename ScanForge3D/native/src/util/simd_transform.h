@@ -0,0 +1,66 @@
+#pragma once
+#include "simd_distance.h"
+#include <cstddef>
+
+namespace scanforge {
+
+/**
+ * Applies the rigid motion p' = R p + t in place to n points stored as
+ * separate x / y / z arrays (R row-major 3x3).
+ *
+ * NEON on ARM (4 lanes), AVX (8 lanes) or SSE (4 lanes) on x86, with a
+ * scalar tail; all three coordinates of a lane are loaded before any is
+ * stored. Every path evaluates (r0 x + r1 y) + r2 z + t like the tail.
+ */
+inline void transformPointsInPlace(float* xs, float* ys, float* zs, size_t n,
+                                   const float R[9], float tx, float ty, float tz) {
+    size_t i = 0;
+#if defined(SCANFORGE_SIMD_NEON)
+    float32x4_t r[9];
+    for (int k = 0; k < 9; k++) r[k] = vdupq_n_f32(R[k]);
+    float32x4_t vtx = vdupq_n_f32(tx), vty = vdupq_n_f32(ty), vtz = vdupq_n_f32(tz);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t x = vld1q_f32(xs + i), y = vld1q_f32(ys + i), z = vld1q_f32(zs + i);
+        vst1q_f32(xs + i, vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(r[0], x), vmulq_f32(r[1], y)),
+                                              vmulq_f32(r[2], z)), vtx));
+        vst1q_f32(ys + i, vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(r[3], x), vmulq_f32(r[4], y)),
+                                              vmulq_f32(r[5], z)), vty));
+        vst1q_f32(zs + i, vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(r[6], x), vmulq_f32(r[7], y)),
+                                              vmulq_f32(r[8], z)), vtz));
+    }
+#elif defined(SCANFORGE_SIMD_AVX)
+    __m256 r[9];
+    for (int k = 0; k < 9; k++) r[k] = _mm256_set1_ps(R[k]);
+    __m256 vtx = _mm256_set1_ps(tx), vty = _mm256_set1_ps(ty), vtz = _mm256_set1_ps(tz);
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(xs + i), y = _mm256_loadu_ps(ys + i), z = _mm256_loadu_ps(zs + i);
+        _mm256_storeu_ps(xs + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(r[0], x), _mm256_mul_ps(r[1], y)), _mm256_mul_ps(r[2], z)), vtx));
+        _mm256_storeu_ps(ys + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(r[3], x), _mm256_mul_ps(r[4], y)), _mm256_mul_ps(r[5], z)), vty));
+        _mm256_storeu_ps(zs + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(r[6], x), _mm256_mul_ps(r[7], y)), _mm256_mul_ps(r[8], z)), vtz));
+    }
+#elif defined(SCANFORGE_SIMD_SSE)
+    __m128 r[9];
+    for (int k = 0; k < 9; k++) r[k] = _mm_set1_ps(R[k]);
+    __m128 vtx = _mm_set1_ps(tx), vty = _mm_set1_ps(ty), vtz = _mm_set1_ps(tz);
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(xs + i), y = _mm_loadu_ps(ys + i), z = _mm_loadu_ps(zs + i);
+        _mm_storeu_ps(xs + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(r[0], x), _mm_mul_ps(r[1], y)), _mm_mul_ps(r[2], z)), vtx));
+        _mm_storeu_ps(ys + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(r[3], x), _mm_mul_ps(r[4], y)), _mm_mul_ps(r[5], z)), vty));
+        _mm_storeu_ps(zs + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(r[6], x), _mm_mul_ps(r[7], y)), _mm_mul_ps(r[8], z)), vtz));
+    }
+#endif
+    for (; i < n; i++) {
+        float x = xs[i], y = ys[i], z = zs[i];
+        xs[i] = (R[0] * x + R[1] * y) + R[2] * z + tx;
+        ys[i] = (R[3] * x + R[4] * y) + R[5] * z + ty;
+        zs[i] = (R[6] * x + R[7] * y) + R[8] * z + tz;
+    }
+}
+
+} // namespace scanforge
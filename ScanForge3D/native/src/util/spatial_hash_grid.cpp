@@ -0,0 +1,135 @@
+#include "spatial_hash_grid.h"
+#include "parallel.h"
+#include "simd_distance.h"
+#include <algorithm>
+#include <cmath>
+
+namespace scanforge {
+
+void SpatialHashGrid::build(const PointCloud& cloud) {
+    size_t n = cloud.size();
+
+    // Power-of-two table with at least one bucket per point
+    uint32_t table_size = 1;
+    while (table_size < n && table_size < (1u << 30)) table_size <<= 1;
+    bucket_mask_ = table_size - 1;
+
+    std::vector<uint64_t> point_key(n);
+    bucket_start_.assign(static_cast<size_t>(table_size) + 1, 0);
+    for (size_t i = 0; i < n; i++) {
+        const Vec3f& p = cloud.getPoint(i);
+        uint64_t key = packCell(static_cast<int>(std::floor(p.x * inv_cell_size_)),
+                                static_cast<int>(std::floor(p.y * inv_cell_size_)),
+                                static_cast<int>(std::floor(p.z * inv_cell_size_)));
+        point_key[i] = key;
+        bucket_start_[bucketOf(key) + 1]++;
+    }
+    for (size_t b = 0; b < table_size; b++) {
+        bucket_start_[b + 1] += bucket_start_[b];
+    }
+
+    // Counting sort into SoA storage
+    xs_.resize(n); ys_.resize(n); zs_.resize(n);
+    keys_.resize(n); ids_.resize(n);
+    std::vector<uint32_t> cursor(bucket_start_.begin(), bucket_start_.end() - 1);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t slot = cursor[bucketOf(point_key[i])]++;
+        const Vec3f& p = cloud.getPoint(i);
+        xs_[slot] = p.x; ys_[slot] = p.y; zs_[slot] = p.z;
+        keys_[slot] = point_key[i];
+        ids_[slot] = static_cast<int>(i);
+    }
+}
+
+template <typename Visit>
+void SpatialHashGrid::forEachInRadius(const Vec3f& query, float radius,
+                                      Visit&& visit) const {
+    if (ids_.empty()) return;
+
+    float r2 = radius * radius;
+    // Cells around the query's that the radius can reach: one ring up to
+    // the cell size, more for larger radii
+    const int reach = std::max(1, static_cast<int>(std::ceil(radius * inv_cell_size_)));
+
+    int cx = static_cast<int>(std::floor(query.x * inv_cell_size_));
+    int cy = static_cast<int>(std::floor(query.y * inv_cell_size_));
+    int cz = static_cast<int>(std::floor(query.z * inv_cell_size_));
+
+    // Distance from the query to the lower / upper face of its cell per
+    // axis; a neighbor cell is skipped if its nearest corner is too far.
+    // A cell d steps away is (|d| - 1) cells beyond that face.
+    float lo[3] = {query.x - cx * cell_size_, query.y - cy * cell_size_,
+                   query.z - cz * cell_size_};
+    float hi[3] = {cell_size_ - lo[0], cell_size_ - lo[1], cell_size_ - lo[2]};
+
+    constexpr int CHUNK = 64;
+    float dist[CHUNK];
+
+    auto gap = [this](int d, float lo_face, float hi_face) {
+        if (d == 0) return 0.0f;
+        return (d < 0 ? lo_face : hi_face) + (std::abs(d) - 1) * cell_size_;
+    };
+
+    for (int dz = -reach; dz <= reach; dz++) {
+        float gz = gap(dz, lo[2], hi[2]);
+        for (int dy = -reach; dy <= reach; dy++) {
+            float gy = gap(dy, lo[1], hi[1]);
+            for (int dx = -reach; dx <= reach; dx++) {
+                float gx = gap(dx, lo[0], hi[0]);
+                if (gx * gx + gy * gy + gz * gz > r2) continue;
+
+                uint64_t key = packCell(cx + dx, cy + dy, cz + dz);
+                uint32_t b = bucketOf(key);
+                uint32_t begin = bucket_start_[b];
+                uint32_t end = bucket_start_[b + 1];
+
+                for (uint32_t s = begin; s < end; s += CHUNK) {
+                    int n = static_cast<int>(std::min<uint32_t>(CHUNK, end - s));
+                    squaredDistances(xs_.data() + s, ys_.data() + s, zs_.data() + s,
+                                     n, query.x, query.y, query.z, dist);
+                    for (int i = 0; i < n; i++) {
+                        if (dist[i] <= r2 && keys_[s + i] == key) {
+                            if (!visit(ids_[s + i])) return;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+int SpatialHashGrid::radiusSearch(const Vec3f& query, float radius,
+                                  std::vector<int>& out) const {
+    size_t before = out.size();
+    forEachInRadius(query, radius, [&out](int id) {
+        out.push_back(id);
+        return true;
+    });
+    return static_cast<int>(out.size() - before);
+}
+
+int SpatialHashGrid::countWithinRadius(const Vec3f& query, float radius,
+                                       int max_count) const {
+    int count = 0;
+    forEachInRadius(query, radius, [&count, max_count](int) {
+        return ++count < max_count;
+    });
+    return count;
+}
+
+std::vector<int> SpatialHashGrid::countAllWithinRadius(float radius,
+                                                       int max_count) const {
+    std::vector<int> counts(ids_.size(), 0);
+
+    // Storage order groups points of a cell together, so neighboring
+    // queries hit the same buckets
+    parallelFor(0, ids_.size(), [&](size_t begin, size_t end, int) {
+        for (size_t s = begin; s < end; s++) {
+            counts[ids_[s]] = countWithinRadius(Vec3f(xs_[s], ys_[s], zs_[s]),
+                                                radius, max_count);
+        }
+    });
+    return counts;
+}
+
+} // namespace scanforge
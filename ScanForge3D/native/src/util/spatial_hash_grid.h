@@ -0,0 +1,76 @@
+#pragma once
+#include "../point_cloud/point_cloud.h"
+#include <cstdint>
+#include <vector>
+
+namespace scanforge {
+
+/**
+ * Uniform hashed grid for fixed-radius neighbor queries.
+ *
+ * Meant for clouds of near-uniform density (e.g. after VoxelGridFilter)
+ * with a cell size equal to the query radius: a query only looks at the
+ * 3x3x3 cells around it, and skips those farther than the radius.
+ * Cells are hashed into a power-of-two bucket table and the points are
+ * counting-sorted by bucket into SoA arrays, so build is O(n) and each
+ * bucket is one contiguous range. Every point keeps its packed cell key,
+ * so cells that collide in a bucket are told apart without a second
+ * lookup.
+ *
+ * Larger query radii are answered exactly by widening the ring of
+ * cells to ceil(radius / cell size), at a cubic cost in cells visited.
+ */
+class SpatialHashGrid {
+public:
+    explicit SpatialHashGrid(float cell_size)
+        : cell_size_(cell_size), inv_cell_size_(1.0f / cell_size) {}
+
+    void build(const PointCloud& cloud);
+
+    // Appends indices of all points within radius of query to out
+    // (unordered) and returns how many were added.
+    int radiusSearch(const Vec3f& query, float radius, std::vector<int>& out) const;
+
+    // Number of points within radius of query. Stops counting once
+    // max_count is reached, which is all a density test needs.
+    int countWithinRadius(const Vec3f& query, float radius,
+                          int max_count = 0x7fffffff) const;
+
+    // countWithinRadius for every indexed point (the point itself counts),
+    // indexed like the source cloud. Runs in grid order, multi-threaded.
+    std::vector<int> countAllWithinRadius(float radius,
+                                          int max_count = 0x7fffffff) const;
+
+    float cellSize() const { return cell_size_; }
+    size_t size() const { return ids_.size(); }
+
+private:
+    float cell_size_;
+    float inv_cell_size_;
+    uint32_t bucket_mask_ = 0;
+
+    std::vector<uint32_t> bucket_start_;  // bucket b = [start[b], start[b+1])
+    std::vector<float> xs_, ys_, zs_;     // points sorted by bucket
+    std::vector<uint64_t> keys_;          // packed cell of each point
+    std::vector<int> ids_;
+
+    static uint64_t packCell(int cx, int cy, int cz) {
+        // 21 bits per axis: +-1M cells, far beyond any scan extent
+        const int bias = 1 << 20;
+        return (static_cast<uint64_t>((cx + bias) & 0x1FFFFF) << 42)
+             | (static_cast<uint64_t>((cy + bias) & 0x1FFFFF) << 21)
+             |  static_cast<uint64_t>((cz + bias) & 0x1FFFFF);
+    }
+
+    uint32_t bucketOf(uint64_t key) const {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return static_cast<uint32_t>(key) & bucket_mask_;
+    }
+
+    template <typename Visit>
+    void forEachInRadius(const Vec3f& query, float radius, Visit&& visit) const;
+};
+
+} // namespace scanforge
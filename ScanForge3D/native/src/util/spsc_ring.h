@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace scanforge {
+
+/**
+ * Bounded lock-free single-producer / single-consumer ring of
+ * preallocated slots.
+ *
+ * Slots are filled and drained in place: the producer gets the next
+ * free slot from beginWrite(), fills it and publishes it with
+ * commitWrite(); the consumer gets the oldest published slot from
+ * beginRead() and hands it back with commitRead(). Neither side ever
+ * waits on the other, a full ring (beginWrite() == nullptr) is for the
+ * caller to handle. The two counters live on separate cache lines.
+ */
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) : slots_(capacity > 0 ? capacity : 1) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return slots_.size(); }
+
+    // Published slots not yet consumed; exact only on the consumer
+    // thread, a snapshot anywhere else
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    // Producer: next free slot, or nullptr if the ring is full
+    T* beginWrite() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= slots_.size()) return nullptr;
+        return &slots_[head % slots_.size()];
+    }
+    void commitWrite() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer: oldest published slot, or nullptr if the ring is empty
+    T* beginRead() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return nullptr;
+        return &slots_[tail % slots_.size()];
+    }
+    void commitRead() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Slots by index, for preallocating their storage before use
+    T& slot(size_t i) { return slots_[i]; }
+
+private:
+    std::vector<T> slots_;
+    alignas(64) std::atomic<size_t> head_{0};  // written by the producer
+    alignas(64) std::atomic<size_t> tail_{0};  // written by the consumer
+};
+
+} // namespace scanforge
@@ -0,0 +1,22 @@
+#include "symmetric_eigen3.h"
+#include "parallel.h"
+
+namespace scanforge {
+
+void smallestEigenvectors(const SymMat3Arrays& matrices, size_t n,
+                          float* nx, float* ny, float* nz,
+                          float* min_eigenvalues) {
+    parallelFor(0, n, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; i++) {
+            SymMat3 m{matrices.xx[i], matrices.xy[i], matrices.xz[i],
+                      matrices.yy[i], matrices.yz[i], matrices.zz[i]};
+            Vec3f v;
+            float lambda;
+            smallestEigenvector(m, v, &lambda);
+            nx[i] = v.x; ny[i] = v.y; nz[i] = v.z;
+            if (min_eigenvalues) min_eigenvalues[i] = lambda;
+        }
+    }, 16384);
+}
+
+} // namespace scanforge
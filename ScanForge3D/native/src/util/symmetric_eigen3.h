@@ -0,0 +1,113 @@
+#pragma once
+#include "../point_cloud/point_cloud.h"
+#include <cmath>
+#include <cstddef>
+
+namespace scanforge {
+
+// Symmetric 3x3 matrix by its upper triangle
+struct SymMat3 {
+    float xx, xy, xz, yy, yz, zz;
+};
+
+// The same, as structure-of-arrays for batches
+struct SymMat3Arrays {
+    const float *xx, *xy, *xz, *yy, *yz, *zz;
+};
+
+/**
+ * Eigenvector of the smallest eigenvalue of a symmetric 3x3 matrix
+ * (e.g. a neighborhood covariance, whose smallest eigenvector is the
+ * surface normal), in closed form.
+ *
+ * The matrix is scaled to unit max element, the eigenvalues come from
+ * the trigonometric solution of the characteristic cubic, and the
+ * eigenvector is the largest cross product of two rows of A - l_min I.
+ * No iteration and only one acos / cos pair per matrix.
+ *
+ * Degenerate cases: if l_min is a double eigenvalue (points on a line)
+ * the rows of A - l_min I are all parallel and any unit vector
+ * perpendicular to them is returned. Zero, isotropic or non-finite
+ * matrices have no preferred direction; then normal = (0, 1, 0) and the
+ * function returns false.
+ *
+ * min_eigenvalue (optional) receives the smallest eigenvalue.
+ */
+inline bool smallestEigenvector(const SymMat3& m, Vec3f& normal,
+                                float* min_eigenvalue = nullptr) {
+    float scale = std::max(std::max(std::fabs(m.xx), std::fabs(m.yy)),
+                           std::max(std::fabs(m.zz),
+                           std::max(std::fabs(m.xy),
+                           std::max(std::fabs(m.xz), std::fabs(m.yz)))));
+    if (min_eigenvalue) *min_eigenvalue = 0.0f;
+    if (!(scale > 1e-30f) || !std::isfinite(scale)) {
+        normal = Vec3f(0, 1, 0);
+        return false;
+    }
+
+    float inv = 1.0f / scale;
+    float xx = m.xx * inv, xy = m.xy * inv, xz = m.xz * inv;
+    float yy = m.yy * inv, yz = m.yz * inv, zz = m.zz * inv;
+
+    // B = (A - qI) / p has eigenvalues 2 cos(phi + 2 pi j / 3)
+    float q = (xx + yy + zz) * (1.0f / 3.0f);
+    float bxx = xx - q, byy = yy - q, bzz = zz - q;
+    float off2 = xy * xy + xz * xz + yz * yz;
+    float p2 = bxx * bxx + byy * byy + bzz * bzz + 2.0f * off2;
+    if (p2 < 1e-12f) {
+        // A = qI: every direction is an eigenvector
+        if (min_eigenvalue) *min_eigenvalue = q * scale;
+        normal = Vec3f(0, 1, 0);
+        return false;
+    }
+    float p = std::sqrt(p2 * (1.0f / 6.0f));
+    float det_b = bxx * (byy * bzz - yz * yz) - xy * (xy * bzz - yz * xz)
+                + xz * (xy * yz - byy * xz);
+    float r = 0.5f * det_b / (p * p * p);
+    r = std::min(1.0f, std::max(-1.0f, r));
+    float phi = std::acos(r) * (1.0f / 3.0f);
+    float lambda = q + 2.0f * p * std::cos(phi + 2.0943951f);
+    if (min_eigenvalue) *min_eigenvalue = lambda * scale;
+
+    // Rows of A - lambda I span the orthogonal complement of the
+    // eigenvector; the best conditioned pair gives it by cross product
+    Vec3f r0(xx - lambda, xy, xz);
+    Vec3f r1(xy, yy - lambda, yz);
+    Vec3f r2(xz, yz, zz - lambda);
+    Vec3f c01 = r0.cross(r1), c02 = r0.cross(r2), c12 = r1.cross(r2);
+    float d01 = c01.dot(c01), d02 = c02.dot(c02), d12 = c12.dot(c12);
+
+    Vec3f best = c01;
+    float best_d = d01;
+    if (d02 > best_d) { best = c02; best_d = d02; }
+    if (d12 > best_d) { best = c12; best_d = d12; }
+
+    if (best_d > 1e-10f) {
+        normal = best * (1.0f / std::sqrt(best_d));
+        return true;
+    }
+
+    // Double smallest eigenvalue: rows are parallel (to the largest
+    // eigenvector); take a perpendicular through the axis it is least
+    // aligned with
+    Vec3f row = r0;
+    if (r1.dot(r1) > row.dot(row)) row = r1;
+    if (r2.dot(r2) > row.dot(row)) row = r2;
+    float ax = std::fabs(row.x), ay = std::fabs(row.y), az = std::fabs(row.z);
+    Vec3f axis = ax <= ay && ax <= az ? Vec3f(1, 0, 0)
+               : ay <= az             ? Vec3f(0, 1, 0)
+                                      : Vec3f(0, 0, 1);
+    normal = row.cross(axis).normalized();
+    return true;
+}
+
+/**
+ * smallestEigenvector for n matrices in SoA layout. Writes unit vectors
+ * to nx / ny / nz and, if min_eigenvalues is not null, the smallest
+ * eigenvalue of each matrix. Multi-threaded for large batches.
+ */
+void smallestEigenvectors(const SymMat3Arrays& matrices, size_t n,
+                          float* nx, float* ny, float* nz,
+                          float* min_eigenvalues = nullptr);
+
+} // namespace scanforge